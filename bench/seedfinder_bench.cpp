@@ -0,0 +1,1698 @@
+// Benchmarks of the finder hot paths, and validation of every fast path
+// against the reference functions and the seeds listed in README.md.
+//
+// Usage: seedfinder_bench [--micro] [--macro] [--validate] [--seconds <s>] [--json <file>]
+// Without a mode flag all three run. The exit code is 1 if any check failed.
+
+#include <biome_render.hpp>
+#include <biome_tiles.hpp>
+#include <candidate_pipeline.hpp>
+#include <cpu_features.hpp>
+#include <finder_utils.hpp>
+#include <layer_cache.hpp>
+#include <quad_base_cache.hpp>
+#include <quad_base_order.hpp>
+#include <result_collector.hpp>
+#include <result_file.hpp>
+#include <seed_lanes.hpp>
+#include <seedfinder.hpp>
+#include <structure_batch.hpp>
+#include <task_engine.hpp>
+#include <temple_clusters.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// One temple listed in README.md
+struct GoldenTemple
+{
+    int64_t seed;
+    int type;
+    int x, z;
+    int score;
+};
+
+// Best found single temples. The jungle temple of seed 167 is left out, its
+// listed position is not a temple position of that seed.
+static const GoldenTemple GOLDEN_SINGLE[] = {
+    {28257, 1, 22784, 16752, 2005},
+    {1306145184061456995LL, 1, 15197824, 18989808, 1995},
+    {42162, 1, 49264, -21248, 1965},
+    {38711, 1, -29984, -16752, 1905},
+    {38513, 1, 46144, 21616, 1875},
+    {65631, 2, -41200, 21104, 692},
+    {6156, 2, -26608, 9904, 668},
+    {3818, 2, 7968, 28016, 660},
+    {62650, 2, 65136, -26256, 660},
+    {1214, 2, 21280, 30304, 656},
+    {2687, 2, 23568, -50608, 656},
+    {2534, 2, -14000, -23232, 652},
+    {3450, 2, -24736, 10832, 652},
+    {62564, 2, 53408, 31792, 652},
+    {470, 2, -28496, 30864, 648},
+    {2516, 2, -20688, 8464, 644},
+    {418, 2, 8224, 33312, 644},
+    {135, 2, 11328, -34672, 640},
+    {903, 3, -65536, 22384, 0},
+};
+
+// Best found multi-temples: all of them share the lower 48 bits and the same 4 temples
+static const int64_t GOLDEN_QUAD_SEEDS[] = {
+    3242038509290238342LL, 423630031342907782LL, 2056770643904541062LL, 152903296189837702LL,
+    -6093007470444039802LL, 6265716445114642822LL, -7005265756839366266LL, -5133452574688431738LL,
+    3353602466647224710LL, -7019026694616796794LL, -3813559406086213242LL, -4316228514255621754LL,
+    -9159567287464644218LL, -5101538029921521274LL, 6200810366761546118LL, -7943307212948917882LL,
+    5398339364371673478LL, -4089054259312479866LL, -1798128101014523514LL, -198785737156349562LL,
+    3301690519790399878LL, 1661819710655803782LL,
+};
+static const GoldenTemple GOLDEN_QUAD_TEMPLES[4] = {
+    {0, 3, -144, -160, 126},
+    {0, 1, -144, 16, 1580},
+    {0, 1, 0, -160, 660},
+    {0, 3, 16, 0, 126},
+};
+static const int GOLDEN_QUAD_TOTAL = 2492;
+
+// Seed used by the micro benchmarks and the random checks
+static const uint64_t BENCH_SEED = 3242038509290238342ULL;
+
+struct MicroResult
+{
+    std::string name;
+    uint64_t ops;
+    double nsMin, nsAvg;
+};
+
+struct MacroResult
+{
+    std::string name;
+    std::string unit;
+    double rate;
+    uint64_t items;
+    double seconds;
+};
+
+struct CheckResult
+{
+    std::string name;
+    uint64_t checked;
+    uint64_t mismatches;
+};
+
+struct Report
+{
+    std::vector<MicroResult> micro;
+    std::vector<MacroResult> macro;
+    std::vector<CheckResult> checks;
+};
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Same scheme as benchmark() in cubiomes tests.c: double the batch size until a
+// batch takes 10 ms, then repeat batches for the time budget. f(n) runs n
+// operations and returns a value that is consumed so the work is not optimized out.
+static MicroResult benchmark(const char *name, double budget, const std::function<uint64_t(uint64_t)> &f)
+{
+    static volatile uint64_t consume = 0;
+    uint64_t batch = 1;
+    double t;
+    for (;; batch *= 2)
+    {
+        t = -now();
+        consume = consume ^ f(batch);
+        t += now();
+        if (t >= 1e-2)
+            break;
+    }
+
+    double total = 0, tmin = t;
+    uint64_t runs = 0;
+    do
+    {
+        t = -now();
+        consume = consume ^ f(batch);
+        t += now();
+        total += t;
+        tmin = std::min(tmin, t);
+        ++runs;
+    } while (total < budget);
+
+    MicroResult r = {name, runs * batch, 1e9 * tmin / batch, 1e9 * total / (runs * batch)};
+    printf("[MICRO] %-28s %10.1f ns/op (avg %.1f)\n", name, r.nsMin, r.nsAvg);
+    fflush(stdout);
+    return r;
+}
+
+static void addCheck(Report &report, const char *name, uint64_t checked, uint64_t mismatches)
+{
+    report.checks.push_back({name, checked, mismatches});
+    printf("[CHECK] %-36s %s (%llu checked, %llu mismatches)\n", name, mismatches ? "FAILED" : "ok",
+           (unsigned long long)checked, (unsigned long long)mismatches);
+    fflush(stdout);
+}
+
+static bool sameScore(TempleScore a, TempleScore b)
+{
+    return a.type == b.type && a.swampSpawnBlocks == b.swampSpawnBlocks;
+}
+
+// Reference path: isViableTemplePos + countSwampSpawnBlocks
+static TempleScore referenceScore(Generator *g, int x, int z, int templeTypes = SELECTED_TEMPLE_TYPES)
+{
+    int type = isViableTemplePos(g, x, z, templeTypes);
+    return {type, type ? countSwampSpawnBlocks(g, x, z, type) : 0};
+}
+
+// A pruned evaluation may only drop candidates that cannot reach minScore
+static bool consistentWithReference(TempleScore fast, TempleScore ref, int minScore)
+{
+    if (sameScore(fast, ref))
+        return true;
+    return fast.type == 0 && (ref.type == 0 || ref.swampSpawnBlocks < minScore);
+}
+
+// Temple positions of a square of regions, row by row
+static void regionPositions(uint64_t seed, int rx0, int rz0, int side, std::vector<int> &xs, std::vector<int> &zs)
+{
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+    xs.resize((size_t)side * side);
+    zs.resize((size_t)side * side);
+    for (int j = 0; j < side; ++j)
+        getFeaturePosBatch(sconf, seed, rx0, rz0 + j, 1, 0, side, &xs[(size_t)j * side], &zs[(size_t)j * side]);
+}
+
+static void runMicro(Report &report, double budget)
+{
+    Generator g;
+    setupGenerator(&g, MC_VERSION, 0);
+    applySeed(&g, DIM_OVERWORLD, BENCH_SEED);
+
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+
+    // Fixed candidates: the temple positions of a 32x32 region square around the origin
+    const int side = 32;
+    std::vector<int> xs, zs;
+    regionPositions(BENCH_SEED, -side / 2, -side / 2, side, xs, zs);
+    const size_t n = xs.size();
+
+    std::vector<size_t> viable;
+    for (size_t i = 0; i < n; ++i)
+        if (isViableTemplePos(&g, xs[i], zs[i]))
+            viable.push_back(i);
+
+    report.micro.push_back(benchmark("applySeed", budget, [&](uint64_t ops)
+                                     {
+        Generator s;
+        setupGenerator(&s, MC_VERSION, 0);
+        for (uint64_t i = 0; i < ops; ++i)
+            applySeed(&s, DIM_OVERWORLD, BENCH_SEED + i);
+        return s.seed; }));
+
+    report.micro.push_back(benchmark("getStructurePos", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        Pos pos;
+        for (uint64_t i = 0; i < ops; ++i)
+        {
+            getStructurePos(Desert_Pyramid, MC_VERSION, BENCH_SEED, (int)(i & 1023), (int)(i >> 10), &pos);
+            acc += pos.x ^ pos.z;
+        }
+        return acc; }));
+
+    report.micro.push_back(benchmark("getFeaturePosBatch", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        int bx[1024], bz[1024];
+        for (uint64_t i = 0; i < ops; i += 1024)
+        {
+            int count = (int)std::min<uint64_t>(1024, ops - i);
+            getFeaturePosBatch(sconf, BENCH_SEED, 0, (int)(i >> 10), 1, 0, count, bx, bz);
+            acc += bx[0] ^ bz[count - 1];
+        }
+        return acc; }));
+
+    report.micro.push_back(benchmark("isViableTemplePos", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+            acc += isViableTemplePos(&g, xs[i % n], zs[i % n]);
+        return acc; }));
+
+    if (!viable.empty())
+    {
+        report.micro.push_back(benchmark("countSwampSpawnBlocks", budget, [&](uint64_t ops)
+                                         {
+            uint64_t acc = 0;
+            for (uint64_t i = 0; i < ops; ++i)
+            {
+                size_t k = viable[i % viable.size()];
+                acc += countSwampSpawnBlocks(&g, xs[k], zs[k], isViableTemplePos(&g, xs[k], zs[k]));
+            }
+            return acc; }));
+    }
+
+    TempleEvaluator eval(&g);
+    report.micro.push_back(benchmark("TempleEvaluator::evaluate", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+            acc += eval.evaluate(xs[i % n], zs[i % n]).swampSpawnBlocks;
+        return acc; }));
+
+    report.micro.push_back(benchmark("TempleEvaluator::evaluate>=1", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+            acc += eval.evaluate(xs[i % n], zs[i % n], MIN_SWAMP_SPAWN_BLOCKS).swampSpawnBlocks;
+        return acc; }));
+
+    FixedTempleEvaluator fixedEval(&g);
+    report.micro.push_back(benchmark("FixedTempleEvaluator::evaluate", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+            acc += fixedEval.evaluate(xs[i % n], zs[i % n]).swampSpawnBlocks;
+        return acc; }));
+
+    report.micro.push_back(benchmark("FixedTempleEvaluator::evaluate>=1", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+            acc += fixedEval.evaluate(xs[i % n], zs[i % n], MIN_SWAMP_SPAWN_BLOCKS).swampSpawnBlocks;
+        return acc; }));
+
+    // Same candidates through the staged pipeline, per candidate at several batch sizes
+    for (int batch : {64, 256, 1024, 4096})
+    {
+        CandidatePipeline<TempleEvaluator> pipeline(eval, batch);
+        const std::string name = "pipeline>=1 batch=" + std::to_string(batch);
+        report.micro.push_back(benchmark(name.c_str(), budget, [&](uint64_t ops)
+                                         {
+            uint64_t acc = 0;
+            for (uint64_t i = 0; i < ops; ++i)
+            {
+                pipeline.add(xs[i % n], zs[i % n]);
+                if (pipeline.space() == 0 || i + 1 == ops)
+                {
+                    acc += pipeline.run(MIN_SWAMP_SPAWN_BLOCKS);
+                    pipeline.clear();
+                }
+            }
+            return acc; }));
+    }
+
+    // Same through a coarse layer cache that stays warm over the passes
+    Generator cachedGen;
+    setupGenerator(&cachedGen, MC_VERSION, 0);
+    applySeed(&cachedGen, DIM_OVERWORLD, BENCH_SEED);
+    CoarseLayerCache layerCache(&cachedGen);
+    TempleEvaluator cachedEval(&cachedGen);
+    report.micro.push_back(benchmark("cached evaluate>=1", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+            acc += cachedEval.evaluate(xs[i % n], zs[i % n], MIN_SWAMP_SPAWN_BLOCKS).swampSpawnBlocks;
+        return acc; }));
+
+    // Same with counters and sampled stage timers, the cost of leaving metrics on
+    ThreadMetrics metrics;
+    TempleEvaluator meteredEval(&g);
+    meteredEval.setMetrics(&metrics);
+    report.micro.push_back(benchmark("evaluate>=1 with metrics", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+            acc += meteredEval.evaluate(xs[i % n], zs[i % n], MIN_SWAMP_SPAWN_BLOCKS).swampSpawnBlocks;
+        return acc; }));
+
+    // Tiled evaluation, the tile is generated again for every pass over the candidates
+    const int regionBlocks = sconf.regionSize * CHUNK_SIZE;
+    BiomeTileStack tiles(&g, side * regionBlocks);
+    TempleEvaluator tiledEval(tiles.generator());
+    report.micro.push_back(benchmark("tiled evaluate>=1", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < ops; ++i)
+        {
+            if (i % n == 0)
+                tiles.loadTile(-side / 2 * regionBlocks, -side / 2 * regionBlocks, side / 2 * regionBlocks - 1, side / 2 * regionBlocks - 1);
+            acc += tiledEval.evaluate(xs[i % n], zs[i % n], MIN_SWAMP_SPAWN_BLOCKS).swampSpawnBlocks;
+        }
+        return acc; }));
+
+    // Upper 16 bits of the seed in lanes for the temples of a 2x2 region square, per seed
+    SeedLaneFilter lanes;
+    const int quadX[4] = {xs[0], xs[1], xs[side], xs[side + 1]};
+    const int quadZ[4] = {zs[0], zs[1], zs[side], zs[side + 1]};
+    lanes.setPositions(quadX, quadZ, 4);
+    report.micro.push_back(benchmark(lanes.vectorized() ? "SeedLaneFilter::filter (avx2)" : "SeedLaneFilter::filter (scalar)", budget, [&](uint64_t ops)
+                                     {
+        uint64_t acc = 0, seeds[SEED_LANES];
+        for (uint64_t i = 0; i < ops; i += SEED_LANES)
+        {
+            for (int k = 0; k < SEED_LANES; ++k)
+                seeds[k] = (BENCH_SEED & MASK48) | (((i + k) & 0xffff) << 48);
+            acc += lanes.filter(seeds);
+        }
+        return acc; }));
+
+    // 1:1 Voronoi of a 256 x 256 area of the seed and a zoom of its 1:4 parent,
+    // per area, scalar and on the widest vector path
+    const int area = 256;
+    const Layer *voronoi = &g.ls.layers[L_VORONOI_1];
+    const int vX = -area / 2 - 2, vZ = -area / 2 - 2;
+    const int pX = vX >> 2, pZ = vZ >> 2;
+    const int pW = ((vX + area) >> 2) - pX + 2, pH = ((vZ + area) >> 2) - pZ + 2;
+    std::vector<int> cells((size_t)5 * pW * pH + (size_t)area * area + mc15VoronoiScratch(pW));
+    genArea(voronoi->p, cells.data(), pX, pZ, pW, pH);
+    int *buf = cells.data() + pW * pH;
+    const Layer *zoom = &g.ls.layers[L_ZOOM_4];
+    for (Mc15Isa isa : {MC15_SCALAR, mc15Isa()})
+    {
+        const std::string name = std::string("voronoi 256x256 (") + mc15IsaName(isa) + ")";
+        report.micro.push_back(benchmark(name.c_str(), budget, [&](uint64_t ops)
+                                         {
+            uint64_t acc = 0;
+            for (uint64_t i = 0; i < ops; ++i)
+            {
+                mc15VoronoiCells(cells.data(), pX, pZ, pW, pH, vX, vZ, area, area, voronoi->startSeed, voronoi->startSalt,
+                                 buf, buf + area * area, isa);
+                acc += buf[i % (area * area)];
+            }
+            return acc; }));
+
+        const std::string zoomName = std::string("zoom 132x132 (") + mc15IsaName(isa) + ")";
+        report.micro.push_back(benchmark(zoomName.c_str(), budget, [&](uint64_t ops)
+                                         {
+            uint64_t acc = 0;
+            for (uint64_t i = 0; i < ops; ++i)
+            {
+                mc15ZoomCells<false>(cells.data(), pX, pZ, pW, pH, (uint32_t)zoom->startSeed, (uint32_t)zoom->startSalt, buf, isa);
+                acc += buf[i % (4 * pW * pH)];
+            }
+            return acc; }));
+        if (isa == MC15_SCALAR && mc15Isa() == MC15_SCALAR)
+            break;
+    }
+}
+
+static void runGoldenChecks(Report &report)
+{
+    Generator g;
+    setupGenerator(&g, MC_VERSION, 0);
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+    const int regionBlocks = sconf.regionSize * CHUNK_SIZE;
+
+    // Every path must give the README score for each listed temple
+    uint64_t checked = 0, bad[6] = {};
+    auto checkTemple = [&](const GoldenTemple &t, uint64_t seed)
+    {
+        applySeed(&g, DIM_OVERWORLD, seed);
+        const TempleScore expected = {t.type, t.score};
+
+        // The listed position is the temple position of its region
+        int regionX = t.x >= 0 ? t.x / regionBlocks : -((-t.x + regionBlocks - 1) / regionBlocks);
+        int regionZ = t.z >= 0 ? t.z / regionBlocks : -((-t.z + regionBlocks - 1) / regionBlocks);
+        int bx, bz;
+        getFeaturePosBatch(sconf, seed, regionX, regionZ, 0, 0, 1, &bx, &bz);
+        bad[0] += bx != t.x || bz != t.z;
+
+        TempleEvaluator eval(&g);
+        FixedTempleEvaluator fixedEval(&g);
+        BiomeTileStack tiles(&g, regionBlocks);
+        TempleEvaluator tiledEval(tiles.generator());
+        tiles.loadTile(regionX * regionBlocks, regionZ * regionBlocks, (regionX + 1) * regionBlocks - 1, (regionZ + 1) * regionBlocks - 1);
+
+        bad[1] += !sameScore(referenceScore(&g, t.x, t.z), expected);
+        bad[2] += !sameScore(eval.evaluate(t.x, t.z), expected) || !sameScore(eval.evaluate(t.x, t.z, std::max(1, t.score)), expected);
+        bad[3] += !sameScore(eval.evaluateExact(t.x, t.z), expected);
+        bad[4] += !sameScore(tiledEval.evaluate(t.x, t.z), expected) || !sameScore(tiledEval.evaluate(t.x, t.z, std::max(1, t.score)), expected);
+        bad[5] += !sameScore(fixedEval.evaluate(t.x, t.z), expected) || !sameScore(fixedEval.evaluate(t.x, t.z, std::max(1, t.score)), expected);
+        ++checked;
+    };
+
+    for (const GoldenTemple &t : GOLDEN_SINGLE)
+        checkTemple(t, (uint64_t)t.seed);
+
+    uint64_t quadTotals = 0;
+    for (int64_t seed : GOLDEN_QUAD_SEEDS)
+    {
+        int total = 0;
+        for (const GoldenTemple &t : GOLDEN_QUAD_TEMPLES)
+        {
+            checkTemple(t, (uint64_t)seed);
+            total += t.score;
+        }
+        quadTotals += total != GOLDEN_QUAD_TOTAL;
+    }
+
+    addCheck(report, "golden temple positions", checked, bad[0]);
+    addCheck(report, "golden reference path", checked, bad[1] + quadTotals);
+    addCheck(report, "golden TempleEvaluator::evaluate", checked, bad[2]);
+    addCheck(report, "golden TempleEvaluator::evaluateExact", checked, bad[3]);
+    addCheck(report, "golden tiled evaluate", checked, bad[4]);
+    addCheck(report, "golden FixedTempleEvaluator::evaluate", checked, bad[5]);
+}
+
+static void runRandomChecks(Report &report)
+{
+    std::mt19937_64 rng(12345);
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+    const int regionBlocks = sconf.regionSize * CHUNK_SIZE;
+    const int thresholds[] = {0, 1, 200, 800};
+
+    Generator g;
+    setupGenerator(&g, MC_VERSION, 0);
+
+    // Cached generator reseeded along with g, small enough to evict within a seed
+    Generator cachedGen;
+    setupGenerator(&cachedGen, MC_VERSION, 0);
+    CoarseLayerCache layerCache(&cachedGen, CoarseLayerCache::MIN_SLABS);
+
+    uint64_t posChecked = 0, posBad = 0;
+    uint64_t evalChecked = 0, evalBad = 0, tiledBad = 0, fixedBad = 0;
+    uint64_t typesChecked = 0, typesBad = 0;
+    uint64_t pipelineChecked = 0, pipelineBad = 0;
+    uint64_t layerChecked = 0, layerBad = 0, cachedBad = 0;
+    for (int s = 0; s < 8; ++s)
+    {
+        uint64_t seed = rng();
+        applySeed(&g, DIM_OVERWORLD, seed);
+        applySeed(&cachedGen, DIM_OVERWORLD, seed);
+
+        // Batched positions against getStructurePos, for every direction and a random origin
+        int rx0 = (int)(rng() % 200000) - 100000, rz0 = (int)(rng() % 200000) - 100000;
+        const int steps[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {3, -2}};
+        for (const auto &step : steps)
+        {
+            int bx[257], bz[257];
+            getFeaturePosBatch(sconf, seed, rx0, rz0, step[0], step[1], 257, bx, bz);
+            for (int i = 0; i < 257; ++i)
+            {
+                Pos pos;
+                getStructurePos(Desert_Pyramid, MC_VERSION, seed, rx0 + i * step[0], rz0 + i * step[1], &pos);
+                posBad += pos.x != bx[i] || pos.z != bz[i];
+                ++posChecked;
+            }
+        }
+
+        // Evaluator and tiled evaluator against the reference on a square of regions
+        const int side = 16;
+        std::vector<int> xs, zs;
+        int tx = (int)(rng() % 20000) - 10000, tz = (int)(rng() % 20000) - 10000;
+        regionPositions(seed, tx, tz, side, xs, zs);
+
+        TempleEvaluator eval(&g);
+        FixedTempleEvaluator fixedEval(&g);
+        BiomeTileStack tiles(&g, side * regionBlocks);
+        TempleEvaluator tiledEval(tiles.generator());
+        tiles.loadTile(tx * regionBlocks, tz * regionBlocks, (tx + side) * regionBlocks - 1, (tz + side) * regionBlocks - 1);
+
+        for (size_t i = 0; i < xs.size(); ++i)
+        {
+            TempleScore ref = referenceScore(&g, xs[i], zs[i]);
+            for (int minScore : thresholds)
+            {
+                evalBad += !consistentWithReference(eval.evaluate(xs[i], zs[i], minScore), ref, minScore);
+                tiledBad += !consistentWithReference(tiledEval.evaluate(xs[i], zs[i], minScore), ref, minScore);
+                fixedBad += !consistentWithReference(fixedEval.evaluate(xs[i], zs[i], minScore), ref, minScore);
+                ++evalChecked;
+            }
+        }
+
+        // Pipeline batches against evaluate(), for single temples and for
+        // groups of 4 against the quad finder's rule: all 4 viable, bounds
+        // summing to minScore, all 4 scored
+        for (int minScore : thresholds)
+        {
+            std::set<std::tuple<int, int, int, int>> expected, actual;
+            for (size_t i = 0; i < xs.size(); ++i)
+            {
+                TempleScore t = eval.evaluate(xs[i], zs[i], minScore);
+                if (t.type)
+                    expected.insert({xs[i], zs[i], t.type, t.swampSpawnBlocks});
+            }
+            CandidatePipeline<TempleEvaluator> pipeline(eval, 100);
+            for (size_t i = 0; i < xs.size(); ++i)
+            {
+                pipeline.add(xs[i], zs[i]);
+                if (pipeline.space() == 0 || i + 1 == xs.size())
+                {
+                    for (int k = pipeline.run(minScore) - 1; k >= 0; --k)
+                        actual.insert({pipeline.xs(k)[0], pipeline.zs(k)[0], pipeline.templeScores(k)[0].type, pipeline.templeScores(k)[0].swampSpawnBlocks});
+                    pipeline.clear();
+                }
+            }
+            pipelineBad += expected != actual;
+
+            CandidatePipeline<TempleEvaluator> quads(eval, 4, 4);
+            for (size_t q = 0; q + 4 <= xs.size(); q += 4)
+            {
+                int total = 0, maxTotal = 0;
+                bool viable = true;
+                for (size_t j = q; j < q + 4; ++j)
+                {
+                    TempleBound b = eval.bound(xs[j], zs[j]);
+                    TempleScore t = b.maxScore < 0 ? TempleScore{0, 0} : b.exact.type ? b.exact : eval.evaluateExact(xs[j], zs[j]);
+                    viable &= b.maxScore >= 0 && t.type != 0;
+                    maxTotal += b.maxScore;
+                    total += t.swampSpawnBlocks;
+                }
+                quads.clear();
+                for (size_t j = q; j < q + 4; ++j)
+                    quads.add(xs[j], zs[j]);
+                const int kept = quads.run(minScore);
+                pipelineBad += kept != (viable && maxTotal >= minScore) || (kept && quads.total(0) != total);
+                ++pipelineChecked;
+            }
+            pipelineChecked += xs.size();
+        }
+
+        // Evaluators instantiated for every other set of temple types against
+        // the reference restricted to the same set
+        for (int types = 1; types < SELECTED_TEMPLE_TYPES; ++types)
+        {
+            withTempleTypes(types, [&](auto templeTypes)
+                            {
+                FixedTempleEvaluatorFor<decltype(templeTypes)::value> typesEval(&g);
+                for (size_t i = 0; i < xs.size(); i += 4)
+                {
+                    TempleScore ref = referenceScore(&g, xs[i], zs[i], types);
+                    for (int minScore : thresholds)
+                    {
+                        typesBad += !consistentWithReference(typesEval.evaluate(xs[i], zs[i], minScore), ref, minScore);
+                        ++typesChecked;
+                    }
+                } });
+        }
+
+        // Every stage of the fixed layers and of the cached stack against the
+        // layer stack on random areas, cell by cell
+        GeneratorLayers stack(&g, QUERY_Y), cached(&cachedGen, QUERY_Y);
+        FixedTempleEvaluator::LayerBackend fixed(&g, QUERY_Y);
+        std::vector<int> expected, actual;
+        for (int a = 0; a < 64; ++a)
+        {
+            const int stage = a % CS_NUM, w = 1 + (int)(rng() % 40), h = 1 + (int)(rng() % 40);
+            const int scale = stage == CS_1 ? 1 : 4 << (2 * (CS_4 - stage));
+            const int x = (int)(rng() % 400000 / scale) - 200000 / scale, z = (int)(rng() % 400000 / scale) - 200000 / scale;
+            expected.assign(stack.cacheSize(stage, w, h), 0);
+            actual.assign(fixed.cacheSize(stage, w, h), 0);
+            stack.gen(stage, expected.data(), x, z, w, h);
+            fixed.gen(stage, actual.data(), x, z, w, h);
+            for (int i = 0; i < w * h; ++i)
+                layerBad += expected[i] != actual[i];
+            actual.assign(cached.cacheSize(stage, w, h), 0);
+            cached.gen(stage, actual.data(), x, z, w, h);
+            for (int i = 0; i < w * h; ++i)
+                cachedBad += expected[i] != actual[i];
+            layerChecked += w * h;
+        }
+    }
+
+    // Seed lanes against genArea at 1:16 for batches of upper bits, a temple
+    // passes the stages before 1:4 iff its center area there has a temple biome
+    SeedLaneFilter lanes;
+    const Layer *entry = getLayerForScale(&g, BIOME_QUERY_SCALE);
+    const Layer *last = cascadeStageLayer(&g, SEED_LANE_RESUME_STAGE - 1);
+    std::vector<int> cells(getMinLayerCacheSize(last, 8, 8));
+    uint64_t laneChecked = 0, laneBad = 0;
+    for (int b = 0; b < 64; ++b)
+    {
+        const uint64_t s48 = rng() & MASK48;
+        const int temples = 1 + b % SEED_LANE_MAX_TEMPLES;
+        int px[SEED_LANE_MAX_TEMPLES], pz[SEED_LANE_MAX_TEMPLES];
+        for (int j = 0; j < temples; ++j)
+        {
+            px[j] = (int)(rng() % 200000) - 100000;
+            pz[j] = (int)(rng() % 200000) - 100000;
+        }
+        lanes.setPositions(px, pz, temples);
+
+        for (int batch = 0; batch < 16; ++batch)
+        {
+            uint64_t seeds[SEED_LANES];
+            for (int k = 0; k < SEED_LANES; ++k)
+                seeds[k] = s48 | (rng() << 48);
+            const uint32_t survivors = lanes.filter(seeds);
+
+            for (int k = 0; k < SEED_LANES; ++k)
+            {
+                applySeed(&g, DIM_OVERWORLD, seeds[k]);
+                bool pass = true;
+                for (int j = 0; j < temples && pass; ++j)
+                {
+                    int x0 = px[j] + HALF_CHUNK, x1 = x0, z0 = pz[j] + HALF_CHUNK, z1 = z0;
+                    mapIntervalToLayer(entry, last, x0, x1);
+                    mapIntervalToLayer(entry, last, z0, z1);
+                    genArea(last, cells.data(), x0, z0, x1 - x0 + 1, z1 - z0 + 1);
+                    int types = 0;
+                    for (int i = 0; i < (x1 - x0 + 1) * (z1 - z0 + 1); ++i)
+                        types |= templeTypeForBiome(cells[i]) ? 1 << templeTypeForBiome(cells[i]) : 0;
+                    pass = types != 0;
+                    laneBad += pass && (survivors & (1u << k)) && lanes.candidateTypes(k, j) != types;
+                }
+                laneBad += pass != ((survivors & (1u << k)) != 0);
+                ++laneChecked;
+            }
+        }
+    }
+
+    addCheck(report, "random getFeaturePosBatch", posChecked, posBad);
+    addCheck(report, "random TempleEvaluator::evaluate", evalChecked, evalBad);
+    addCheck(report, "random tiled evaluate", evalChecked, tiledBad);
+    addCheck(report, "random FixedTempleEvaluator::evaluate", evalChecked, fixedBad);
+    addCheck(report, "random evaluate per temple types", typesChecked, typesBad);
+    addCheck(report, "random candidate pipeline", pipelineChecked, pipelineBad);
+    addCheck(report, "random fixed layers cells", layerChecked, layerBad);
+    addCheck(report, "random layer cache cells", layerChecked, cachedBad);
+    addCheck(report, lanes.vectorized() ? "random seed lanes (avx2)" : "random seed lanes (scalar)", laneChecked, laneBad);
+}
+
+// Parent cells for the layer kernels: runs of a few biomes, so that both
+// uniform and mixed cells come up, with every biome the kernels single out
+static void randomParent(std::mt19937_64 &rng, int *out, int w, int h)
+{
+    static const int PALETTE[] = {ocean, plains, desert, mountains, forest, swamp, river, mushroom_fields, jungle};
+    for (int j = 0; j < h; ++j)
+    {
+        for (int i = 0; i < w; ++i)
+        {
+            const uint64_t r = rng() % 100;
+            if (i > 0 && r < 60)
+                out[i + j * w] = out[i - 1 + j * w];
+            else if (j > 0 && r < 85)
+                out[i + j * w] = out[i + (j - 1) * w];
+            else
+                out[i + j * w] = PALETTE[rng() % (sizeof(PALETTE) / sizeof(PALETTE[0]))];
+        }
+    }
+}
+
+// Renderer: the tiles of an image, some of them clipped, must match one
+// genBiomes() call over the whole area
+static void runRenderChecks(Report &report)
+{
+    std::mt19937_64 rng(11);
+    Generator g;
+    setupGenerator(&g, MC_VERSION, 0);
+    std::vector<int> cache(getMinCacheSize(&g, 1, RENDER_TILE, 1, RENDER_TILE));
+    uint64_t checked = 0, bad = 0;
+    for (int round = 0; round < 4; ++round)
+    {
+        applySeed(&g, DIM_OVERWORLD, rng());
+        FoundResult r = {0, 0, 1, {{1 + (int)(rng() % 3), 0, (int)(rng() % 200000) - 100000, (int)(rng() % 200000) - 100000}}};
+        const RenderArea area = renderArea(r, 300);
+        std::vector<int> tiled((size_t)area.size * area.size);
+        for (int t = 0; t < area.tiles(); ++t)
+            bad += renderTile(&g, cache.data(), area, t, QUERY_Y, tiled.data()) != 0;
+
+        Range whole = {1, area.x0, area.z0, area.size, area.size, QUERY_Y, 1};
+        int *expected = allocCache(&g, whole);
+        genBiomes(&g, expected, whole);
+        for (size_t i = 0; i < tiled.size(); ++i)
+            bad += tiled[i] != expected[i];
+        checked += tiled.size();
+        free(expected);
+    }
+    addCheck(report, "render tiles", checked, bad);
+}
+
+// SIMD layer kernels against the scalar ones, on random seeds, areas and
+// parent cells, for every path the CPU supports
+static void runLayerKernelChecks(Report &report)
+{
+    std::vector<Mc15Isa> isas;
+#if SEEDFINDER_X86
+    if (cpuHasSse41())
+        isas.push_back(MC15_SSE41);
+    if (cpuHasAvx2())
+        isas.push_back(MC15_AVX2);
+#endif
+
+    for (Mc15Isa isa : isas)
+    {
+        std::mt19937_64 rng(9090);
+        uint64_t checked = 0, bad = 0;
+        std::vector<int> ref, got;
+        auto compare = [&](size_t n)
+        {
+            checked += n;
+            for (size_t k = 0; k < n; ++k)
+                bad += ref[k] != got[k];
+        };
+
+        for (int trial = 0; trial < 300; ++trial)
+        {
+            const uint64_t ss = rng(), st = rng();
+            const int x = (int)(rng() % 2001) - 1000, z = (int)(rng() % 2001) - 1000;
+            const int w = 1 + (int)(rng() % 70), h = 1 + (int)(rng() % 70);
+
+            // mapVoronoi114(), area already moved by -2
+            const int pX = x >> 2, pZ = z >> 2;
+            const int pW = ((x + w) >> 2) - pX + 2, pH = ((z + h) >> 2) - pZ + 2;
+            ref.assign((size_t)pW * pH + (size_t)w * h + mc15VoronoiScratch(pW), 0);
+            randomParent(rng, ref.data(), pW, pH);
+            got = ref;
+            int *refBuf = ref.data() + pW * pH, *gotBuf = got.data() + pW * pH;
+            mc15VoronoiCells(ref.data(), pX, pZ, pW, pH, x, z, w, h, ss, st, refBuf, refBuf + w * h, MC15_SCALAR);
+            mc15VoronoiCells(got.data(), pX, pZ, pW, pH, x, z, w, h, ss, st, gotBuf, gotBuf + w * h, isa);
+            compare((size_t)pW * pH + (size_t)w * h);
+
+            // mapZoom() and mapZoomFuzzy() on a parent of about the same size
+            const int zW = 1 + w / 2, zH = 1 + h / 2;
+            for (int fuzzy = 0; fuzzy < 2; ++fuzzy)
+            {
+                ref.assign((size_t)5 * zW * zH, 0);
+                randomParent(rng, ref.data(), zW, zH);
+                got = ref;
+                if (fuzzy)
+                {
+                    mc15ZoomCells<true>(ref.data(), pX, pZ, zW, zH, (uint32_t)ss, (uint32_t)st, ref.data() + zW * zH, MC15_SCALAR);
+                    mc15ZoomCells<true>(got.data(), pX, pZ, zW, zH, (uint32_t)ss, (uint32_t)st, got.data() + zW * zH, isa);
+                }
+                else
+                {
+                    mc15ZoomCells<false>(ref.data(), pX, pZ, zW, zH, (uint32_t)ss, (uint32_t)st, ref.data() + zW * zH, MC15_SCALAR);
+                    mc15ZoomCells<false>(got.data(), pX, pZ, zW, zH, (uint32_t)ss, (uint32_t)st, got.data() + zW * zH, isa);
+                }
+                // Without the last row and column, see mc15ZoomCells()
+                checked += (size_t)(2 * zW - 1) * (2 * zH - 1);
+                for (int j = 0; j < 2 * zH - 1; ++j)
+                    for (int i = 0; i < 2 * zW - 1; ++i)
+                        bad += ref[zW * zH + j * 2 * zW + i] != got[zW * zH + j * 2 * zW + i];
+            }
+
+            // mapSmooth() and mapShore() in place
+            for (int shore = 0; shore < 2; ++shore)
+            {
+                ref.assign((size_t)(w + 2) * (h + 2), 0);
+                randomParent(rng, ref.data(), w + 2, h + 2);
+                got = ref;
+                if (shore)
+                {
+                    mc15ShoreCells(ref.data(), w, h, MC15_SCALAR);
+                    mc15ShoreCells(got.data(), w, h, isa);
+                }
+                else
+                {
+                    mc15SmoothCells(ref.data(), x, z, w, h, ss, MC15_SCALAR);
+                    mc15SmoothCells(got.data(), x, z, w, h, ss, isa);
+                }
+                compare((size_t)w * h);
+            }
+        }
+
+        const std::string name = std::string("random layer kernels (") + mc15IsaName(isa) + ")";
+        addCheck(report, name.c_str(), checked, bad);
+    }
+}
+
+// Binary result files: appending over two sessions with a torn record in
+// between, reading back through the mapping, and merging with duplicates
+static void runResultFileChecks(Report &report)
+{
+    std::mt19937_64 rng(777);
+    const std::string path = (std::filesystem::temp_directory_path() / "seedfinder_bench_results.bin").string();
+    std::filesystem::remove(path);
+
+    ResultFileHeader header = {};
+    memcpy(header.magic, RESULT_FILE_MAGIC, sizeof(header.magic));
+    header.version = RESULT_FILE_VERSION;
+    header.recordSize = sizeof(ResultRecord);
+    header.finder = RF_QUAD;
+    header.startSeed = 42;
+
+    // Quads of 4 records, the second session repeats some of the first
+    std::vector<ResultRecord> written;
+    auto appendQuads = [&](ResultFileWriter &w, int quads, bool repeat)
+    {
+        for (int q = 0; q < quads; ++q)
+        {
+            if (repeat && q % 3 == 0)
+            {
+                size_t first = (size_t)(rng() % (written.size() / 4)) * 4;
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    ResultRecord r = written[first + j];
+                    w.append(r);
+                    written.push_back(r);
+                }
+                continue;
+            }
+            int64_t seed = (int64_t)(rng() >> 16);
+            int scores[4], total = 0;
+            for (int &sc : scores)
+                total += sc = (int)(rng() % 700);
+            for (int j = 0; j < 4; ++j)
+            {
+                ResultRecord r = {seed, (int)(rng() % 20000) - 10000, (int)(rng() % 20000) - 10000, scores[j], total, (uint8_t)(1 + j % 3), RF_QUAD, (uint8_t)j, 4, 0};
+                w.append(r);
+                written.push_back(r);
+            }
+        }
+    };
+
+    uint64_t fileBad = 0;
+    {
+        ResultFileWriter w;
+        fileBad += !w.open(path, header);
+        appendQuads(w, 1500, false);
+    }
+    {
+        FILE *fp = fopen(path.c_str(), "ab");
+        fileBad += !fp || fwrite("torn", 1, 4, fp) != 4;
+        if (fp)
+            fclose(fp);
+    }
+    {
+        ResultFileWriter w;
+        header.startSeed = 43;
+        fileBad += !w.open(path, header);
+        appendQuads(w, 600, true);
+    }
+
+    std::vector<MappedResultFile> files(1);
+    fileBad += !files[0].open(path);
+    fileBad += files[0].size() != written.size() || files[0].header().startSeed != 42;
+    for (size_t i = 0; i < std::min(files[0].size(), written.size()); ++i)
+        fileBad += memcmp(&files[0].records()[i], &written[i], sizeof(ResultRecord)) != 0;
+    addCheck(report, "result file roundtrip", written.size(), fileBad);
+
+    // Deduplicated top-K against a set of the distinct quads
+    std::set<std::tuple<int, int64_t, int, int>> quads; // (-total, seed, x, z) of temple 0
+    for (size_t i = 0; i < written.size(); i += 4)
+        quads.insert({-written[i].total, written[i].seed, written[i].x, written[i].z});
+
+    uint64_t selectBad = 0;
+    ResultQuery query;
+    selectBad += selectResults(files, query).size() != 4 * quads.size();
+    query.topK = 100;
+    std::vector<const ResultRecord *> top = selectResults(files, query);
+    selectBad += top.size() != 4 * query.topK;
+    auto expected = quads.begin();
+    for (size_t i = 0; i + 3 < top.size(); i += 4, ++expected)
+    {
+        selectBad += top[i]->index != 0 || -top[i]->total != std::get<0>(*expected) || top[i]->seed != std::get<1>(*expected);
+        for (int j = 1; j < 4; ++j)
+            selectBad += top[i + j]->seed != top[i]->seed || top[i + j]->index != j;
+    }
+    query.order = RO_SEED;
+    top = selectResults(files, query);
+    for (size_t i = 1; i < top.size(); ++i)
+        selectBad += top[i]->seed < top[i - 1]->seed;
+    addCheck(report, "result file select", quads.size(), selectBad);
+    files.clear();
+
+    // Pairs with the same seed and total must not interleave. The first file
+    // holds the two tied pairs, the second repeats one and adds a weaker pair.
+    const std::vector<std::vector<ResultRecord>> pairs = {
+        {{7, 600, 0, 300, 800, 1, RF_LOCATION, 0, 2, 0}, {7, 700, 0, 500, 800, 3, RF_LOCATION, 1, 2, 0}},
+        {{7, 100, 0, 400, 800, 3, RF_LOCATION, 0, 2, 0}, {7, 900, 0, 400, 800, 2, RF_LOCATION, 1, 2, 0}},
+        {{7, 200, 0, 100, 200, 3, RF_LOCATION, 0, 2, 0}, {7, 300, 0, 100, 200, 3, RF_LOCATION, 1, 2, 0}},
+    };
+    const std::string tiedPath = path + ".tied";
+    uint64_t tiedBad = 0;
+    const std::pair<const std::string *, std::vector<size_t>> tiedFiles[2] = {{&path, {0, 1}}, {&tiedPath, {0, 2}}};
+    for (const auto &[filePath, kept] : tiedFiles)
+    {
+        std::filesystem::remove(*filePath);
+        ResultFileWriter w;
+        tiedBad += !w.open(*filePath, header);
+        for (size_t p : kept)
+            for (const ResultRecord &r : pairs[p])
+                w.append(r);
+    }
+    files.resize(2);
+    tiedBad += !files[0].open(path) || !files[1].open(tiedPath);
+
+    // Each result is its index 0 record followed by its own index 1 record
+    auto contiguous = [&](const std::vector<const ResultRecord *> &sel, size_t results)
+    {
+        uint64_t bad = sel.size() != 2 * results;
+        for (size_t i = 0; i + 1 < sel.size(); i += 2)
+        {
+            const std::vector<ResultRecord> *match = nullptr;
+            for (const std::vector<ResultRecord> &pair : pairs)
+                if (memcmp(&pair[0], sel[i], sizeof(ResultRecord)) == 0)
+                    match = &pair;
+            bad += !match || memcmp(&(*match)[1], sel[i + 1], sizeof(ResultRecord)) != 0;
+        }
+        return bad;
+    };
+    ResultQuery tied;
+    tiedBad += contiguous(selectResults(files, tied), 3);
+    tied.order = RO_SEED;
+    tiedBad += contiguous(selectResults(files, tied), 3);
+    tied.dedup = false;
+    tiedBad += contiguous(selectResults(files, tied), 4);
+    tied = {};
+    tied.topK = 1;
+    tiedBad += contiguous(selectResults(files, tied), 1);
+    addCheck(report, "result file select tied totals", pairs.size(), tiedBad);
+
+    files.clear();
+    std::filesystem::remove(path);
+    std::filesystem::remove(tiedPath);
+}
+
+// Result collector: a temple type whose results only come in after the
+// overall threshold has risen past them still gets its own top-K
+static void runResultCollectorChecks(Report &report)
+{
+    const std::string dir = (std::filesystem::temp_directory_path() / "seedfinder_bench_collector").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    FinderOptions opt;
+    opt.topK = 4;
+    opt.templeTypes = TT_DESERT | TT_JUNGLE;
+    opt.resultsPath = dir + "/results.bin";
+    uint64_t bad = 0;
+    {
+        ResultCollector results(opt, RF_LOCATION, (dir + "/results.log").c_str(), "", opt.resultsPath.c_str(),
+                                (dir + "/histogram.csv").c_str(), 1);
+        for (int i = 0; i < 40; ++i)
+            results.submit(0, {0, 500 + i, 1, {{1, 500 + i, 16 * i, 0}}});
+        results.sync();
+        for (int i = 0; i < 10; ++i)
+            results.submit(0, {0, 100 + i, 1, {{2, 100 + i, 16 * i, 512}}});
+        results.sync();
+        bad += results.threshold(1) != 536;
+        bad += results.threshold(2) != 106;
+        bad += results.threshold() != 106;
+        results.stop();
+    }
+
+    std::vector<MappedResultFile> files(1);
+    uint64_t jungle = 0;
+    if (files[0].open(opt.resultsPath))
+        for (const ResultRecord *r : selectResults(files, {}))
+            jungle += r->type == 2;
+    addCheck(report, "result collector per-type top-K", 3, bad + (jungle != 10));
+    std::filesystem::remove_all(dir);
+}
+
+// Quad base cache: the mapped list must equal the saved one, and a file for
+// another low bit table or a truncated file must be refused
+static void runQuadBaseCacheChecks(Report &report)
+{
+    std::mt19937_64 rng(4242);
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+    const QuadBaseKey key = quadBaseKey(MC_VERSION, sconf, QUAD_BASE_RADIUS, low20QuadIdeal, 20);
+    const QuadBaseKey otherKey = quadBaseKey(MC_VERSION, sconf, QUAD_BASE_RADIUS, low20QuadClassic, 20);
+    const std::string path = (std::filesystem::temp_directory_path() / "seedfinder_bench_quad_bases.bin").string();
+
+    std::vector<uint64_t> bases(5000);
+    for (uint64_t &b : bases)
+        b = rng() & MASK48;
+    std::sort(bases.begin(), bases.end());
+
+    uint64_t bad = !saveQuadBases(path, key, bases.data(), bases.size());
+    {
+        QuadBaseCache cache;
+        bad += !cache.open(path, key) || cache.count() != bases.size() ||
+               memcmp(cache.bases(), bases.data(), bases.size() * sizeof(uint64_t)) != 0;
+        QuadBaseCache other;
+        bad += other.open(path, otherKey);
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    {
+        QuadBaseCache truncated;
+        bad += truncated.open(path, key);
+    }
+    addCheck(report, "quad base cache", bases.size(), bad);
+    std::filesystem::remove(path);
+}
+
+// Random 48-bit values around the README quad base, which is at index golden
+static std::vector<uint64_t> quadBasesWithDecoys(uint64_t count, uint64_t golden)
+{
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+    std::mt19937_64 rng(777);
+    std::vector<uint64_t> bases(count);
+    for (uint64_t &b : bases)
+        b = rng() & MASK48;
+    bases[golden] = (moveStructure((uint64_t)GOLDEN_QUAD_SEEDS[0] & MASK48, 1, 1) + sconf.salt) & MASK48;
+    return bases;
+}
+
+// Quad base ranking: a permutation, in rank order, with the README quad base
+// ahead of every base that is no quad base at all
+static void runQuadBaseOrderChecks(Report &report)
+{
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+    const uint64_t count = 4096, golden = 1234;
+    const std::vector<uint64_t> bases = quadBasesWithDecoys(count, golden);
+    const std::vector<uint64_t> order = rankQuadBases(sconf, bases.data(), count, SELECTED_TEMPLE_TYPES);
+
+    uint64_t bad = order.size() != count;
+    std::vector<char> seen(count, 0);
+    bool goldenSeen = false;
+    for (uint64_t k = 0; k < order.size(); ++k)
+    {
+        const QuadBaseRank rank = rankQuadBase(sconf, bases[order[k]], SELECTED_TEMPLE_TYPES);
+        bad += order[k] >= count || seen[order[k]]++;
+        if (k > 0)
+            bad += rankedBefore(rank, rankQuadBase(sconf, bases[order[k - 1]], SELECTED_TEMPLE_TYPES));
+        bad += !goldenSeen && rank.radius == 0;
+        goldenSeen |= order[k] == golden;
+    }
+    addCheck(report, "quad base ranking", count, bad);
+}
+
+// Cluster index: streamed row by row it must report the same clusters as with
+// every temple added up front, hold only a few rows at once, and report for
+// every pair that fits a cluster at least as good in the pair's window. The
+// README quad must come out as one 4 temple cluster.
+static void runTempleClusterChecks(Report &report)
+{
+    StructureConfig sconf;
+    getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+    const int side = 64, regionBlocks = sconf.regionSize * CHUNK_SIZE;
+    std::mt19937_64 rng(23);
+    std::vector<FoundTemple> temples;
+    for (int rz = 0; rz < side; ++rz)
+    {
+        for (int rx = 0; rx < side; ++rx)
+        {
+            const Pos p = getFeaturePos(sconf, BENCH_SEED, rx, rz);
+            temples.push_back({1 + (int)(rng() % 3), 1 + (int)(rng() % 400), p.x, p.z});
+        }
+    }
+
+    // Best score reported per window, keyed by the lowest region of the cluster
+    auto windowOf = [&](const FoundTemple &t)
+    { return std::make_pair(t.x / regionBlocks, t.z / regionBlocks); };
+    using Found = std::map<std::pair<int, int>, int>;
+    auto collect = [&](Found &found)
+    {
+        return [&](const TempleCluster &c)
+        {
+            std::pair<int, int> w = windowOf(c.result.temples[0]);
+            for (int i = 1; i < c.result.count; ++i)
+                w = {std::min(w.first, windowOf(c.result.temples[i]).first), std::min(w.second, windowOf(c.result.temples[i]).second)};
+            found[w] = c.result.score;
+        };
+    };
+
+    Found streamed, upFront;
+    TempleClusterIndex rows(BENCH_SEED, regionBlocks, [&](int, int rz) -> uint64_t
+                            { return rz < 0 || rz >= side ? 0 : (uint64_t)rz; });
+    size_t peak = 0;
+    for (int rz = 0; rz < side; ++rz)
+    {
+        for (int rx = 0; rx < side; ++rx)
+            rows.add(temples[rz * side + rx]);
+        rows.complete(rz, collect(streamed));
+        peak = std::max(peak, rows.peakTemples());
+    }
+    rows.finish(collect(streamed));
+
+    TempleClusterIndex all(BENCH_SEED, regionBlocks, [](int, int) -> uint64_t
+                           { return 0; });
+    for (const FoundTemple &t : temples)
+        all.add(t);
+    all.finish(collect(upFront));
+
+    uint64_t pairs = 0, bad = streamed != upFront || streamed.empty() || peak > 3 * (size_t)side;
+    for (size_t i = 0; i < temples.size(); ++i)
+    {
+        for (size_t j = i + 1; j < temples.size(); ++j)
+        {
+            const FoundTemple *t[2] = {&temples[i], &temples[j]};
+            Pos afk;
+            int score;
+            if (!TempleClusterIndex::fits(t, 2, afk, score))
+                continue;
+            ++pairs;
+            const std::pair<int, int> w = {std::min(windowOf(temples[i]).first, windowOf(temples[j]).first),
+                                           std::min(windowOf(temples[i]).second, windowOf(temples[j]).second)};
+            auto it = streamed.find(w);
+            bad += it == streamed.end() || it->second < score;
+        }
+    }
+
+    // The README quad sticks out of the sphere at its corners, but is still the
+    // best cluster of its window
+    TempleClusterIndex golden(GOLDEN_QUAD_SEEDS[0], regionBlocks, [](int, int) -> uint64_t
+                              { return 0; });
+    for (const GoldenTemple &t : GOLDEN_QUAD_TEMPLES)
+        golden.add({t.type, t.score, t.x, t.z});
+    TempleCluster quad;
+    golden.finish([](const TempleCluster &) {});
+    bad += !golden.bestCluster(quad) || quad.result.count != 4 || golden.clusters(4) != 1 ||
+           quad.result.score <= 0 || quad.result.score > GOLDEN_QUAD_TOTAL;
+    printf("[CLUSTERS] golden quad: swamp-spawn-blocks in reach=%d of %d, afk=(%d, %d)\n", quad.result.score,
+           GOLDEN_QUAD_TOTAL, quad.afk.x, quad.afk.z);
+    addCheck(report, "temple cluster index", pairs + 1, bad + (pairs == 0));
+}
+
+// Task engine: every ticket is run exactly once, nothing below lowWater() is
+// ever missing, and an interrupted run resumed from lowWater() completes the
+// range (redoing only tickets above the frontier)
+static void runTaskEngineChecks(Report &report)
+{
+    const uint64_t tickets = 20000, stopAfter = 7000;
+    const unsigned int workers = 4;
+    std::vector<std::atomic<uint32_t>> runs(tickets);
+    std::atomic<uint64_t> processed{0}, bad{0};
+
+    auto body = [&](TaskEngine &engine, unsigned int w)
+    {
+        uint64_t ticket, verified = 0;
+        while (engine.next(w, ticket))
+        {
+            // Uneven items, so chunks and steals differ between workers
+            volatile uint64_t spin = 0;
+            for (uint64_t i = 0; i < (ticket % 13) * 300; ++i)
+                spin += i;
+            runs[ticket].fetch_add(1);
+            if (processed.fetch_add(1) + 1 == stopAfter)
+                interruptRequested.store(true);
+
+            if (w == 0)
+                for (uint64_t low = engine.lowWater(); verified < low; ++verified)
+                    bad += runs[verified].load() == 0;
+        }
+    };
+
+    TaskEngine first(workers, 0, tickets);
+    first.run([&](unsigned int w)
+              { body(first, w); });
+    const uint64_t frontier = first.lowWater();
+    interruptRequested.store(false);
+    for (uint64_t t = 0; t < frontier; ++t)
+        bad += runs[t].load() != 1;
+
+    TaskEngine resumed(workers, frontier, tickets);
+    resumed.run([&](unsigned int w)
+                { body(resumed, w); });
+    for (uint64_t t = 0; t < tickets; ++t)
+        bad += runs[t].load() == 0 || runs[t].load() > (t < frontier ? 1u : 2u);
+    bad += resumed.lowWater() != tickets || frontier >= tickets;
+
+    TaskEngine::Stats stats = resumed.statistics();
+    printf("[ENGINE] interrupted at %llu/%llu, resumed: chunks=%llu steals=%llu\n", (unsigned long long)frontier,
+           (unsigned long long)tickets, (unsigned long long)stats.chunks, (unsigned long long)stats.steals);
+    addCheck(report, "task engine tickets", tickets, bad);
+}
+
+// Query server: a request file through run_query_server() must be answered
+// in order, area requests with every viable temple of the rectangle (as the
+// reference path scores it) and temple requests with the golden scores
+static void runQueryServerChecks(Report &report)
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string inPath = (dir / "seedfinder_bench_serve_in.txt").string();
+    const std::string outPath = (dir / "seedfinder_bench_serve_out.txt").string();
+    const int64_t areaSeeds[] = {(int64_t)BENCH_SEED, 28257};
+    const int side = 12, regionBlocks = 512;
+
+    Generator g;
+    setupGenerator(&g, MC_VERSION, 0);
+    std::vector<std::string> expected;
+    std::vector<int> xs, zs;
+
+    FILE *in = fopen(inPath.c_str(), "w");
+    if (!in)
+    {
+        addCheck(report, "query server answers", 1, 1);
+        return;
+    }
+    uint64_t id = 0;
+    fprintf(in, "ping\n");
+    expected.push_back("pong " + std::to_string(++id));
+
+    fprintf(in, "area %lld,%lld %d %d %d %d\n", (long long)areaSeeds[0], (long long)areaSeeds[1], -side / 2 * regionBlocks,
+            -side / 2 * regionBlocks, side / 2 * regionBlocks - 1, side / 2 * regionBlocks - 1);
+    ++id;
+    uint64_t areaTemples = 0;
+    for (int64_t seed : areaSeeds)
+    {
+        applySeed(&g, DIM_OVERWORLD, (uint64_t)seed);
+        regionPositions((uint64_t)seed, -side / 2, -side / 2, side, xs, zs);
+        for (size_t i = 0; i < xs.size(); ++i)
+        {
+            TempleScore ref = referenceScore(&g, xs[i], zs[i]);
+            if (!ref.type)
+                continue;
+            char line[160];
+            snprintf(line, sizeof(line), "temple %llu %lld %s %d %d %d", (unsigned long long)id, (long long)seed,
+                     templeTypeName(ref.type), xs[i], zs[i], ref.swampSpawnBlocks);
+            expected.push_back(line);
+            ++areaTemples;
+        }
+    }
+    expected.push_back("end " + std::to_string(id) + " " + std::to_string(areaTemples));
+
+    fprintf(in, "bogus request\n");
+    expected.push_back("error " + std::to_string(++id));
+    fprintf(in, "area 1 0 0 9 9 abc\n");
+    expected.push_back("error " + std::to_string(++id));
+    fprintf(in, "area 1 0 0 9 9 12x\n");
+    expected.push_back("error " + std::to_string(++id));
+    fprintf(in, "temple 1,99999999999999999999 0 0\n");
+    expected.push_back("error " + std::to_string(++id));
+
+    for (const GoldenTemple &t : GOLDEN_SINGLE)
+    {
+        if (!(templeTypeBit(t.type) & SELECTED_TEMPLE_TYPES) || !t.score)
+            continue;
+        fprintf(in, "temple %lld %d %d\n", (long long)t.seed, t.x, t.z);
+        char line[160];
+        snprintf(line, sizeof(line), "temple %llu %lld %s %d %d %d", (unsigned long long)++id, (long long)t.seed,
+                 templeTypeName(t.type), t.x, t.z, t.score);
+        expected.push_back(line);
+        expected.push_back("end " + std::to_string(id) + " 1");
+    }
+    fprintf(in, "quit\nping\n");
+    fclose(in);
+
+    FinderOptions opt;
+    opt.threads = 2;
+    in = fopen(inPath.c_str(), "r");
+    FILE *out = fopen(outPath.c_str(), "w+");
+    uint64_t bad = !in || !out;
+    if (!bad)
+    {
+        bad += run_query_server(opt, fileno(in), fileno(out)) != 0;
+
+        // Error messages are free text, only their prefix is compared
+        std::vector<std::string> answers;
+        rewind(out);
+        char line[256];
+        while (fgets(line, sizeof(line), out))
+        {
+            std::string answer(line);
+            while (!answer.empty() && answer.back() == '\n')
+                answer.pop_back();
+            if (answer.rfind("error ", 0) == 0)
+                answer = answer.substr(0, answer.find(' ', 6));
+            answers.push_back(answer);
+        }
+        bad += answers.size() != expected.size();
+        for (size_t i = 0; i < std::min(answers.size(), expected.size()); ++i)
+            bad += answers[i] != expected[i];
+    }
+    if (in)
+        fclose(in);
+    if (out)
+        fclose(out);
+    addCheck(report, "query server answers", expected.size(), bad);
+    std::filesystem::remove(inPath);
+    std::filesystem::remove(outPath);
+}
+
+#if !defined(_WIN32)
+// Connects to a Unix socket, retrying while the server starts
+static int connectUnix(const std::string &path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+    for (int attempt = 0; attempt < 500; ++attempt)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+            return fd;
+        if (fd >= 0)
+            close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+// Query server on a socket: a client closing before its answer arrives only
+// ends its own connection, the next client is still served
+static void runQueryServerSocketChecks(Report &report)
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "seedfinder_bench_serve.sock").string();
+    FinderOptions opt;
+    opt.threads = 2;
+    opt.socketPath = path;
+    int rc = -1;
+    std::thread server([&]()
+                       { rc = run_query_server(opt); });
+
+    uint64_t bad = 0;
+    int fd = connectUnix(path);
+    bad += fd < 0;
+    if (fd >= 0)
+    {
+        const std::string area = "area 1,2,3,4 -16384 -16384 16383 16383\n";
+        bad += write(fd, area.data(), area.size()) != (ssize_t)area.size();
+        close(fd);
+    }
+
+    fd = connectUnix(path);
+    bad += fd < 0;
+    if (fd >= 0)
+    {
+        const std::string ping = "ping\n";
+        bad += write(fd, ping.data(), ping.size()) != (ssize_t)ping.size();
+        std::string answer;
+        char c;
+        pollfd p = {fd, POLLIN, 0};
+        while (answer.find('\n') == std::string::npos && poll(&p, 1, 10000) > 0 && read(fd, &c, 1) == 1)
+            answer += c;
+        bad += answer != "pong 1\n";
+        close(fd);
+    }
+
+    interruptRequested.store(true);
+    server.join();
+    interruptRequested.store(false);
+    bad += rc != 0 || std::filesystem::exists(path);
+    addCheck(report, "query server client gone", 1, bad);
+}
+#endif
+
+// Runs the finders on fixed inputs: throughput and their best result
+static void runFinders(Report &report, bool macro)
+{
+    std::filesystem::create_directories("logs");
+
+    auto addMacro = [&](const char *name, const char *unit, const FinderSummary &s)
+    {
+        if (!macro)
+            return;
+        double rate = s.seconds > 0 ? s.items / s.seconds : 0;
+        report.macro.push_back({name, unit, rate, s.items, s.seconds});
+        printf("[MACRO] %-24s %12.1f %s (%llu in %.2fs)\n", name, rate, unit, (unsigned long long)s.items, s.seconds);
+        fflush(stdout);
+    };
+
+    // Seed finder on the best single temple seed of the README
+    {
+        FinderOptions opt;
+        opt.startSeed = (uint64_t)GOLDEN_SINGLE[0].seed;
+        opt.maxItems = 1;
+        opt.threads = 1;
+        FinderSummary s;
+        run_seed_finder(opt, &s);
+        addMacro("seed_finder", "seeds/s", s);
+        addCheck(report, "seed finder golden best", 1,
+                 s.bestScore != GOLDEN_SINGLE[0].score || s.bestX != GOLDEN_SINGLE[0].x || s.bestZ != GOLDEN_SINGLE[0].z);
+    }
+
+    // Sibling order from the same seed: the best must be the best of the same
+    // seeds searched one at a time
+    {
+        const uint64_t siblings = 4;
+        FinderOptions opt;
+        opt.startSeed = (uint64_t)GOLDEN_SINGLE[0].seed;
+        opt.siblingOrder = true;
+        opt.maxItems = siblings;
+        opt.threads = 2;
+        FinderSummary s;
+        run_seed_finder(opt, &s);
+        addMacro("seed_finder_siblings", "seeds/s", s);
+
+        FinderSummary best;
+        for (uint64_t i = 0; i < siblings; ++i)
+        {
+            FinderOptions one;
+            one.startSeed = siblingOrderSeed(siblingOrderItem(opt.startSeed) + i);
+            one.maxItems = 1;
+            one.threads = 1;
+            FinderSummary r;
+            run_seed_finder(one, &r);
+            if (r.bestScore > best.bestScore)
+                best = r;
+        }
+        addCheck(report, "seed finder siblings", siblings,
+                 s.items != siblings || s.bestSeed != best.bestSeed || s.bestScore != best.bestScore || s.bestX != best.bestX || s.bestZ != best.bestZ);
+    }
+
+    // Quad finder on the base of the README multi-temple seeds, the finder moves it back by (-1,-1)
+    {
+        StructureConfig sconf;
+        getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+        uint64_t s48 = (uint64_t)GOLDEN_QUAD_SEEDS[0] & MASK48;
+
+        FinderOptions opt;
+        opt.quadBases = {(moveStructure(s48, 1, 1) + sconf.salt) & MASK48};
+        opt.threads = 1;
+        opt.resultsPath = "logs/bench_quad_temple_finder.bin";
+        std::filesystem::remove(opt.resultsPath);
+        FinderSummary s;
+        run_quad_temple_finder(opt, &s);
+        addMacro("quad_temple_finder", "bases/s", s);
+
+        bool listed = false;
+        for (int64_t seed : GOLDEN_QUAD_SEEDS)
+            listed |= seed == s.bestSeed;
+        addCheck(report, "quad finder golden best", 1, s.bestScore != GOLDEN_QUAD_TOTAL || !listed);
+
+        // The best quad must be in the result file with its 4 temples
+        std::vector<MappedResultFile> files(1);
+        uint64_t temples = 0;
+        if (files[0].open(opt.resultsPath))
+            for (const ResultRecord *r : selectResults(files, {}))
+                temples += r->seed == s.bestSeed && r->total == GOLDEN_QUAD_TOTAL && r->count == 4;
+        addCheck(report, "quad finder result file", 1, temples != 4);
+
+        // Rendering the best quad recounts its swamp from the image
+        const std::string renders = "logs/bench_renders", prefix = "quad_" + std::to_string(s.bestSeed) + "_";
+        std::filesystem::remove_all(renders);
+        const int rc = run_render_tool("seedfinder_bench", {opt.resultsPath, "--top", "1", "--threads", "2", "--out", renders});
+        uint64_t images = 0;
+        for (const auto &entry : std::filesystem::directory_iterator(renders))
+            images += entry.path().filename().string().rfind(prefix, 0) == 0 && entry.path().extension() == ".png";
+        addCheck(report, "render quad finder result", 1, rc != 0 || images != 1);
+    }
+
+    // Ranked order: the README base hidden among decoys is searched first
+    {
+        FinderOptions opt;
+        opt.quadBases = quadBasesWithDecoys(256, 200);
+        opt.maxItems = 1;
+        opt.threads = 1;
+        opt.resultsPath = "logs/bench_quad_temple_finder_ranked.bin";
+        std::filesystem::remove(opt.resultsPath);
+        FinderSummary s;
+        run_quad_temple_finder(opt, &s);
+        addCheck(report, "quad finder ranked order", 1, s.bestScore != GOLDEN_QUAD_TOTAL || s.secondsToBest < 0);
+    }
+
+    // Location finder: the tiled scan must find the same best as the plain spiral
+    {
+        FinderOptions opt;
+        opt.startSeed = BENCH_SEED;
+        opt.areaRadiusBlocks = 200 * 512;
+        opt.threads = 1;
+
+        FinderSummary tiled, spiral;
+        run_location_finder(opt, &tiled);
+        addMacro("location_finder", "regions/s", tiled);
+
+        opt.tileRegions = 0;
+        run_location_finder(opt, &spiral);
+        addMacro("location_finder_spiral", "regions/s", spiral);
+
+        addCheck(report, "location finder tiled vs spiral", 1,
+                 tiled.items != spiral.items || tiled.bestScore != spiral.bestScore ||
+                     tiled.bestX != spiral.bestX || tiled.bestZ != spiral.bestZ);
+
+        // Clusters do not depend on the order the regions are scanned in, and
+        // the best is the README quad at the origin. Their result file holds
+        // groups under a finder id of their own.
+        std::filesystem::remove("logs/location_clusters.bin");
+        opt.areaRadiusBlocks = 48 * 512;
+        opt.clusters = true;
+        run_location_finder(opt, &spiral);
+        opt.tileRegions = 16;
+        run_location_finder(opt, &tiled);
+        std::vector<MappedResultFile> files(1);
+        uint64_t fileBad = !files[0].open("logs/location_clusters.bin") || files[0].size() == 0 ||
+                           files[0].header().finder != RF_CLUSTER;
+        for (size_t i = 0; i < files[0].size(); ++i)
+            fileBad += files[0].records()[i].finder != RF_CLUSTER || files[0].records()[i].count < 2;
+        addCheck(report, "location finder clusters tiled vs spiral", 1,
+                 tiled.clusters != spiral.clusters || tiled.bestClusterScore != spiral.bestClusterScore || spiral.clusters == 0 ||
+                     spiral.bestClusterTemples != 4 || fileBad);
+    }
+}
+
+static std::string jsonString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static std::string toJson(const Report &report)
+{
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"version\": 1,\n";
+#if defined(__VERSION__)
+    out << "  \"compiler\": " << jsonString(__VERSION__) << ",\n";
+#endif
+    out << "  \"cpu\": {\"avx2\": " << (cpuHasAvx2() ? "true" : "false") << ", \"sse41\": " << (cpuHasSse41() ? "true" : "false") << "},\n";
+
+    out << "  \"micro\": [";
+    for (size_t i = 0; i < report.micro.size(); ++i)
+    {
+        const MicroResult &r = report.micro[i];
+        out << (i ? "," : "") << "\n    {\"name\": " << jsonString(r.name) << ", \"ops\": " << r.ops
+            << ", \"ns_per_op_min\": " << r.nsMin << ", \"ns_per_op_avg\": " << r.nsAvg << "}";
+    }
+    out << (report.micro.empty() ? "" : "\n  ") << "],\n";
+
+    out << "  \"macro\": [";
+    for (size_t i = 0; i < report.macro.size(); ++i)
+    {
+        const MacroResult &r = report.macro[i];
+        out << (i ? "," : "") << "\n    {\"name\": " << jsonString(r.name) << ", \"unit\": " << jsonString(r.unit)
+            << ", \"rate\": " << r.rate << ", \"items\": " << r.items << ", \"seconds\": " << r.seconds << "}";
+    }
+    out << (report.macro.empty() ? "" : "\n  ") << "],\n";
+
+    out << "  \"checks\": [";
+    bool passed = true;
+    for (size_t i = 0; i < report.checks.size(); ++i)
+    {
+        const CheckResult &r = report.checks[i];
+        passed &= r.mismatches == 0;
+        out << (i ? "," : "") << "\n    {\"name\": " << jsonString(r.name) << ", \"checked\": " << r.checked
+            << ", \"mismatches\": " << r.mismatches << ", \"passed\": " << (r.mismatches ? "false" : "true") << "}";
+    }
+    out << (report.checks.empty() ? "" : "\n  ") << "],\n";
+    out << "  \"passed\": " << (passed ? "true" : "false") << "\n";
+    out << "}\n";
+    return out.str();
+}
+
+static void print_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [--micro] [--macro] [--validate] [--seconds <s>] [--json <file>]\n", prog);
+    fprintf(stderr, "  --micro       time the hot path functions\n");
+    fprintf(stderr, "  --macro       time the finders on fixed inputs\n");
+    fprintf(stderr, "  --validate    check the fast paths against the reference path and README seeds\n");
+    fprintf(stderr, "  --seconds <s> time budget per micro benchmark (default 1)\n");
+    fprintf(stderr, "  --json <file> write the results as JSON\n");
+    fprintf(stderr, "Runs in the directory of the binary, finder output goes to its logs/\n");
+}
+
+int main(int argc, char **argv)
+{
+    bool micro = false, macro = false, validate = false;
+    double budget = 1.0;
+    std::string jsonPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--micro")
+            micro = true;
+        else if (arg == "--macro")
+            macro = true;
+        else if (arg == "--validate")
+            validate = true;
+        else if (arg == "--seconds" && i + 1 < argc && atof(argv[i + 1]) > 0)
+            budget = atof(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!micro && !macro && !validate)
+        micro = macro = validate = true;
+
+    // The finders write logs/ and their result files relative to the working
+    // directory, so the bench runs them next to its binary (the build
+    // directory) instead of wherever it was started from
+    std::error_code ec;
+    if (!jsonPath.empty())
+        jsonPath = std::filesystem::absolute(jsonPath).string();
+    std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+    if (ec)
+        exe = std::filesystem::absolute(argv[0]);
+    std::filesystem::current_path(exe.parent_path(), ec);
+    if (ec)
+        fprintf(stderr, "Failed to change to '%s': %s\n", exe.parent_path().string().c_str(), ec.message().c_str());
+
+    Report report;
+    if (validate)
+    {
+        runGoldenChecks(report);
+        runRandomChecks(report);
+        runLayerKernelChecks(report);
+        runRenderChecks(report);
+        runResultFileChecks(report);
+        runResultCollectorChecks(report);
+        runQuadBaseCacheChecks(report);
+        runQuadBaseOrderChecks(report);
+        runTempleClusterChecks(report);
+        runTaskEngineChecks(report);
+        runQueryServerChecks(report);
+#if !defined(_WIN32)
+        runQueryServerSocketChecks(report);
+#endif
+    }
+    if (micro)
+        runMicro(report, budget);
+    if (macro || validate)
+        runFinders(report, macro);
+
+    std::string json = toJson(report);
+    if (!jsonPath.empty())
+    {
+        FILE *fp = fopen(jsonPath.c_str(), "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Failed to open '%s'\n", jsonPath.c_str());
+            return 2;
+        }
+        fputs(json.c_str(), fp);
+        fclose(fp);
+    }
+    else
+    {
+        fputs(json.c_str(), stdout);
+    }
+
+    for (const CheckResult &r : report.checks)
+        if (r.mismatches)
+            return 1;
+    return 0;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <finder_utils.hpp>
+#include <result_collector.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include "util.h"
+}
+
+// Side of the square of blocks generated by one genBiomes() call of the renderer
+constexpr int RENDER_TILE = 128;
+
+// Default side of a rendered image in blocks, one pixel per block
+constexpr int RENDER_SIZE = 384;
+
+// Overlay colors: swamp, footprint blocks in and out of swamp, the AFK sphere
+constexpr unsigned char RENDER_SWAMP[3] = {64, 255, 160};
+constexpr unsigned char RENDER_FOOTPRINT_SWAMP[3] = {255, 255, 255};
+constexpr unsigned char RENDER_FOOTPRINT_OTHER[3] = {255, 48, 48};
+constexpr unsigned char RENDER_AFK[3] = {255, 208, 0};
+
+// Square area of size blocks centered on the footprints of a result
+struct RenderArea
+{
+    int x0, z0, size;
+
+    int tiles() const
+    {
+        const int n = (size + RENDER_TILE - 1) / RENDER_TILE;
+        return n * n;
+    }
+};
+
+inline RenderArea renderArea(const FoundResult &r, int size)
+{
+    int minX = r.temples[0].x, minZ = r.temples[0].z, maxX = minX, maxZ = minZ;
+    for (int i = 0; i < r.count; ++i)
+    {
+        const PieceSize piece = templePiece(r.temples[i].type);
+        minX = std::min(minX, r.temples[i].x);
+        minZ = std::min(minZ, r.temples[i].z);
+        maxX = std::max(maxX, r.temples[i].x + piece.w);
+        maxZ = std::max(maxZ, r.temples[i].z + piece.d);
+    }
+    return {(int)(((int64_t)minX + maxX - size) / 2), (int)(((int64_t)minZ + maxZ - size) / 2), size};
+}
+
+// Generates tile t of the area into biomes (size x size, row major). cache
+// holds getMinCacheSize() of a RENDER_TILE square. Tiles are disjoint, so
+// workers may fill the tiles of one image at the same time.
+inline int renderTile(const Generator *g, int *cache, const RenderArea &a, int t, int queryY, int *biomes)
+{
+    const int n = (a.size + RENDER_TILE - 1) / RENDER_TILE;
+    const int tx = t % n * RENDER_TILE, tz = t / n * RENDER_TILE;
+    const int w = std::min(RENDER_TILE, a.size - tx), h = std::min(RENDER_TILE, a.size - tz);
+
+    Range r = {1, a.x0 + tx, a.z0 + tz, w, h, queryY, 1};
+    if (genBiomes(g, cache, r) != 0)
+        return 1;
+    for (int z = 0; z < h; ++z)
+        std::copy(cache + z * w, cache + (z + 1) * w, biomes + (tz + z) * a.size + tx);
+    return 0;
+}
+
+// Colors the biomes of the area and draws the overlays. Returns the number
+// of temples whose swamp spawn blocks, recounted from the image, differ from
+// the ones in the result.
+inline int renderImage(const int *biomes, const RenderArea &a, const FoundResult &r, unsigned char *rgb)
+{
+    static const auto colors = []
+    {
+        std::vector<unsigned char> c(256 * 3);
+        initBiomeColors((unsigned char(*)[3])c.data());
+        return c;
+    }();
+
+    auto paint = [&](int x, int z, const unsigned char *color)
+    {
+        x -= a.x0;
+        z -= a.z0;
+        if (x >= 0 && z >= 0 && x < a.size && z < a.size)
+            std::copy(color, color + 3, rgb + 3 * ((size_t)z * a.size + x));
+    };
+
+    // Swamp stands out against the other biomes at half brightness
+    for (size_t i = 0; i < (size_t)a.size * a.size; ++i)
+    {
+        if (biomes[i] == swampland)
+        {
+            std::copy(RENDER_SWAMP, RENDER_SWAMP + 3, rgb + 3 * i);
+            continue;
+        }
+        const unsigned char *c = colors.data() + 3 * (biomes[i] & 0xff);
+        for (int k = 0; k < 3; ++k)
+            rgb[3 * i + k] = c[k] / 2;
+    }
+
+    int mismatches = 0;
+    PieceSize tallest = {0, 0, 0};
+    for (int i = 0; i < r.count; ++i)
+    {
+        const FoundTemple &t = r.temples[i];
+        const PieceSize piece = templePiece(t.type);
+        tallest = {std::max(tallest.w, piece.w), std::max(tallest.h, piece.h), std::max(tallest.d, piece.d)};
+
+        int swampCount = 0;
+        for (int z = t.z; z < t.z + piece.d; ++z)
+        {
+            for (int x = t.x; x < t.x + piece.w; ++x)
+            {
+                const int64_t ix = x - a.x0, iz = z - a.z0;
+                const bool inside = ix >= 0 && iz >= 0 && ix < a.size && iz < a.size;
+                const bool swamp = inside && biomes[iz * a.size + ix] == swampland;
+                swampCount += swamp;
+                paint(x, z, swamp ? RENDER_FOOTPRINT_SWAMP : RENDER_FOOTPRINT_OTHER);
+            }
+        }
+        mismatches += swampCount * templeSpawnMultiplier(t.type) != t.swampSpawnBlocks;
+    }
+
+    // Groups get the sphere around their AFK point (see getOptimalAfk())
+    if (r.count > 1)
+    {
+        Pos p[4];
+        for (int k = 0; k < 4; ++k)
+            p[k] = {r.temples[k % r.count].x, r.temples[k % r.count].z};
+        const Pos afk = getOptimalAfk(p, tallest.w, tallest.h, tallest.d, nullptr);
+        const double radius = std::sqrt(128.0 * 128.0 - tallest.h * tallest.h / 4.0);
+        const int steps = (int)(2 * M_PI * radius) * 2;
+        for (int s = 0; s < steps; ++s)
+            paint(afk.x + (int)std::lround(radius * std::cos(2 * M_PI * s / steps)),
+                  afk.z + (int)std::lround(radius * std::sin(2 * M_PI * s / steps)), RENDER_AFK);
+        for (int d = -2; d <= 2; ++d)
+        {
+            paint(afk.x + d, afk.z, RENDER_AFK);
+            paint(afk.x, afk.z + d, RENDER_AFK);
+        }
+    }
+    return mismatches;
+}
+
+// Binary PPM (P6)
+inline bool writePpm(const std::string &path, const unsigned char *rgb, int w, int h)
+{
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp)
+        return false;
+    fprintf(fp, "P6\n%d %d\n255\n", w, h);
+    bool ok = fwrite(rgb, 3, (size_t)w * h, fp) == (size_t)w * h;
+    return fclose(fp) == 0 && ok;
+}
+
+// PNG with stored (uncompressed) deflate blocks, so no zlib is needed.
+// The files are about as large as a PPM.
+inline bool writePng(const std::string &path, const unsigned char *rgb, int w, int h)
+{
+    static const auto crcTable = []
+    {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    std::vector<unsigned char> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    auto be32 = [&](std::vector<unsigned char> &v, uint32_t x)
+    {
+        for (int k = 3; k >= 0; --k)
+            v.push_back((unsigned char)(x >> (8 * k)));
+    };
+    auto chunk = [&](const char *type, const std::vector<unsigned char> &data)
+    {
+        be32(out, (uint32_t)data.size());
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        uint32_t crc = 0xffffffffu;
+        for (size_t i = start; i < out.size(); ++i)
+            crc = crcTable[(crc ^ out[i]) & 0xff] ^ (crc >> 8);
+        be32(out, crc ^ 0xffffffffu);
+    };
+
+    std::vector<unsigned char> ihdr;
+    be32(ihdr, (uint32_t)w);
+    be32(ihdr, (uint32_t)h);
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, no interlace
+    chunk("IHDR", ihdr);
+
+    // Scanlines with filter type 0, in zlib stored blocks of up to 65535 bytes
+    std::vector<unsigned char> raw;
+    raw.reserve((size_t)h * (3 * w + 1));
+    for (int z = 0; z < h; ++z)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb + (size_t)z * 3 * w, rgb + (size_t)(z + 1) * 3 * w);
+    }
+    std::vector<unsigned char> idat = {0x78, 0x01};
+    uint32_t a = 1, b = 0;
+    for (size_t pos = 0; pos == 0 || pos < raw.size();)
+    {
+        const size_t len = std::min<size_t>(65535, raw.size() - pos);
+        idat.push_back(pos + len == raw.size());
+        idat.insert(idat.end(), {(unsigned char)len, (unsigned char)(len >> 8), (unsigned char)~len, (unsigned char)(~len >> 8)});
+        idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+        for (size_t i = pos; i < pos + len; ++i)
+        {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        pos += len;
+        if (len == 0)
+            break;
+    }
+    be32(idat, b << 16 | a);
+    chunk("IDAT", idat);
+    chunk("IEND", {});
+
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(out.data(), 1, out.size(), fp) == out.size();
+    return fclose(fp) == 0 && ok;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <finder_utils.hpp>
+
+#include <cstring>
+#include <vector>
+
+// Copy of a seeded generator whose coarse layers are answered from tiles.
+//
+// Scanning a whole world asks the layer stack for billions of small areas,
+// and neighbouring queries recompute the same 1:256 and 1:64 parent cells.
+// loadTile() generates those layers once for a block rectangle, with one
+// genArea per tiled layer, and the layers of the copy then copy from the tile
+// instead of recomputing. The finer layers (1:16 and below) still run per
+// query on top of the tile, so only the small windows around a candidate are
+// generated separately. Queries reaching outside the tile fall back to the
+// real layer, so results are always the same as the original generator.
+class BiomeTileStack
+{
+public:
+    // Layers kept as tiles, in generation order (parents first). L_MUSHROOM_256
+    // feeds both the biome branch and the river/hills noise, and L_BIOME_256
+    // and L_ZOOM_64 are read by the coarse cascade stages. Tiling the 1:64 hills
+    // and river layers too was measured slower: most candidates never need them.
+    static constexpr int TILED_LAYERS[] = {L_MUSHROOM_256, L_BIOME_256, L_NOISE_256, L_ZOOM_64};
+    static constexpr int NUM_TILED = sizeof(TILED_LAYERS) / sizeof(TILED_LAYERS[0]);
+
+    // g must already be seeded. maxTileBlocks is the largest block rectangle
+    // side passed to loadTile() and fixes the memory used by the tiles.
+    BiomeTileStack(const Generator *g, int maxTileBlocks)
+        : gen(*g)
+    {
+        // Point every layer and entry of the copy at the copy itself
+        auto relink = [&](auto *ptr)
+        {
+            const char *base = (const char *)g;
+            const char *p = (const char *)ptr;
+            if (p < base || p >= base + sizeof(Generator))
+                return ptr;
+            return (decltype(ptr))((char *)&gen + (p - base));
+        };
+        for (Layer &l : gen.ls.layers)
+        {
+            l.p = relink(l.p);
+            l.p2 = relink(l.p2);
+            l.noise = relink(l.noise);
+        }
+        for (Layer &l : gen.xlayer)
+        {
+            l.p = relink(l.p);
+            l.p2 = relink(l.p2);
+            l.noise = relink(l.noise);
+        }
+        gen.ls.entry_1 = relink(gen.ls.entry_1);
+        gen.ls.entry_4 = relink(gen.ls.entry_4);
+        gen.ls.entry_16 = relink(gen.ls.entry_16);
+        gen.ls.entry_64 = relink(gen.ls.entry_64);
+        gen.ls.entry_256 = relink(gen.ls.entry_256);
+        gen.entry = relink(gen.entry);
+
+        size_t scratchLen = 0;
+        for (int t = 0; t < NUM_TILED; ++t)
+        {
+            Layer *l = &gen.ls.layers[TILED_LAYERS[t]];
+            Tile &tile = tiles[t];
+            tile.getMap = l->getMap;
+            tile.cells = (maxTileBlocks + l->scale - 1) / l->scale + 2 * tilePad(l) + 2;
+            tile.data.resize((size_t)tile.cells * tile.cells);
+            scratchLen = std::max(scratchLen, getMinLayerCacheSize(l, tile.cells, tile.cells));
+
+            l->getMap = mapFromTile;
+            l->data = &tile;
+        }
+        scratch.resize(scratchLen);
+    }
+
+    BiomeTileStack(const BiomeTileStack &) = delete;
+    BiomeTileStack &operator=(const BiomeTileStack &) = delete;
+
+    // Generator to query, e.g. for a TempleEvaluator. Only valid while this object lives.
+    const Generator *generator() const
+    {
+        return &gen;
+    }
+
+    // Generates the tiled layers for all queries inside the block rectangle
+    // [x0, x1] x [z0, z1], which must not be larger than maxTileBlocks
+    void loadTile(int x0, int z0, int x1, int z1)
+    {
+        for (int t = 0; t < NUM_TILED; ++t)
+        {
+            Layer *l = &gen.ls.layers[TILED_LAYERS[t]];
+            Tile &tile = tiles[t];
+            const int pad = tilePad(l);
+
+            // Drop the old tile first so generating this one never reads it
+            tile.w = tile.h = 0;
+
+            int ax = floorDiv(x0, l->scale) - pad, az = floorDiv(z0, l->scale) - pad;
+            int aw = floorDiv(x1, l->scale) + pad - ax + 1, ah = floorDiv(z1, l->scale) + pad - az + 1;
+            if (aw > tile.cells || ah > tile.cells)
+                continue; // too large, this layer is then always generated
+
+            memset(scratch.data(), 0, sizeof(int) * (size_t)aw * ah);
+            if (tile.getMap(l, scratch.data(), ax, az, aw, ah) != 0)
+                continue;
+
+            memcpy(tile.data.data(), scratch.data(), sizeof(int) * (size_t)aw * ah);
+            tile.x = ax;
+            tile.z = az;
+            tile.w = aw;
+            tile.h = ah;
+        }
+    }
+
+    // Bytes held by the tiles and the scratch buffer used to generate them
+    size_t memoryBytes() const
+    {
+        size_t bytes = scratch.size() * sizeof(int);
+        for (const Tile &tile : tiles)
+            bytes += tile.data.size() * sizeof(int);
+        return bytes;
+    }
+
+private:
+    struct Tile
+    {
+        mapfunc_t *getMap = nullptr; // the real layer function
+        int cells = 0;               // capacity per side
+        int x = 0, z = 0, w = 0, h = 0;
+        std::vector<int> data;
+    };
+
+    // Extra cells around the tile so the windows of the layers below stay inside it
+    static int tilePad(const Layer *l)
+    {
+        return l->scale == 256 ? 2 : 3;
+    }
+
+    static int floorDiv(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    static int mapFromTile(const Layer *l, int *out, int x, int z, int w, int h)
+    {
+        const Tile &tile = *(const Tile *)l->data;
+        if (x < tile.x || z < tile.z || x + w > tile.x + tile.w || z + h > tile.z + tile.h)
+            return tile.getMap(l, out, x, z, w, h);
+
+        for (int j = 0; j < h; ++j)
+            memcpy(out + (size_t)j * w, tile.data.data() + (size_t)(z - tile.z + j) * tile.w + (x - tile.x), sizeof(int) * w);
+        return 0;
+    }
+
+    Generator gen;
+    Tile tiles[NUM_TILED];
+    std::vector<int> scratch;
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <finder_utils.hpp>
+#include <metrics.hpp>
+#include <structure_batch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// Default of --batch: candidates per pipeline batch
+inline constexpr int PIPELINE_BATCH = 1024;
+
+// Batched evaluation of temple candidates in three stages over
+// structure-of-arrays buffers, shared by the finders:
+//
+//   1. place()/add() fill the positions of a block of regions
+//   2. run() takes the whole batch through the coarse cascade one stage at a
+//      time (BasicTempleEvaluator::testStage) and compacts the survivors
+//      after each stage, so a stage's layers stay hot for the batch
+//   3. run() then scores the survivors that the 1:4 bound left open on the
+//      1:1 layer
+//
+// Candidates come in groups of groupSize consecutive entries (1 for single
+// temples, 4 for a quad). A group survives only if all its temples do, and
+// its score is the sum over them. Batches hold whole groups.
+template <typename Evaluator>
+class CandidatePipeline
+{
+public:
+    CandidatePipeline(Evaluator &eval, int batchSize = PIPELINE_BATCH, int groupSize = 1)
+        : eval(eval), group(groupSize), cap(std::max(batchSize, groupSize) / groupSize * groupSize)
+    {
+        x.resize(cap);
+        z.resize(cap);
+        bounds.resize(cap);
+        scores.resize(cap);
+        open.reserve(cap);
+    }
+
+    // Counts placement time into m, null to disable. The evaluator has its own.
+    void setMetrics(ThreadMetrics *m)
+    {
+        metrics = m;
+    }
+
+    int capacity() const
+    {
+        return cap;
+    }
+
+    int size() const
+    {
+        return n;
+    }
+
+    int space() const
+    {
+        return cap - n;
+    }
+
+    // Stage 1: temple positions of up to count regions along a line, see
+    // getFeaturePosBatch(). Returns the number placed, less than count when
+    // the batch is full.
+    int place(const StructureConfig &sconf, uint64_t seed, int regX, int regZ, int stepX, int stepZ, int count)
+    {
+        ThreadMetrics::StageTimer timer(metrics, STAGE_PLACEMENT);
+        count = std::min(count, space());
+        getFeaturePosBatch(sconf, seed, regX, regZ, stepX, stepZ, count, x.data() + n, z.data() + n);
+        n += count;
+        return count;
+    }
+
+    // Stage 1 for positions from elsewhere
+    void add(int px, int pz)
+    {
+        x[n] = px;
+        z[n] = pz;
+        ++n;
+    }
+
+    // Up to count of them, returns the number added like place()
+    int add(const int *px, const int *pz, int count)
+    {
+        count = std::min(count, space());
+        std::copy(px, px + count, x.data() + n);
+        std::copy(pz, pz + count, z.data() + n);
+        n += count;
+        return count;
+    }
+
+    // Stages 2 and 3. Keeps the groups that can score minScore (totals of a
+    // group for groupSize > 1), with their exact scores, and returns how many
+    // there are. Groups below minScore may be dropped before the 1:1 layer,
+    // and scored ones below it are kept: their scores are still of interest
+    // (e.g. for the histogram). Candidates that passed the stages before
+    // firstStage elsewhere (see SeedLaneFilter) resume there.
+    int run(int minScore, int firstStage = CS_256)
+    {
+        const int candidateMin = group == 1 ? std::max(0, minScore) : 0;
+        {
+            ThreadMetrics::StageTimer timer(metrics, STAGE_CASCADE);
+            std::fill(bounds.begin(), bounds.begin() + n, TempleBound{-1, {0, 0}});
+            open.assign(n, 1);
+
+            // Open candidates (not decided yet) move through the stages together
+            for (int s = firstStage; s < CS_1; ++s)
+            {
+                for (int i = 0; i < n; ++i)
+                {
+                    if (!open[i])
+                        continue;
+                    if (eval.testStage(s, x[i], z[i], candidateMin, bounds[i]))
+                        open[i] = 0;
+                }
+                dropGroups([&](int i)
+                           { return !open[i] && bounds[i].maxScore < candidateMin; });
+            }
+        }
+
+        // Every candidate left is bounded; groups that cannot reach minScore go
+        if (group > 1)
+        {
+            const int before = n;
+            dropGroups([&](int i)
+                       { return groupTotal(i, [&](int k)
+                                           { return bounds[k].maxScore; }) < minScore; });
+            if (metrics)
+                metrics->add(CTR_REJECTED_SCORE, before - n);
+        }
+
+        // Stage 3: exact scores on the 1:1 layer where the bound is not exact
+        for (int i = 0; i < n; ++i)
+            scores[i] = bounds[i].exact.type ? bounds[i].exact : eval.evaluateExact(x[i], z[i]);
+        dropGroups([&](int i)
+                   { return scores[i].type == 0; });
+        return n / group;
+    }
+
+    // Group g of the survivors, after run()
+    const int *xs(int g) const
+    {
+        return x.data() + g * group;
+    }
+
+    const int *zs(int g) const
+    {
+        return z.data() + g * group;
+    }
+
+    const TempleScore *templeScores(int g) const
+    {
+        return scores.data() + g * group;
+    }
+
+    int total(int g) const
+    {
+        return groupTotal(g * group, [&](int k)
+                          { return scores[k].swampSpawnBlocks; });
+    }
+
+    void clear()
+    {
+        n = 0;
+    }
+
+private:
+    template <typename Value>
+    int groupTotal(int i, Value value) const
+    {
+        const int first = i / group * group;
+        int sum = 0;
+        for (int k = first; k < first + group; ++k)
+            sum += value(k);
+        return sum;
+    }
+
+    // Compacts away the groups with any member where dead(i) holds
+    template <typename Dead>
+    void dropGroups(Dead dead)
+    {
+        int kept = 0;
+        for (int first = 0; first < n; first += group)
+        {
+            bool alive = true;
+            for (int k = first; k < first + group && alive; ++k)
+                alive = !dead(k);
+            if (!alive)
+                continue;
+            if (kept != first)
+            {
+                for (int k = 0; k < group; ++k)
+                {
+                    x[kept + k] = x[first + k];
+                    z[kept + k] = z[first + k];
+                    bounds[kept + k] = bounds[first + k];
+                    scores[kept + k] = scores[first + k];
+                    open[kept + k] = open[first + k];
+                }
+            }
+            kept += group;
+        }
+        n = kept;
+    }
+
+    Evaluator &eval;
+    const int group;
+    const int cap;
+    int n = 0;
+    std::vector<int> x, z;
+    std::vector<TempleBound> bounds;
+    std::vector<TempleScore> scores;
+    std::vector<char> open;
+    ThreadMetrics *metrics = nullptr;
+};
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <options.hpp>
+#include <task_engine.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// Work is handed out as tickets 0, 1, 2, ... A ticket maps to the item
+// startSeed + ticket * shardCount + shardIndex, so shards never overlap.
+inline uint64_t shardItem(const FinderOptions &opt, uint64_t ticket)
+{
+    return opt.startSeed + ticket * opt.shardCount + opt.shardIndex;
+}
+
+// Number of tickets whose items are below end
+inline uint64_t shardTicketCount(const FinderOptions &opt, uint64_t end)
+{
+    uint64_t first = opt.startSeed + opt.shardIndex;
+    if (end <= first)
+        return 0;
+    return (end - first + opt.shardCount - 1) / opt.shardCount;
+}
+
+// Seed finder with --siblings: item i is the seed with lower 48 bits i >> 16
+// and upper 16 bits i & 0xffff, so the 65536 seeds of a structure seed (which
+// share every temple position) are consecutive items. Both are bijections.
+inline uint64_t siblingOrderSeed(uint64_t item)
+{
+    return (item >> 16) | (item << 48);
+}
+
+inline uint64_t siblingOrderItem(uint64_t seed)
+{
+    return (seed << 16) | (seed >> 48);
+}
+
+struct Checkpoint
+{
+    std::string finder;
+    uint32_t shardIndex = 0;
+    uint32_t shardCount = 1;
+    uint64_t startSeed = 0;
+
+    // Every ticket below frontier is done, resume from here
+    uint64_t frontier = 0;
+
+    // Best result so far, bestScore < 0 when there is none
+    int64_t bestSeed = 0;
+    int bestScore = -1;
+    int bestX = 0, bestZ = 0;
+    int bestType = 0;
+
+    // Finder specific check that the run is the same, e.g. the quad base count
+    uint64_t itemCount = 0;
+};
+
+// Replaces dst with src in one step, so readers see either the old or the new file
+inline bool replaceFile(const std::string &src, const std::string &dst)
+{
+#if defined(_WIN32)
+    return MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(src.c_str(), dst.c_str()) == 0;
+#endif
+}
+
+inline bool saveCheckpoint(const std::string &path, const Checkpoint &cp)
+{
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        if (!out)
+            return false;
+
+        out << "finder=" << cp.finder << "\n";
+        out << "shard=" << cp.shardIndex << "/" << cp.shardCount << "\n";
+        out << "start=" << cp.startSeed << "\n";
+        out << "items=" << cp.itemCount << "\n";
+        out << "frontier=" << cp.frontier << "\n";
+        out << "best_seed=" << cp.bestSeed << "\n";
+        out << "best_score=" << cp.bestScore << "\n";
+        out << "best_x=" << cp.bestX << "\n";
+        out << "best_z=" << cp.bestZ << "\n";
+        out << "best_type=" << cp.bestType << "\n";
+
+        out.flush();
+        if (!out)
+            return false;
+    }
+    return replaceFile(tmpPath, path);
+}
+
+// Returns false when the file does not exist or cannot be parsed
+inline bool loadCheckpoint(const std::string &path, Checkpoint &cp)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    bool hasFrontier = false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            continue;
+
+        std::string key = line.substr(0, eq);
+        std::istringstream value(line.substr(eq + 1));
+        char sep = 0;
+
+        if (key == "finder")
+            value >> cp.finder;
+        else if (key == "shard")
+            value >> cp.shardIndex >> sep >> cp.shardCount;
+        else if (key == "start")
+            value >> cp.startSeed;
+        else if (key == "items")
+            value >> cp.itemCount;
+        else if (key == "frontier")
+            hasFrontier = (bool)(value >> cp.frontier);
+        else if (key == "best_seed")
+            value >> cp.bestSeed;
+        else if (key == "best_score")
+            value >> cp.bestScore;
+        else if (key == "best_x")
+            value >> cp.bestX;
+        else if (key == "best_z")
+            value >> cp.bestZ;
+        else if (key == "best_type")
+            value >> cp.bestType;
+    }
+    return hasFrontier && cp.shardCount > 0;
+}
+
+// Loads the checkpoint of opt if there is one and checks it belongs to this run.
+// Returns false (after printing why) when the existing file cannot be used.
+//
+// Only the frontier is saved, so the tickets above it that were already done
+// when the run stopped are scanned again. Their results are appended to the
+// log and the result file a second time; `results` drops the identical
+// records unless --keep-duplicates is given.
+inline bool resumeCheckpoint(const FinderOptions &opt, const char *finder, uint64_t itemCount, Checkpoint &cp)
+{
+    cp.finder = finder;
+    cp.shardIndex = opt.shardIndex;
+    cp.shardCount = opt.shardCount;
+    cp.startSeed = opt.startSeed;
+    cp.itemCount = itemCount;
+
+    if (opt.checkpointPath.empty())
+        return true;
+
+    std::ifstream probe(opt.checkpointPath);
+    if (!probe)
+        return true;
+    probe.close();
+
+    Checkpoint saved;
+    if (!loadCheckpoint(opt.checkpointPath, saved))
+    {
+        fprintf(stderr, "Failed to read checkpoint '%s'\n", opt.checkpointPath.c_str());
+        return false;
+    }
+    if (saved.finder != cp.finder || saved.shardIndex != cp.shardIndex || saved.shardCount != cp.shardCount ||
+        saved.startSeed != cp.startSeed || saved.itemCount != cp.itemCount)
+    {
+        fprintf(stderr, "Checkpoint '%s' is for a different run (finder=%s shard=%u/%u start=%" PRIu64 ")\n",
+                opt.checkpointPath.c_str(), saved.finder.c_str(), saved.shardIndex, saved.shardCount, saved.startSeed);
+        return false;
+    }
+
+    cp = saved;
+    printf("[RESUME] %s shard=%u/%u from item %" PRIu64 " best-so-far swamp-spawn-blocks=%d\n",
+           finder, cp.shardIndex, cp.shardCount, shardItem(opt, cp.frontier), cp.bestScore);
+    fflush(stdout);
+    return true;
+}
+
+// Writes the checkpoint of a run at most every checkpointEverySeconds
+class PeriodicCheckpoint
+{
+public:
+    PeriodicCheckpoint(const FinderOptions &opt, const Checkpoint &initial)
+        : path(opt.checkpointPath), interval(std::chrono::seconds(opt.checkpointEverySeconds)),
+          last(std::chrono::steady_clock::now()), cp(initial)
+    {
+    }
+
+    // fillBest(Checkpoint &) copies the best result so far into the checkpoint
+    template <class FillBest>
+    void maybeSave(const TaskEngine &engine, FillBest fillBest, bool force = false)
+    {
+        if (path.empty())
+            return;
+
+        std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+        if (force)
+            lock.lock();
+        else if (!lock.try_lock())
+            return; // another worker is saving right now
+
+        auto now = std::chrono::steady_clock::now();
+        if (!force && now - last < interval)
+            return;
+        last = now;
+
+        cp.frontier = engine.lowWater();
+        fillBest(cp);
+
+        if (!saveCheckpoint(path, cp))
+            fprintf(stderr, "Failed to write checkpoint '%s'\n", path.c_str());
+    }
+
+private:
+    std::string path;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point last;
+    std::mutex mutex;
+    Checkpoint cp;
+};
@@ -11,7 +11,7 @@ inline constexpr int HALF_CHUNK = CHUNK_SIZE / 2;
 
 // Cubiomes settings
 inline constexpr int MC_VERSION = MC_1_5; // Minecraft JE 1.4.2 - ~1.6.3.
-inline constexpr int QUERY_Y = 64;
+inline constexpr int QUERY_Y = 64; // default of --query-y
 inline constexpr int BIOME_QUERY_SCALE = 1;
 
 // Structure piece sizes from TemplePieces.java (width, height, depth)
@@ -31,4 +31,10 @@ enum TempleType
     TT_WITCH = 4
 }; // Powers of 2 for bitmask
 
+// Default of --types. The finders instantiate their evaluators for the mask
+// chosen at runtime, see withTempleTypes().
 inline constexpr int SELECTED_TEMPLE_TYPES = TT_DESERT | TT_JUNGLE | TT_WITCH;
+
+// Temples (or quads) scoring below this are never reported, which lets the
+// evaluator skip them from the 1:4 bound alone
+inline constexpr int MIN_SWAMP_SPAWN_BLOCKS = 1;
@@ -0,0 +1,72 @@
+#pragma once
+
+// Runtime detection of the x86 vector extensions used by the SIMD kernels.
+// Kernels are compiled for their instruction set with SEEDFINDER_TARGET, so the
+// binary runs everywhere and picks the widest path the CPU supports.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SEEDFINDER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define SEEDFINDER_X86 0
+#endif
+
+#if SEEDFINDER_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SEEDFINDER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SEEDFINDER_TARGET(isa)
+#endif
+
+#if SEEDFINDER_X86 && defined(_MSC_VER)
+inline bool msvcCpuHasAvx2()
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // AVX2 needs both the CPU flag and the OS saving the ymm registers
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+#endif
+
+inline bool cpuHasAvx2()
+{
+#if SEEDFINDER_X86 && (defined(__GNUC__) || defined(__clang__))
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+#elif SEEDFINDER_X86 && defined(_MSC_VER)
+    static const bool has = msvcCpuHasAvx2();
+    return has;
+#else
+    return false;
+#endif
+}
+
+inline bool cpuHasSse41()
+{
+#if SEEDFINDER_X86 && (defined(__GNUC__) || defined(__clang__))
+    static const bool has = __builtin_cpu_supports("sse4.1");
+    return has;
+#elif SEEDFINDER_X86 && defined(_MSC_VER)
+    static const bool has = []
+    {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 19)) != 0;
+    }();
+    return has;
+#else
+    return false;
+#endif
+}
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <config.hpp>
+#include <cstring>
 #include <fstream>
+#include <mc15_layers.hpp>
+#include <metrics.hpp>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 extern "C"
@@ -13,51 +22,66 @@ extern "C"
 #include "quadbase.h"
 }
 
-// Returns temple type if biome is valid and temple type is selected:
-// 1 -> DesertPyramid
-// 2 -> JungleTemple
-// 3 -> WitchHut
-inline int isViableTemplePos(Generator *g, int x, int z)
+// TempleType bit of a temple type (1 desert, 2 jungle, 3 witch)
+inline constexpr int templeTypeBit(int templeType)
 {
-    int biomeAtCenter = getBiomeAt(g, BIOME_QUERY_SCALE, x + HALF_CHUNK, QUERY_Y, z + HALF_CHUNK);
+    return 1 << (templeType - 1);
+}
 
+// Maps the biome at the chunk center to the temple type (0 if none or not in
+// templeTypes). With a constant mask the unselected cases fold away.
+inline constexpr int templeTypeForBiome(int biomeAtCenter, int templeTypes = SELECTED_TEMPLE_TYPES)
+{
     if (biomeAtCenter == desert || biomeAtCenter == desert_hills)
     {
-        return (SELECTED_TEMPLE_TYPES & TT_DESERT) ? 1 : 0;
+        return (templeTypes & TT_DESERT) ? 1 : 0;
     }
     else if (biomeAtCenter == jungle || biomeAtCenter == jungle_hills)
     {
-        return (SELECTED_TEMPLE_TYPES & TT_JUNGLE) ? 2 : 0;
+        return (templeTypes & TT_JUNGLE) ? 2 : 0;
     }
     else if (biomeAtCenter == swampland)
     {
-        return (SELECTED_TEMPLE_TYPES & TT_WITCH) ? 3 : 0;
+        return (templeTypes & TT_WITCH) ? 3 : 0;
     }
 
     return 0;
 }
 
-// Counts witch-only spawning spaces for a given temple
-inline int countSwampSpawnBlocks(Generator *g, int startX, int startZ, int templeType)
+// Returns temple type if biome is valid and temple type is selected:
+// 1 -> DesertPyramid
+// 2 -> JungleTemple
+// 3 -> WitchHut
+inline int isViableTemplePos(Generator *g, int x, int z, int templeTypes = SELECTED_TEMPLE_TYPES, int queryY = QUERY_Y)
 {
-    PieceSize piece;
-    int multiplier = 0;
+    return templeTypeForBiome(getBiomeAt(g, BIOME_QUERY_SCALE, x + HALF_CHUNK, queryY, z + HALF_CHUNK), templeTypes);
+}
 
-    if (templeType == 1)
-    {
-        piece = DESERT_PYRAMID;
-        multiplier = 5;
-    }
-    else if (templeType == 2)
-    {
-        piece = JUNGLE_TEMPLE;
-        multiplier = 4;
-    }
-    else
-    {
-        piece = WITCH_HUT;
-        multiplier = 2;
-    }
+// Bounding box of the temple piece for a given temple type
+inline PieceSize templePiece(int templeType)
+{
+    return templeType == 1 ? DESERT_PYRAMID : templeType == 2 ? JUNGLE_TEMPLE
+                                                              : WITCH_HUT;
+}
+
+// Spawning spaces per swamp block for a given temple type
+inline int templeSpawnMultiplier(int templeType)
+{
+    return templeType == 1 ? 5 : templeType == 2 ? 4
+                                                 : 2;
+}
+
+inline const char *templeTypeName(int templeType)
+{
+    return templeType == 1 ? "DesertPyramid" : templeType == 2 ? "JungleTemple"
+                                                               : "WitchHut";
+}
+
+// Counts witch-only spawning spaces for a given temple
+inline int countSwampSpawnBlocks(Generator *g, int startX, int startZ, int templeType, int queryY = QUERY_Y)
+{
+    PieceSize piece = templePiece(templeType);
+    int multiplier = templeSpawnMultiplier(templeType);
 
     int endX = startX + piece.w;
     int endZ = startZ + piece.d;
@@ -68,7 +92,7 @@ inline int countSwampSpawnBlocks(Generator *g, int startX, int startZ, int templ
     r.z = startZ;
     r.sx = piece.w;
     r.sz = piece.d;
-    r.y = QUERY_Y;
+    r.y = queryY;
     r.sy = 1;
 
     int *biomeIds = allocCache(g, r);
@@ -78,7 +102,7 @@ inline int countSwampSpawnBlocks(Generator *g, int startX, int startZ, int templ
         int swampCount = 0;
         for (int x = startX; x < endX; ++x)
             for (int z = startZ; z < endZ; ++z)
-                if (getBiomeAt(g, BIOME_QUERY_SCALE, x, QUERY_Y, z) == swampland)
+                if (getBiomeAt(g, BIOME_QUERY_SCALE, x, queryY, z) == swampland)
                     ++swampCount;
         return swampCount * multiplier;
     }
@@ -100,3 +124,579 @@ inline int countSwampSpawnBlocks(Generator *g, int startX, int startZ, int templ
     free(biomeIds);
     return swampCount * multiplier;
 }
+
+// Result of evaluating one temple generation attempt
+struct TempleScore
+{
+    int type;             // 0 if not viable, otherwise as isViableTemplePos
+    int swampSpawnBlocks; // as countSwampSpawnBlocks, 0 if not viable
+};
+
+// Every footprint starts at the temple origin, so the largest one together with
+// the chunk center covers all the blocks a candidate can ever need
+inline constexpr int EVAL_AREA_W = std::max({DESERT_PYRAMID.w, JUNGLE_TEMPLE.w, WITCH_HUT.w, HALF_CHUNK + 1});
+inline constexpr int EVAL_AREA_D = std::max({DESERT_PYRAMID.d, JUNGLE_TEMPLE.d, WITCH_HUT.d, HALF_CHUNK + 1});
+
+// Union of the footprints of a set of temple types
+inline constexpr int footprintW(int templeTypes)
+{
+    return std::max({(templeTypes & TT_DESERT) ? DESERT_PYRAMID.w : 0,
+                     (templeTypes & TT_JUNGLE) ? JUNGLE_TEMPLE.w : 0,
+                     (templeTypes & TT_WITCH) ? WITCH_HUT.w : 0});
+}
+inline constexpr int footprintD(int templeTypes)
+{
+    return std::max({(templeTypes & TT_DESERT) ? DESERT_PYRAMID.d : 0,
+                     (templeTypes & TT_JUNGLE) ? JUNGLE_TEMPLE.d : 0,
+                     (templeTypes & TT_WITCH) ? WITCH_HUT.d : 0});
+}
+
+// Calls f(std::integral_constant<int, templeTypes>()), so the finders run a
+// loop instantiated for the mask chosen on the command line. templeTypes
+// must be a nonzero combination of TempleType bits.
+template <typename F>
+decltype(auto) withTempleTypes(int templeTypes, F &&f)
+{
+    switch (templeTypes)
+    {
+    case TT_DESERT:
+        return f(std::integral_constant<int, TT_DESERT>());
+    case TT_JUNGLE:
+        return f(std::integral_constant<int, TT_JUNGLE>());
+    case TT_DESERT | TT_JUNGLE:
+        return f(std::integral_constant<int, TT_DESERT | TT_JUNGLE>());
+    case TT_WITCH:
+        return f(std::integral_constant<int, TT_WITCH>());
+    case TT_DESERT | TT_WITCH:
+        return f(std::integral_constant<int, TT_DESERT | TT_WITCH>());
+    case TT_JUNGLE | TT_WITCH:
+        return f(std::integral_constant<int, TT_JUNGLE | TT_WITCH>());
+    default:
+        return f(std::integral_constant<int, TT_DESERT | TT_JUNGLE | TT_WITCH>());
+    }
+}
+
+// Stages of the viability cascade, coarsest first
+enum CascadeStage
+{
+    CS_256,
+    CS_64,
+    CS_16,
+    CS_4,
+    CS_1,
+    CS_NUM
+};
+
+inline constexpr const char *CASCADE_STAGE_NAMES[CS_NUM] = {"1:256", "1:64", "1:16", "1:4", "1:1"};
+
+// Per-stage counters of one evaluator
+struct CascadeStats
+{
+    uint64_t tested[CS_NUM] = {};
+    uint64_t rejected[CS_NUM] = {};
+    uint64_t exactAt4 = 0; // scored from the 1:4 grid without the 1:1 pass
+
+    CascadeStats &operator+=(const CascadeStats &o)
+    {
+        for (int s = 0; s < CS_NUM; ++s)
+        {
+            tested[s] += o.tested[s];
+            rejected[s] += o.rejected[s];
+        }
+        exactAt4 += o.exactAt4;
+        return *this;
+    }
+};
+
+// Outcome of the coarse stages of the cascade for one candidate
+struct TempleBound
+{
+    int maxScore;      // upper bound of the score, -1 if it cannot be viable
+    TempleScore exact; // exact result if known without the 1:1 pass, else type 0
+};
+
+// Formats the per-stage rejection rates as "1:256=41.2% 1:64=..."
+inline std::string formatCascadeStats(const CascadeStats &st)
+{
+    std::string out;
+    char buf[32];
+    for (int s = 0; s < CS_NUM; ++s)
+    {
+        double rate = st.tested[s] ? 100.0 * st.rejected[s] / st.tested[s] : 0.0;
+        snprintf(buf, sizeof(buf), "%s%s=%.1f%%", s ? " " : "", CASCADE_STAGE_NAMES[s], rate);
+        out += buf;
+    }
+    snprintf(buf, sizeof(buf), " exact@1:4=%.1f%%", st.tested[CS_4] ? 100.0 * st.exactAt4 / st.tested[CS_4] : 0.0);
+    out += buf;
+    return out;
+}
+
+// Maps an inclusive interval of cells at 'entry' onto the interval of cells at
+// 'target' that can influence it, following the biome branch of the stack
+inline void mapIntervalToLayer(const Layer *entry, const Layer *target, int &lo, int &hi)
+{
+    for (const Layer *l = entry; l && l != target; l = l->p)
+    {
+        if (l->zoom == 4)
+        {
+            // mapVoronoi114: cell x picks one of the 1:4 cells (x-2)>>2 and +1
+            lo = (lo - 2) >> 2;
+            hi = ((hi - 2) >> 2) + 1;
+        }
+        else if (l->zoom == 2)
+        {
+            // mapZoom: even cells copy the parent, odd ones also read the next
+            lo >>= 1;
+            hi = (hi + 1) >> 1;
+        }
+        else
+        {
+            lo -= l->edge / 2;
+            hi += l->edge / 2;
+        }
+    }
+}
+
+// Layer whose cells are tested at a stage of the cascade, see TempleEvaluator
+inline const Layer *cascadeStageLayer(const Generator *g, int stage)
+{
+    switch (stage)
+    {
+    case CS_256:
+        return getLayerForScale(g, 256);
+    case CS_64:
+        return &g->ls.layers[L_ZOOM_64];
+    case CS_16:
+        return getLayerForScale(g, 16);
+    case CS_4:
+        return getLayerForScale(g, 4);
+    default:
+        return getLayerForScale(g, BIOME_QUERY_SCALE);
+    }
+}
+
+// Layers of a TempleEvaluator from the cubiomes stack of a generator, through
+// its getMap pointers. Works for every version and for generators whose
+// layers answer from tiles (BiomeTileStack).
+class GeneratorLayers
+{
+public:
+    GeneratorLayers(const Generator *g, int queryY)
+        : g(g), queryY(queryY)
+    {
+        for (int s = 0; s < CS_NUM; ++s)
+            stages[s] = cascadeStageLayer(g, s);
+    }
+
+    // Maps an interval of 1:1 cells onto the cells of a stage, as mapIntervalToLayer()
+    void mapInterval(int stage, int &lo, int &hi) const
+    {
+        mapIntervalToLayer(stages[CS_1], stages[stage], lo, hi);
+    }
+
+    // Buffer length needed to generate w x h cells of a stage
+    size_t cacheSize(int stage, int w, int h) const
+    {
+        size_t len = getMinLayerCacheSize(stages[stage], w, h);
+        if (stage == CS_1 && voronoi114())
+        {
+            const int pW = mc15VoronoiParent(w), pH = mc15VoronoiParent(h);
+            len = std::max(len, (size_t)pW * pH + (size_t)w * h + mc15VoronoiScratch(pW));
+        }
+        return len;
+    }
+
+    // Generates w x h cells of a stage at (x, z), nonzero on failure
+    int gen(int stage, int *out, int x, int z, int w, int h)
+    {
+        if (stage != CS_1)
+            return genArea(stages[stage], out, x, z, w, h);
+
+        // What genBiomes() does for it, with the vector Voronoi kernel
+        if (voronoi114())
+        {
+            const Layer *l = stages[CS_1];
+            x -= 2;
+            z -= 2;
+            const int pX = x >> 2, pZ = z >> 2;
+            const int pW = ((x + w) >> 2) - pX + 2, pH = ((z + h) >> 2) - pZ + 2;
+            if (int err = l->p->getMap(l->p, out, pX, pZ, pW, pH))
+                return err;
+
+            int *buf = out + pW * pH;
+            mc15VoronoiCells(out, pX, pZ, pW, pH, x, z, w, h, l->startSeed, l->startSalt, buf, buf + w * h);
+            memmove(out, buf, sizeof(int) * w * h);
+            return 0;
+        }
+
+        Range r;
+        r.scale = BIOME_QUERY_SCALE;
+        r.x = x;
+        r.z = z;
+        r.sx = w;
+        r.sz = h;
+        r.y = queryY;
+        r.sy = 1;
+        return genBiomes(g, out, r);
+    }
+
+private:
+    // The 1:1 stage is the plain mapVoronoi114() of the overworld layer stack
+    bool voronoi114() const
+    {
+        const Layer *l = stages[CS_1];
+        return g->dim == DIM_OVERWORLD && g->mc >= MC_B1_8 && g->mc <= MC_1_17 && BIOME_QUERY_SCALE == 1 &&
+               l && l->getMap == mapVoronoi114 && l->p;
+    }
+
+    const Generator *g;
+    int queryY;
+    const Layer *stages[CS_NUM];
+};
+
+// Layers of a TempleEvaluator from the compile-time chain of mc15_layers.hpp,
+// seeded from the seed of the generator whenever that changes. Same results
+// as GeneratorLayers on the plain layer stack of a supported version, where
+// biomes do not depend on the query y.
+class Mc15Layers
+{
+public:
+    static constexpr bool SUPPORTED = MC_VERSION > MC_1_2 && MC_VERSION <= MC_1_6 && BIOME_QUERY_SCALE == 1;
+
+    Mc15Layers(const Generator *g, int)
+        : g(g)
+    {
+    }
+
+    static constexpr void mapInterval(int stage, int &lo, int &hi)
+    {
+        switch (stage)
+        {
+        case CS_256:
+            return mc15MapInterval<Mc15Voronoi1, Mc15Biome256>(lo, hi);
+        case CS_64:
+            return mc15MapInterval<Mc15Voronoi1, Mc15Zoom64>(lo, hi);
+        case CS_16:
+            return mc15MapInterval<Mc15Voronoi1, Mc15SwampRiver16>(lo, hi);
+        case CS_4:
+            return mc15MapInterval<Mc15Voronoi1, Mc15RiverMix4>(lo, hi);
+        default:
+            return;
+        }
+    }
+
+    static constexpr size_t cacheSize(int stage, int w, int h)
+    {
+        switch (stage)
+        {
+        case CS_256:
+            return Mc15Biome256::cacheSize(w, h);
+        case CS_64:
+            return Mc15Zoom64::cacheSize(w, h);
+        case CS_16:
+            return Mc15SwampRiver16::cacheSize(w, h);
+        case CS_4:
+            return Mc15RiverMix4::cacheSize(w, h);
+        default:
+            return Mc15Voronoi1::cacheSize(w, h);
+        }
+    }
+
+    int gen(int stage, int *out, int x, int z, int w, int h)
+    {
+        if (!seeded || seededFor != g->seed)
+        {
+            mc15ApplySeed(seeds, g->seed);
+            seededFor = g->seed;
+            seeded = true;
+        }
+
+        switch (stage)
+        {
+        case CS_256:
+            Mc15Biome256::gen(seeds, out, x, z, w, h);
+            break;
+        case CS_64:
+            Mc15Zoom64::gen(seeds, out, x, z, w, h);
+            break;
+        case CS_16:
+            Mc15SwampRiver16::gen(seeds, out, x, z, w, h);
+            break;
+        case CS_4:
+            Mc15RiverMix4::gen(seeds, out, x, z, w, h);
+            break;
+        default:
+            Mc15Voronoi1::gen(seeds, out, x, z, w, h);
+            break;
+        }
+        return 0;
+    }
+
+private:
+    const Generator *g;
+    Mc15Seeds seeds;
+    uint64_t seededFor = 0;
+    bool seeded = false;
+};
+
+// Per-thread replacement for isViableTemplePos + countSwampSpawnBlocks. The
+// type and score come from a single 1:1 query into a buffer allocated once,
+// so evaluating a candidate does not touch the heap. Layers is the backend
+// that generates the stages, GeneratorLayers or Mc15Layers. TempleTypes is
+// the mask of types searched for: the others and their footprints are
+// pruned at compile time, see withTempleTypes().
+//
+// Before the 1:1 query the candidate goes through a cascade of the coarser
+// layers. None of the MC_1_5 layers below L_BIOME_256 can turn another biome
+// into desert, jungle or swamp (zooms, smoothing and Voronoi only pick one of
+// the parent cells, hills only swap desert/jungle for their hills variant and
+// shores/rivers only replace them), so a candidate whose influence area holds
+// no temple biome at some scale cannot be viable at 1:1. The 1:64 stage reads
+// L_ZOOM_64 instead of the L_HILLS_64 entry for that reason, which skips the
+// hills noise branch.
+template <typename Layers, int TempleTypes = SELECTED_TEMPLE_TYPES>
+class BasicTempleEvaluator
+{
+public:
+    static_assert(TempleTypes > 0 && (TempleTypes & ~(TT_DESERT | TT_JUNGLE | TT_WITCH)) == 0, "invalid temple type mask");
+
+    using LayerBackend = Layers;
+    static constexpr int TEMPLE_TYPES = TempleTypes;
+    static constexpr int FOOTPRINT_W = footprintW(TempleTypes);
+    static constexpr int FOOTPRINT_D = footprintD(TempleTypes);
+
+    explicit BasicTempleEvaluator(const Generator *g, int queryY = QUERY_Y)
+        : layers(g, queryY)
+    {
+        size_t len = layers.cacheSize(CS_1, EVAL_AREA_W, EVAL_AREA_D);
+
+        // The stage areas depend on the alignment of the candidate, which
+        // repeats every 256 blocks
+        for (int s = 0; s < CS_1; ++s)
+        {
+            int maxW = 0;
+            for (int x = 0; x < 256; ++x)
+            {
+                int lo = x, hi = x + EVAL_AREA_W - 1;
+                layers.mapInterval(s, lo, hi);
+                maxW = std::max(maxW, hi - lo + 1);
+            }
+            len = std::max(len, layers.cacheSize(s, maxW, maxW));
+        }
+        cache.resize(len);
+    }
+
+    // Counts candidates and times the stages into m, null to disable
+    void setMetrics(ThreadMetrics *m)
+    {
+        metrics = m;
+    }
+
+    // Runs the coarse stages for the temple at (x, z). A bound with
+    // maxScore < minScore means the candidate was rejected, minScore = 0
+    // only rejects candidates that cannot be viable at all. Candidates
+    // that already passed the stages before firstStage elsewhere (see
+    // SeedLaneFilter) resume there and were counted by that caller.
+    TempleBound bound(int x, int z, int minScore = 0, int firstStage = CS_256)
+    {
+        ThreadMetrics::StageTimer timer(metrics, STAGE_CASCADE);
+        TempleBound b = {-1, {0, 0}};
+        for (int s = firstStage; s < CS_1; ++s)
+            if (testStage(s, x, z, minScore, b))
+                return b;
+        return {-1, {0, 0}};
+    }
+
+    // Runs coarse stage s (before CS_1) alone for the temple at (x, z), so a
+    // batch can go through the cascade one stage at a time (see
+    // CandidatePipeline). Returns true when the candidate is decided, with
+    // its bound in b as bound() would return it: rejected at this stage, or
+    // bounded at CS_4. False passes it on to stage s + 1.
+    bool testStage(int s, int x, int z, int minScore, TempleBound &b)
+    {
+        if (s == CS_256)
+            count(CTR_CANDIDATES);
+        ++stats.tested[s];
+
+        const int cx = x + HALF_CHUNK, cz = z + HALF_CHUNK;
+
+        // Influence area of the chunk center and of the footprints
+        int cx0 = cx, cx1 = cx, cz0 = cz, cz1 = cz;
+        int fx0 = x, fx1 = x + FOOTPRINT_W - 1;
+        int fz0 = z, fz1 = z + FOOTPRINT_D - 1;
+        layers.mapInterval(s, cx0, cx1);
+        layers.mapInterval(s, cz0, cz1);
+        layers.mapInterval(s, fx0, fx1);
+        layers.mapInterval(s, fz0, fz1);
+
+        int ax = std::min(cx0, fx0), az = std::min(cz0, fz0);
+        int aw = std::max(cx1, fx1) - ax + 1, ah = std::max(cz1, fz1) - az + 1;
+        if (layers.gen(s, cache.data(), ax, az, aw, ah) != 0)
+        {
+            b = {-1, {0, 0}};
+            return true;
+        }
+
+        if (!anyInArea(cx0 - ax, cz0 - az, cx1 - ax, cz1 - az, aw, [](int id)
+                       { return templeTypeForBiome(id, TempleTypes) != 0; }))
+        {
+            ++stats.rejected[s];
+            count(CTR_REJECTED_BIOME);
+            b = {-1, {0, 0}};
+            return true;
+        }
+        if (minScore > 0 && !anyInArea(fx0 - ax, fz0 - az, fx1 - ax, fz1 - az, aw, [](int id)
+                                       { return id == swampland; }))
+        {
+            ++stats.rejected[s];
+            count(CTR_REJECTED_SCORE);
+            b = {0, {0, 0}};
+            return true;
+        }
+        if (s != CS_4)
+            return false;
+
+        b = boundFrom4(x, z, ax, az, aw);
+        if (b.maxScore < minScore)
+        {
+            ++stats.rejected[s];
+            count(CTR_REJECTED_SCORE);
+        }
+        else if (b.exact.type)
+        {
+            ++stats.exactAt4;
+            count(CTR_SCORED);
+        }
+        return true;
+    }
+
+    // Type and score of the temple at (x, z) straight from the 1:1 layer
+    TempleScore evaluateExact(int x, int z)
+    {
+        ThreadMetrics::StageTimer timer(metrics, STAGE_SCORE);
+        ++stats.tested[CS_1];
+
+        if (layers.gen(CS_1, cache.data(), x, z, EVAL_AREA_W, EVAL_AREA_D) != 0)
+            return {0, 0};
+
+        int templeType = templeTypeForBiome(cache[HALF_CHUNK * EVAL_AREA_W + HALF_CHUNK], TempleTypes);
+        if (templeType == 0)
+        {
+            ++stats.rejected[CS_1];
+            count(CTR_REJECTED_BIOME);
+            return {0, 0};
+        }
+
+        PieceSize piece = templePiece(templeType);
+        int swampCount = 0;
+        for (int iz = 0; iz < piece.d; ++iz)
+        {
+            const int *row = cache.data() + iz * EVAL_AREA_W;
+            for (int ix = 0; ix < piece.w; ++ix)
+                if (row[ix] == swampland)
+                    ++swampCount;
+        }
+
+        count(CTR_SCORED);
+        return {templeType, swampCount * templeSpawnMultiplier(templeType)};
+    }
+
+    // Returns the exact type and score of the temple at (x, z). Candidates
+    // whose score is provably below minScore may be returned as {0, 0}
+    // without reaching the 1:1 layer; minScore = 0 never prunes viable ones.
+    TempleScore evaluate(int x, int z, int minScore = 0)
+    {
+        TempleBound b = bound(x, z, minScore);
+        if (b.maxScore < minScore || b.maxScore < 0)
+            return {0, 0};
+        if (b.exact.type)
+            return b.exact;
+        return evaluateExact(x, z);
+    }
+
+    const CascadeStats &cascadeStats() const
+    {
+        return stats;
+    }
+
+private:
+    // Bounds the score from the 1:4 cells in the cache, where (ax, az) is the
+    // origin of the generated area and aw its width. mapVoronoi114 assigns
+    // block b one of the 1:4 cells (b-2)>>2 and +1 on each axis, so a block
+    // can only be swamp if one of those four is, and must be if all four are.
+    TempleBound boundFrom4(int x, int z, int ax, int az, int aw) const
+    {
+        auto at = [&](int px, int pz)
+        { return cache[(pz - az) * aw + (px - ax)]; };
+
+        const int pcx = (x + HALF_CHUNK - 2) >> 2, pcz = (z + HALF_CHUNK - 2) >> 2;
+        int typeMask = 0; // bit t set if the center can end up as type t
+        for (int j = 0; j < 2; ++j)
+            for (int i = 0; i < 2; ++i)
+                typeMask |= 1 << templeTypeForBiome(at(pcx + i, pcz + j), TempleTypes);
+
+        TempleBound b = {0, {0, 0}};
+        for (int templeType = 1; templeType <= 3; ++templeType)
+        {
+            if (!(TempleTypes & templeTypeBit(templeType)) || !(typeMask & (1 << templeType)))
+                continue;
+
+            PieceSize piece = templePiece(templeType);
+            int maybe = 0, surely = 0;
+            for (int pz = (z - 2) >> 2; pz <= (z + piece.d - 3) >> 2; ++pz)
+            {
+                // Number of footprint blocks in [4p+2, 4p+5] on each axis
+                int nz = std::min(z + piece.d - 1, 4 * pz + 5) - std::max(z, 4 * pz + 2) + 1;
+                for (int px = (x - 2) >> 2; px <= (x + piece.w - 3) >> 2; ++px)
+                {
+                    int nx = std::min(x + piece.w - 1, 4 * px + 5) - std::max(x, 4 * px + 2) + 1;
+                    int swamps = (at(px, pz) == swampland) + (at(px + 1, pz) == swampland) +
+                                 (at(px, pz + 1) == swampland) + (at(px + 1, pz + 1) == swampland);
+                    if (swamps > 0)
+                        maybe += nx * nz;
+                    if (swamps == 4)
+                        surely += nx * nz;
+                }
+            }
+
+            int multiplier = templeSpawnMultiplier(templeType);
+            b.maxScore = std::max(b.maxScore, maybe * multiplier);
+            if (typeMask == (1 << templeType) && maybe == surely)
+                b.exact = {templeType, maybe * multiplier};
+        }
+
+        return b;
+    }
+
+    void count(MetricCounter c)
+    {
+        if (metrics)
+            metrics->add(c);
+    }
+
+    template <typename Pred>
+    bool anyInArea(int x0, int z0, int x1, int z1, int w, Pred pred) const
+    {
+        for (int iz = z0; iz <= z1; ++iz)
+            for (int ix = x0; ix <= x1; ++ix)
+                if (pred(cache[iz * w + ix]))
+                    return true;
+        return false;
+    }
+
+    Layers layers;
+    std::vector<int> cache;
+    CascadeStats stats;
+    ThreadMetrics *metrics = nullptr;
+};
+
+// Evaluator on the layer stack of any generator
+template <int TempleTypes>
+using TempleEvaluatorFor = BasicTempleEvaluator<GeneratorLayers, TempleTypes>;
+using TempleEvaluator = TempleEvaluatorFor<SELECTED_TEMPLE_TYPES>;
+
+// Evaluator on the compile-time chain where the version has one, for finders
+// that query a plain seeded generator
+template <int TempleTypes>
+using FixedTempleEvaluatorFor = BasicTempleEvaluator<std::conditional_t<Mc15Layers::SUPPORTED, Mc15Layers, GeneratorLayers>, TempleTypes>;
+using FixedTempleEvaluator = FixedTempleEvaluatorFor<SELECTED_TEMPLE_TYPES>;
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <finder_utils.hpp>
+
+#include <cstring>
+#include <vector>
+
+// Memoizing cache for the coarse layers of a generator, one per thread.
+//
+// Neighbouring queries of a seed scan ask the layers from L_CONTINENT_4096 up
+// to L_ZOOM_64 for overlapping areas, and genArea recomputes them every time.
+// The cache installs itself in place of the getMap of those layers, so every
+// query of the generator (genBiomes, genArea, getBiomeAt, a TempleEvaluator)
+// goes through it without changes to the caller. A layer answers from fixed
+// SLAB_CELLS x SLAB_CELLS slabs aligned to a grid of its cells: a missing slab
+// is generated once with the real layer function and kept until it is the
+// least recently used one and its slot is needed.
+//
+// The cells depend on the world seed, so the slabs belong to the seed they
+// were generated for. applySeed() is a cubiomes function and cannot notify
+// the cache, so every lookup compares the seed of the generator first and
+// drops all slabs when it changed; invalidate() does the same explicitly.
+//
+// The generator must not be copied or moved while the cache is installed.
+class CoarseLayerCache
+{
+public:
+    static constexpr int SLAB_CELLS = 16;
+    static constexpr int LAST_CACHED_LAYER = L_ZOOM_64;
+
+    // Requests covering more slabs than this bypass the cache, so large
+    // areas (e.g. the tiles of BiomeTileStack) do not flush it
+    static constexpr int MAX_SLABS_PER_QUERY = 16;
+
+    // A query far from the cached ones needs about 330 new slabs over all
+    // layers, since every 3x3 kernel widens the area by a slab. With fewer
+    // slots a slab is evicted before its neighbours reuse it, and the misses
+    // cascade exponentially up the stack.
+    static constexpr int MIN_SLABS = 1024;
+
+    struct Stats
+    {
+        uint64_t hits = 0;      // slab lookups answered from the cache
+        uint64_t misses = 0;    // slabs generated
+        uint64_t evictions = 0; // slabs dropped for space
+        uint64_t bypassed = 0;  // queries too large for the cache
+        uint64_t invalidations = 0;
+
+        double hitRate() const
+        {
+            return hits + misses ? (double)hits / (hits + misses) : 0.0;
+        }
+    };
+
+    // Hooks the coarse layers of g, which may be seeded before or after.
+    // maxSlabs (at least MIN_SLABS) fixes the memory of the slabs.
+    CoarseLayerCache(Generator *g, int maxSlabs = 4096)
+        : g(g), capacity(std::max(maxSlabs, MIN_SLABS))
+    {
+        int buckets = 1;
+        while (buckets < 2 * capacity)
+            buckets <<= 1;
+        bucketMask = buckets - 1;
+        heads.resize(buckets);
+        slots.resize(capacity);
+        cells.resize((size_t)capacity * SLAB_CELLS * SLAB_CELLS);
+        invalidate();
+        stats.invalidations = 0;
+
+        if (g->mc > MC_1_17 || g->mc <= MC_B1_7)
+            return; // no layer stack
+
+        // The layers point into hooks, which must not reallocate
+        hooks.reserve(LAST_CACHED_LAYER + 1);
+        hookLayers(g->entry ? g->entry : g->ls.entry_1);
+    }
+
+    ~CoarseLayerCache()
+    {
+        for (Hook &hook : hooks)
+        {
+            hook.layer->getMap = hook.getMap;
+            hook.layer->data = nullptr;
+        }
+    }
+
+    CoarseLayerCache(const CoarseLayerCache &) = delete;
+    CoarseLayerCache &operator=(const CoarseLayerCache &) = delete;
+
+    // Drops every slab
+    void invalidate()
+    {
+        std::fill(heads.begin(), heads.end(), -1);
+        for (int i = 0; i < capacity; ++i)
+            slots[i].next = i + 1 < capacity ? i + 1 : -1;
+        freeList = 0;
+        lruHead = lruTail = -1;
+        used = 0;
+        seed = g->seed;
+        ++stats.invalidations;
+    }
+
+    const Stats &statistics() const
+    {
+        return stats;
+    }
+
+    // Number of layers answered from the cache
+    int cachedLayers() const
+    {
+        return (int)hooks.size();
+    }
+
+    int slabsUsed() const
+    {
+        return used;
+    }
+
+    // Bytes held by the slabs, the index and the generation buffers
+    size_t memoryBytes() const
+    {
+        size_t bytes = cells.size() * sizeof(int) + slots.size() * sizeof(Slot) + heads.size() * sizeof(int);
+        for (const Hook &hook : hooks)
+            bytes += hook.scratch.size() * sizeof(int);
+        return bytes;
+    }
+
+private:
+    struct Hook
+    {
+        CoarseLayerCache *owner;
+        Layer *layer;
+        mapfunc_t *getMap; // the real layer function
+        int id;            // index in the layer stack, part of the slab key
+        std::vector<int> scratch;
+    };
+
+    // Key and links of one slab slot: next in the bucket chain (or the free
+    // list) and the neighbours in the LRU list, most recent first
+    struct Slot
+    {
+        int layer, sx, sz;
+        int next;
+        int newer, older;
+    };
+
+    void hookLayers(Layer *l)
+    {
+        if (!l || !l->getMap || l->getMap == mapCached)
+            return;
+        hookLayers(l->p);
+        hookLayers(l->p2);
+
+        const ptrdiff_t id = l - g->ls.layers;
+        if (id < 0 || id > LAST_CACHED_LAYER || l->data)
+            return; // not a coarse layer, already hooked or used by someone else
+
+        hooks.push_back({this, l, l->getMap, (int)id, std::vector<int>(getMinLayerCacheSize(l, SLAB_CELLS, SLAB_CELLS))});
+        l->getMap = mapCached;
+        l->data = &hooks.back();
+    }
+
+    static int floorDiv(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    int bucketOf(int layer, int sx, int sz) const
+    {
+        uint32_t h = (uint32_t)layer * 0x9E3779B1u ^ (uint32_t)sx * 0x85EBCA77u ^ (uint32_t)sz * 0xC2B2AE3Du;
+        return (int)((h ^ (h >> 15)) & (uint32_t)bucketMask);
+    }
+
+    void unlinkLru(int i)
+    {
+        Slot &s = slots[i];
+        if (s.newer >= 0)
+            slots[s.newer].older = s.older;
+        else
+            lruHead = s.older;
+        if (s.older >= 0)
+            slots[s.older].newer = s.newer;
+        else
+            lruTail = s.newer;
+    }
+
+    void pushLru(int i)
+    {
+        slots[i].newer = -1;
+        slots[i].older = lruHead;
+        if (lruHead >= 0)
+            slots[lruHead].newer = i;
+        lruHead = i;
+        if (lruTail < 0)
+            lruTail = i;
+    }
+
+    // Takes a free slot, evicting the least recently used slab if there is none
+    int acquireSlot()
+    {
+        if (freeList >= 0)
+        {
+            int i = freeList;
+            freeList = slots[i].next;
+            ++used;
+            return i;
+        }
+
+        int i = lruTail;
+        unlinkLru(i);
+        int *link = &heads[bucketOf(slots[i].layer, slots[i].sx, slots[i].sz)];
+        while (*link != i)
+            link = &slots[*link].next;
+        *link = slots[i].next;
+        ++stats.evictions;
+        return i;
+    }
+
+    // Cells of slab (sx, sz) of a layer, null if the layer failed
+    const int *slab(Hook &hook, int sx, int sz)
+    {
+        const int bucket = bucketOf(hook.id, sx, sz);
+        for (int i = heads[bucket]; i >= 0; i = slots[i].next)
+        {
+            const Slot &s = slots[i];
+            if (s.layer == hook.id && s.sx == sx && s.sz == sz)
+            {
+                ++stats.hits;
+                if (i != lruHead)
+                {
+                    unlinkLru(i);
+                    pushLru(i);
+                }
+                return &cells[(size_t)i * SLAB_CELLS * SLAB_CELLS];
+            }
+        }
+
+        // Generate before taking a slot: the parents go through the cache too
+        ++stats.misses;
+        memset(hook.scratch.data(), 0, sizeof(int) * SLAB_CELLS * SLAB_CELLS);
+        if (hook.getMap(hook.layer, hook.scratch.data(), sx * SLAB_CELLS, sz * SLAB_CELLS, SLAB_CELLS, SLAB_CELLS) != 0)
+            return nullptr;
+
+        const int i = acquireSlot();
+        slots[i].layer = hook.id;
+        slots[i].sx = sx;
+        slots[i].sz = sz;
+        slots[i].next = heads[bucket];
+        heads[bucket] = i;
+        pushLru(i);
+
+        int *dst = &cells[(size_t)i * SLAB_CELLS * SLAB_CELLS];
+        memcpy(dst, hook.scratch.data(), sizeof(int) * SLAB_CELLS * SLAB_CELLS);
+        return dst;
+    }
+
+    static int mapCached(const Layer *l, int *out, int x, int z, int w, int h)
+    {
+        Hook &hook = *(Hook *)l->data;
+        CoarseLayerCache &c = *hook.owner;
+        if (c.seed != c.g->seed)
+            c.invalidate();
+
+        const int sx0 = floorDiv(x, SLAB_CELLS), sx1 = floorDiv(x + w - 1, SLAB_CELLS);
+        const int sz0 = floorDiv(z, SLAB_CELLS), sz1 = floorDiv(z + h - 1, SLAB_CELLS);
+        if ((sx1 - sx0 + 1) * (sz1 - sz0 + 1) > MAX_SLABS_PER_QUERY)
+        {
+            ++c.stats.bypassed;
+            return hook.getMap(l, out, x, z, w, h);
+        }
+
+        for (int sz = sz0; sz <= sz1; ++sz)
+        {
+            const int z0 = std::max(z, sz * SLAB_CELLS), z1 = std::min(z + h, (sz + 1) * SLAB_CELLS);
+            for (int sx = sx0; sx <= sx1; ++sx)
+            {
+                const int *src = c.slab(hook, sx, sz);
+                if (!src)
+                    return 1;
+
+                const int x0 = std::max(x, sx * SLAB_CELLS), x1 = std::min(x + w, (sx + 1) * SLAB_CELLS);
+                for (int j = z0; j < z1; ++j)
+                    memcpy(out + (size_t)(j - z) * w + (x0 - x), src + (j - sz * SLAB_CELLS) * SLAB_CELLS + (x0 - sx * SLAB_CELLS), sizeof(int) * (x1 - x0));
+            }
+        }
+        return 0;
+    }
+
+    Generator *g;
+    int capacity;
+    int bucketMask = 0;
+    std::vector<int> heads;   // first slot of each bucket, -1 if empty
+    std::vector<Slot> slots;
+    std::vector<int> cells;   // SLAB_CELLS^2 cells per slot
+    std::vector<Hook> hooks;
+    int freeList = -1;
+    int lruHead = -1, lruTail = -1;
+    int used = 0;
+    uint64_t seed = 0;
+    Stats stats;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. The contents are read straight
+// from the page cache, so files of any size are never copied to the heap.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    MappedFile(MappedFile &&o) noexcept
+    {
+        *this = std::move(o);
+    }
+
+    MappedFile &operator=(MappedFile &&o) noexcept
+    {
+        if (this != &o)
+        {
+            close();
+            std::swap(base, o.base);
+            std::swap(length, o.length);
+#if defined(_WIN32)
+            std::swap(file, o.file);
+            std::swap(mapping, o.mapping);
+#endif
+        }
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Maps path, false if it cannot be opened or is shorter than minLength
+    bool open(const std::string &path, size_t minLength = 1)
+    {
+        close();
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || (size_t)size.QuadPart < minLength || size.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        length = (size_t)size.QuadPart;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        base = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < minLength || st.st_size == 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+            return false;
+        }
+        length = (size_t)st.st_size;
+        void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        base = p == MAP_FAILED ? nullptr : (const char *)p;
+        if (base)
+            madvise(p, length, MADV_SEQUENTIAL);
+        ::close(fd);
+#endif
+        if (!base)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    const char *data() const
+    {
+        return base;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if (base)
+            UnmapViewOfFile(base);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base)
+            munmap((void *)base, length);
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+private:
+    const char *base = nullptr;
+    size_t length = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
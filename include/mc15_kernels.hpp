@@ -0,0 +1,838 @@
+#pragma once
+
+#include <config.hpp>
+#include <cpu_features.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+extern "C"
+{
+#include "generator.h"
+}
+
+// Per-cell kernels of the MC_1_5 layers that run on every cell of wide
+// areas: mapVoronoi114(), mapZoom()/mapZoomFuzzy(), mapSmooth() and
+// mapShore() before 1.7. Each has the scalar kernel of cubiomes and SSE4.1
+// and AVX2 paths with cells as lanes, bit-identical to it. The layers pick
+// the widest path the CPU supports (mc15Isa()); tests pass one explicitly.
+//
+//   Voronoi  uniform cells are stored as vectors, the jitter of the cell
+//            centers is computed once per point (4 cells share a corner), and
+//            the 4 pixels of a cell row are compared as exact double distances
+//   Zoom     one 32-bit LCG per parent cell, 8 (AVX2) or 4 cells at once
+//   Smooth   compares as lanes, the rare random tie-break per lane
+//   Shore    compares and blends only
+//
+// mapLand16() draws a data dependent number of random values per cell and
+// is left scalar.
+
+enum Mc15Isa
+{
+    MC15_SCALAR,
+    MC15_SSE41,
+    MC15_AVX2,
+};
+
+inline Mc15Isa mc15Isa()
+{
+#if SEEDFINDER_X86
+    if (cpuHasAvx2())
+        return MC15_AVX2;
+    if (cpuHasSse41())
+        return MC15_SSE41;
+#endif
+    return MC15_SCALAR;
+}
+
+// Path for rows of n cells: narrower rows than a vector stay scalar, the
+// call per row would cost more than it saves
+inline Mc15Isa mc15RowIsa(Mc15Isa isa, int n)
+{
+    if (isa == MC15_AVX2 && n < 8)
+        isa = MC15_SSE41;
+    return isa == MC15_SSE41 && n < 4 ? MC15_SCALAR : isa;
+}
+
+inline const char *mc15IsaName(Mc15Isa isa)
+{
+    return isa == MC15_AVX2 ? "avx2" : isa == MC15_SSE41 ? "sse4.1" : "scalar";
+}
+
+// Multipliers of the 32-bit LCG of mapZoom()
+inline constexpr uint32_t MC15_ZOOM_MUL = 1284865837;
+inline constexpr uint32_t MC15_ZOOM_ADD = 4150755663;
+
+// Offset of a jittered Voronoi cell center on one axis, in 1/10240 of a 1:4
+// cell, as (mcFirstInt(cs, 1024) - 512) * 36
+inline int mc15VoronoiJitter(uint64_t cs)
+{
+    return ((int)((cs >> 24) & 1023) - 512) * 36;
+}
+
+// Scratch ints mc15VoronoiCells() needs after the output, for a parent width pW
+inline constexpr size_t mc15VoronoiScratch(int pW)
+{
+    return 6 * (size_t)pW;
+}
+
+// ---------------------------------------------------------------------------
+// Scalar kernels
+
+// mapVoronoi114() from the 1:4 cells of the parent area (pX, pZ, pW, pH) in
+// out into the w x h cells of buf, for the area (x, z) already moved by -2
+inline void mc15VoronoiCellsScalar(const int *out, int pX, int pZ, int pW, int pH, int x, int z, int w, int h,
+                                   uint64_t ss, uint64_t st, int *buf)
+{
+    for (int pj = 0; pj < pH - 1; ++pj)
+    {
+        const int j4 = (pZ + pj) * 4 - z;
+        for (int pi = 0; pi < pW - 1; ++pi)
+        {
+            const int i4 = (pX + pi) * 4 - x;
+            const int v00 = out[pi + pj * pW], v10 = out[pi + 1 + pj * pW];
+            const int v01 = out[pi + (pj + 1) * pW], v11 = out[pi + 1 + (pj + 1) * pW];
+            const int j0 = std::max(0, -j4), j1 = std::min(4, h - j4);
+            const int i0 = std::max(0, -i4), i1 = std::min(4, w - i4);
+
+            if (v00 == v01 && v00 == v10 && v00 == v11)
+            {
+                for (int jj = j0; jj < j1; ++jj)
+                    for (int ii = i0; ii < i1; ++ii)
+                        buf[(j4 + jj) * w + i4 + ii] = v00;
+                continue;
+            }
+
+            uint64_t cs = getChunkSeed(ss, (pi + pX) * 4, (pj + pZ) * 4);
+            const int64_t da1 = mc15VoronoiJitter(cs), da2 = mc15VoronoiJitter(mcStepSeed(cs, st));
+            cs = getChunkSeed(ss, (pi + pX + 1) * 4, (pj + pZ) * 4);
+            const int64_t db1 = mc15VoronoiJitter(cs) + 40 * 1024, db2 = mc15VoronoiJitter(mcStepSeed(cs, st));
+            cs = getChunkSeed(ss, (pi + pX) * 4, (pj + pZ + 1) * 4);
+            const int64_t dc1 = mc15VoronoiJitter(cs), dc2 = mc15VoronoiJitter(mcStepSeed(cs, st)) + 40 * 1024;
+            cs = getChunkSeed(ss, (pi + pX + 1) * 4, (pj + pZ + 1) * 4);
+            const int64_t dd1 = mc15VoronoiJitter(cs) + 40 * 1024, dd2 = mc15VoronoiJitter(mcStepSeed(cs, st)) + 40 * 1024;
+
+            for (int jj = j0; jj < j1; ++jj)
+            {
+                const int64_t mj = 10240 * jj;
+                const int64_t sja = (mj - da2) * (mj - da2), sjb = (mj - db2) * (mj - db2);
+                const int64_t sjc = (mj - dc2) * (mj - dc2), sjd = (mj - dd2) * (mj - dd2);
+                for (int ii = i0; ii < i1; ++ii)
+                {
+                    const int64_t mi = 10240 * ii;
+                    const int64_t da = (mi - da1) * (mi - da1) + sja, db = (mi - db1) * (mi - db1) + sjb;
+                    const int64_t dc = (mi - dc1) * (mi - dc1) + sjc, dd = (mi - dd1) * (mi - dd1) + sjd;
+
+                    int v;
+                    if (da < db && da < dc && da < dd)
+                        v = v00;
+                    else if (db < da && db < dc && db < dd)
+                        v = v10;
+                    else if (dc < da && dc < db && dc < dd)
+                        v = v01;
+                    else
+                        v = v11;
+                    buf[(j4 + jj) * w + i4 + ii] = v;
+                }
+            }
+        }
+    }
+}
+
+// Jitter of one row of 1:4 points for the mixed cells of the vector paths,
+// each point computed once, when a cell first needs it. tag[i] is the z of
+// the point held at i. The 64-bit LCG has no fast vector multiply before
+// AVX-512, so the points stay scalar.
+struct Mc15VoronoiJitterRow
+{
+    int *j1, *j2, *tag;
+};
+
+// Offsets of the corners a, b, c, d of the mixed cell (pX + pi, pz), x and z
+// of each, as mapVoronoi114()
+inline void mc15VoronoiCorners(Mc15VoronoiJitterRow top, Mc15VoronoiJitterRow bottom, uint64_t ss, uint64_t st,
+                               int pX, int pz, int pi, int64_t d[8])
+{
+    auto point = [&](Mc15VoronoiJitterRow r, int i, int z)
+    {
+        if (r.tag[i] == z)
+            return;
+        const uint64_t cs = getChunkSeed(ss, (pX + i) * 4, z * 4);
+        r.j1[i] = mc15VoronoiJitter(cs);
+        r.j2[i] = mc15VoronoiJitter(mcStepSeed(cs, st));
+        r.tag[i] = z;
+    };
+    point(top, pi, pz);
+    point(top, pi + 1, pz);
+    point(bottom, pi, pz + 1);
+    point(bottom, pi + 1, pz + 1);
+
+    d[0] = top.j1[pi];
+    d[1] = top.j2[pi];
+    d[2] = top.j1[pi + 1] + 40 * 1024;
+    d[3] = top.j2[pi + 1];
+    d[4] = bottom.j1[pi];
+    d[5] = bottom.j2[pi] + 40 * 1024;
+    d[6] = bottom.j1[pi + 1] + 40 * 1024;
+    d[7] = bottom.j2[pi + 1] + 40 * 1024;
+}
+
+// Pixels ii in [i0, i1), jj in [j0, j1) of the uniform cell at (i4, j4) of buf
+inline void mc15VoronoiFill(int v, int i4, int j4, int i0, int i1, int j0, int j1, int *buf, int w)
+{
+    for (int jj = j0; jj < j1; ++jj)
+        std::fill(buf + (j4 + jj) * w + i4 + i0, buf + (j4 + jj) * w + i4 + i1, v);
+}
+
+// Same for a mixed cell, from the offsets of its corners
+inline void mc15VoronoiPixels(const int64_t d[8], const int v[4], int i4, int j4, int i0, int i1, int j0, int j1, int *buf, int w)
+{
+    for (int jj = j0; jj < j1; ++jj)
+    {
+        const int64_t mj = 10240 * jj;
+        const int64_t sja = (mj - d[1]) * (mj - d[1]), sjb = (mj - d[3]) * (mj - d[3]);
+        const int64_t sjc = (mj - d[5]) * (mj - d[5]), sjd = (mj - d[7]) * (mj - d[7]);
+        for (int ii = i0; ii < i1; ++ii)
+        {
+            const int64_t mi = 10240 * ii;
+            const int64_t da = (mi - d[0]) * (mi - d[0]) + sja, db = (mi - d[2]) * (mi - d[2]) + sjb;
+            const int64_t dc = (mi - d[4]) * (mi - d[4]) + sjc, dd = (mi - d[6]) * (mi - d[6]) + sjd;
+            int r;
+            if (da < db && da < dc && da < dd)
+                r = v[0];
+            else if (db < da && db < dc && db < dd)
+                r = v[1];
+            else if (dc < da && dc < db && dc < dd)
+                r = v[2];
+            else
+                r = v[3];
+            buf[(j4 + jj) * w + i4 + ii] = r;
+        }
+    }
+}
+
+// Cells i >= from of one row of mapZoom(): parent rows r0 (j) and r1 (j+1)
+// into output rows o0 (2j) and o1 (2j+1)
+template <bool Fuzzy>
+inline void mc15ZoomRowScalar(const int *r0, const int *r1, int from, int pW, int pX, int chunkZ, uint32_t ss, uint32_t st,
+                              int *o0, int *o1)
+{
+    for (int i = from; i < pW; ++i)
+    {
+        const int v00 = r0[i], v10 = r0[i + 1], v01 = r1[i], v11 = r1[i + 1];
+        if (v00 == v01 && v00 == v10 && v00 == v11)
+        {
+            o0[2 * i] = o0[2 * i + 1] = o1[2 * i] = o1[2 * i + 1] = v00;
+            continue;
+        }
+
+        const int chunkX = (i + pX) * 2;
+        uint32_t cs = ss;
+        cs += chunkX;
+        cs *= cs * MC15_ZOOM_MUL + MC15_ZOOM_ADD;
+        cs += chunkZ;
+        cs *= cs * MC15_ZOOM_MUL + MC15_ZOOM_ADD;
+        cs += chunkX;
+        cs *= cs * MC15_ZOOM_MUL + MC15_ZOOM_ADD;
+        cs += chunkZ;
+
+        o0[2 * i] = v00;
+        o1[2 * i] = (cs >> 24) & 1 ? v01 : v00;
+        cs *= cs * MC15_ZOOM_MUL + MC15_ZOOM_ADD;
+        cs += st;
+        o0[2 * i + 1] = (cs >> 24) & 1 ? v10 : v00;
+
+        auto fuzzy = [&]()
+        {
+            uint32_t c = cs * (cs * MC15_ZOOM_MUL + MC15_ZOOM_ADD) + st;
+            const int r = (c >> 24) & 3;
+            return r == 0 ? v00 : r == 1 ? v10 : r == 2 ? v01 : v11;
+        };
+        if (Fuzzy)
+        {
+            o1[2 * i + 1] = fuzzy();
+            continue;
+        }
+
+        const int cv00 = (v00 == v10) + (v00 == v01) + (v00 == v11);
+        const int cv10 = (v10 == v01) + (v10 == v11);
+        const int cv01 = (v01 == v11);
+        if (cv00 > cv10 && cv00 > cv01)
+            o1[2 * i + 1] = v00;
+        else if (cv10 > cv00)
+            o1[2 * i + 1] = v10;
+        else if (cv01 > cv00)
+            o1[2 * i + 1] = v01;
+        else
+            o1[2 * i + 1] = fuzzy();
+    }
+}
+
+// mapSmooth() of the cell at (x, z), where a points at its top left
+// neighbour in the parent area of width pW
+inline int mc15SmoothCell(const int *a, int pW, uint64_t ss, int x, int z)
+{
+    const int v11 = a[pW + 1], v01 = a[pW], v10 = a[1];
+    if (v11 == v01 && v11 == v10)
+        return v11;
+
+    const int v21 = a[pW + 2], v12 = a[2 * pW + 1];
+    if (v01 == v21 && v10 == v12)
+        return getChunkSeed(ss, x, z) & (1ULL << 24) ? v10 : v01;
+    if (v10 == v12)
+        return v10;
+    if (v01 == v21)
+        return v01;
+    return v11;
+}
+
+// mapShore() before 1.7, same arguments
+inline int mc15ShoreCell(const int *a, int pW)
+{
+    const int v11 = a[pW + 1], v10 = a[1], v21 = a[pW + 2], v01 = a[pW], v12 = a[2 * pW + 1];
+    const bool nextToOcean = v10 == ocean || v21 == ocean || v01 == ocean || v12 == ocean;
+
+    if (v11 == mushroom_fields)
+        return nextToOcean ? mushroom_field_shore : v11;
+    if (MC_VERSION <= MC_1_0)
+        return v11;
+    if (v11 == mountains)
+        return v10 != mountains || v21 != mountains || v01 != mountains || v12 != mountains ? mountain_edge : v11;
+    if (v11 != ocean && v11 != river && v11 != swamp && nextToOcean)
+        return beach;
+    return v11;
+}
+
+#if SEEDFINDER_X86
+
+// ---------------------------------------------------------------------------
+// AVX2
+
+// The 4 x 4 pixels of a whole Voronoi cell, one row of 4 per vector. The
+// squared distances stay below 2^34, so doubles compare them exactly.
+SEEDFINDER_TARGET("avx2")
+inline void mc15VoronoiCellAvx2(const int64_t d[8], const int v[4], int *buf, int w)
+{
+    const __m256d mi = _mm256_set_pd(30720, 20480, 10240, 0);
+    const __m256d xa = _mm256_sub_pd(mi, _mm256_set1_pd((double)d[0]));
+    const __m256d xb = _mm256_sub_pd(mi, _mm256_set1_pd((double)d[2]));
+    const __m256d xc = _mm256_sub_pd(mi, _mm256_set1_pd((double)d[4]));
+    const __m256d xd = _mm256_sub_pd(mi, _mm256_set1_pd((double)d[6]));
+    const __m256d sxa = _mm256_mul_pd(xa, xa), sxb = _mm256_mul_pd(xb, xb);
+    const __m256d sxc = _mm256_mul_pd(xc, xc), sxd = _mm256_mul_pd(xd, xd);
+    const __m256d v00 = _mm256_set1_pd(v[0]), v10 = _mm256_set1_pd(v[1]);
+    const __m256d v01 = _mm256_set1_pd(v[2]), v11 = _mm256_set1_pd(v[3]);
+
+    for (int jj = 0; jj < 4; ++jj)
+    {
+        const double mj = 10240.0 * jj;
+        const __m256d da = _mm256_add_pd(sxa, _mm256_set1_pd((mj - d[1]) * (mj - d[1])));
+        const __m256d db = _mm256_add_pd(sxb, _mm256_set1_pd((mj - d[3]) * (mj - d[3])));
+        const __m256d dc = _mm256_add_pd(sxc, _mm256_set1_pd((mj - d[5]) * (mj - d[5])));
+        const __m256d dd = _mm256_add_pd(sxd, _mm256_set1_pd((mj - d[7]) * (mj - d[7])));
+
+        const __m256d aMin = _mm256_and_pd(_mm256_cmp_pd(da, db, _CMP_LT_OQ),
+                                           _mm256_and_pd(_mm256_cmp_pd(da, dc, _CMP_LT_OQ), _mm256_cmp_pd(da, dd, _CMP_LT_OQ)));
+        const __m256d bMin = _mm256_and_pd(_mm256_cmp_pd(db, da, _CMP_LT_OQ),
+                                           _mm256_and_pd(_mm256_cmp_pd(db, dc, _CMP_LT_OQ), _mm256_cmp_pd(db, dd, _CMP_LT_OQ)));
+        const __m256d cMin = _mm256_and_pd(_mm256_cmp_pd(dc, da, _CMP_LT_OQ),
+                                           _mm256_and_pd(_mm256_cmp_pd(dc, db, _CMP_LT_OQ), _mm256_cmp_pd(dc, dd, _CMP_LT_OQ)));
+        __m256d r = _mm256_blendv_pd(v11, v01, cMin);
+        r = _mm256_blendv_pd(r, v10, bMin);
+        r = _mm256_blendv_pd(r, v00, aMin);
+        _mm_storeu_si128((__m128i *)(buf + jj * w), _mm256_cvtpd_epi32(r));
+    }
+}
+
+// One row of Voronoi cells, between the 1:4 rows pz and pz + 1 of which out
+// points at the first
+SEEDFINDER_TARGET("avx2")
+inline void mc15VoronoiRowAvx2(const int *out, int pX, int pW, int pz, int x, int j4, int w, int h, uint64_t ss, uint64_t st,
+                               Mc15VoronoiJitterRow top, Mc15VoronoiJitterRow bottom, int *buf)
+{
+    const int j0 = std::max(0, -j4), j1 = std::min(4, h - j4);
+    for (int pi = 0; pi < pW - 1; ++pi)
+    {
+        const int i4 = (pX + pi) * 4 - x;
+        const int v[4] = {out[pi], out[pi + 1], out[pi + pW], out[pi + 1 + pW]};
+        const int i0 = std::max(0, -i4), i1 = std::min(4, w - i4);
+        const bool whole = i0 == 0 && i1 == 4 && j0 == 0 && j1 == 4;
+
+        if (v[0] == v[1] && v[0] == v[2] && v[0] == v[3])
+        {
+            if (!whole)
+            {
+                mc15VoronoiFill(v[0], i4, j4, i0, i1, j0, j1, buf, w);
+                continue;
+            }
+            const __m128i fill = _mm_set1_epi32(v[0]);
+            for (int jj = 0; jj < 4; ++jj)
+                _mm_storeu_si128((__m128i *)(buf + (j4 + jj) * w + i4), fill);
+            continue;
+        }
+
+        int64_t d[8];
+        mc15VoronoiCorners(top, bottom, ss, st, pX, pz, pi, d);
+        if (whole)
+            mc15VoronoiCellAvx2(d, v, buf + j4 * w + i4, w);
+        else
+            mc15VoronoiPixels(d, v, i4, j4, i0, i1, j0, j1, buf, w);
+    }
+}
+
+SEEDFINDER_TARGET("avx2")
+inline __m256i mc15ZoomStepAvx2(__m256i cs)
+{
+    const __m256i mul = _mm256_set1_epi32((int)MC15_ZOOM_MUL), add = _mm256_set1_epi32((int)MC15_ZOOM_ADD);
+    return _mm256_mullo_epi32(cs, _mm256_add_epi32(_mm256_mullo_epi32(cs, mul), add));
+}
+
+// Lanes where bit 24 of cs is set
+SEEDFINDER_TARGET("avx2")
+inline __m256i mc15Bit24Avx2(__m256i cs)
+{
+    const __m256i bit = _mm256_set1_epi32(1 << 24);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(cs, bit), bit);
+}
+
+// Stores a[k], b[k] interleaved at out[2k], out[2k + 1]
+SEEDFINDER_TARGET("avx2")
+inline void mc15StoreInterleavedAvx2(int *out, __m256i a, __m256i b)
+{
+    const __m256i lo = _mm256_unpacklo_epi32(a, b), hi = _mm256_unpackhi_epi32(a, b);
+    _mm256_storeu_si256((__m256i *)out, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+// mc15ZoomRowScalar() for 8 cells at a time, returns the cells done
+template <bool Fuzzy>
+SEEDFINDER_TARGET("avx2")
+inline int mc15ZoomRowAvx2(const int *r0, const int *r1, int pW, int pX, int chunkZ, uint32_t ss, uint32_t st, int *o0, int *o1)
+{
+    const __m256i lane = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i vz = _mm256_set1_epi32(chunkZ), vst = _mm256_set1_epi32((int)st), vss = _mm256_set1_epi32((int)ss);
+
+    int i = 0;
+    for (; i + 8 <= pW; i += 8)
+    {
+        const __m256i v00 = _mm256_loadu_si256((const __m256i *)(r0 + i));
+        const __m256i v10 = _mm256_loadu_si256((const __m256i *)(r0 + i + 1));
+        const __m256i v01 = _mm256_loadu_si256((const __m256i *)(r1 + i));
+        const __m256i v11 = _mm256_loadu_si256((const __m256i *)(r1 + i + 1));
+
+        // Uniform cells need no special case, every choice below gives v00
+        const __m256i vx = _mm256_add_epi32(_mm256_set1_epi32((i + pX) * 2), lane);
+        __m256i cs = _mm256_add_epi32(vss, vx);
+        cs = _mm256_add_epi32(mc15ZoomStepAvx2(cs), vz);
+        cs = _mm256_add_epi32(mc15ZoomStepAvx2(cs), vx);
+        cs = _mm256_add_epi32(mc15ZoomStepAvx2(cs), vz);
+        const __m256i o01 = _mm256_blendv_epi8(v00, v01, mc15Bit24Avx2(cs));
+        cs = _mm256_add_epi32(mc15ZoomStepAvx2(cs), vst);
+        const __m256i o10 = _mm256_blendv_epi8(v00, v10, mc15Bit24Avx2(cs));
+
+        const __m256i r = _mm256_srli_epi32(_mm256_add_epi32(mc15ZoomStepAvx2(cs), vst), 24);
+        const __m256i three = _mm256_set1_epi32(3);
+        const __m256i pick = _mm256_and_si256(r, three);
+        __m256i o11 = _mm256_blendv_epi8(v11, v01, _mm256_cmpeq_epi32(pick, _mm256_set1_epi32(2)));
+        o11 = _mm256_blendv_epi8(o11, v10, _mm256_cmpeq_epi32(pick, _mm256_set1_epi32(1)));
+        o11 = _mm256_blendv_epi8(o11, v00, _mm256_cmpeq_epi32(pick, _mm256_setzero_si256()));
+
+        if (!Fuzzy)
+        {
+            // Equal neighbour counts, masks are -1 per match
+            const __m256i e0010 = _mm256_cmpeq_epi32(v00, v10), e0001 = _mm256_cmpeq_epi32(v00, v01);
+            const __m256i e0011 = _mm256_cmpeq_epi32(v00, v11), e1001 = _mm256_cmpeq_epi32(v10, v01);
+            const __m256i e1011 = _mm256_cmpeq_epi32(v10, v11), e0111 = _mm256_cmpeq_epi32(v01, v11);
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i cv00 = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_sub_epi32(zero, e0010), e0001), e0011);
+            const __m256i cv10 = _mm256_sub_epi32(_mm256_sub_epi32(zero, e1001), e1011);
+            const __m256i cv01 = _mm256_sub_epi32(zero, e0111);
+            o11 = _mm256_blendv_epi8(o11, v01, _mm256_cmpgt_epi32(cv01, cv00));
+            o11 = _mm256_blendv_epi8(o11, v10, _mm256_cmpgt_epi32(cv10, cv00));
+            o11 = _mm256_blendv_epi8(o11, v00, _mm256_and_si256(_mm256_cmpgt_epi32(cv00, cv10), _mm256_cmpgt_epi32(cv00, cv01)));
+        }
+
+        mc15StoreInterleavedAvx2(o0 + 2 * i, v00, o10);
+        mc15StoreInterleavedAvx2(o1 + 2 * i, o01, o11);
+    }
+    return i;
+}
+
+// mc15SmoothCell() for 8 cells of a row at a time, returns the cells done
+SEEDFINDER_TARGET("avx2")
+inline int mc15SmoothRowAvx2(int *out, int pW, int j, int w, int x, int z, uint64_t ss)
+{
+    int i = 0;
+    for (; i + 8 <= w; i += 8)
+    {
+        const int *a = out + i + j * pW;
+        const __m256i v11 = _mm256_loadu_si256((const __m256i *)(a + pW + 1));
+        const __m256i v01 = _mm256_loadu_si256((const __m256i *)(a + pW));
+        const __m256i v10 = _mm256_loadu_si256((const __m256i *)(a + 1));
+        const __m256i v21 = _mm256_loadu_si256((const __m256i *)(a + pW + 2));
+        const __m256i v12 = _mm256_loadu_si256((const __m256i *)(a + 2 * pW + 1));
+
+        const __m256i same = _mm256_and_si256(_mm256_cmpeq_epi32(v11, v01), _mm256_cmpeq_epi32(v11, v10));
+        const __m256i e0121 = _mm256_cmpeq_epi32(v01, v21), e1012 = _mm256_cmpeq_epi32(v10, v12);
+        __m256i r = _mm256_blendv_epi8(v11, v01, e0121);
+        r = _mm256_blendv_epi8(r, v10, e1012);
+        r = _mm256_blendv_epi8(r, v11, same);
+
+        alignas(32) int cells[8];
+        _mm256_store_si256((__m256i *)cells, r);
+        int random = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(same, _mm256_and_si256(e0121, e1012))));
+        for (int k = 0; random; ++k, random >>= 1)
+            if (random & 1)
+                cells[k] = getChunkSeed(ss, i + k + x, j + z) & (1ULL << 24) ? a[k + 1] : a[k + pW];
+        _mm256_storeu_si256((__m256i *)(out + i + j * w), _mm256_load_si256((const __m256i *)cells));
+    }
+    return i;
+}
+
+// mc15ShoreCell() for 8 cells of a row at a time, returns the cells done
+SEEDFINDER_TARGET("avx2")
+inline int mc15ShoreRowAvx2(int *out, int pW, int j, int w)
+{
+    const __m256i vOcean = _mm256_set1_epi32(ocean), vMountains = _mm256_set1_epi32(mountains);
+    const __m256i vMushroom = _mm256_set1_epi32(mushroom_fields);
+    const __m256i vRiver = _mm256_set1_epi32(river), vSwamp = _mm256_set1_epi32(swamp);
+
+    int i = 0;
+    for (; i + 8 <= w; i += 8)
+    {
+        const int *a = out + i + j * pW;
+        const __m256i v11 = _mm256_loadu_si256((const __m256i *)(a + pW + 1));
+        const __m256i v10 = _mm256_loadu_si256((const __m256i *)(a + 1));
+        const __m256i v21 = _mm256_loadu_si256((const __m256i *)(a + pW + 2));
+        const __m256i v01 = _mm256_loadu_si256((const __m256i *)(a + pW));
+        const __m256i v12 = _mm256_loadu_si256((const __m256i *)(a + 2 * pW + 1));
+
+        const __m256i nextToOcean = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(v10, vOcean), _mm256_cmpeq_epi32(v21, vOcean)),
+                                                    _mm256_or_si256(_mm256_cmpeq_epi32(v01, vOcean), _mm256_cmpeq_epi32(v12, vOcean)));
+        const __m256i allMountains = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi32(v10, vMountains), _mm256_cmpeq_epi32(v21, vMountains)),
+                                                      _mm256_and_si256(_mm256_cmpeq_epi32(v01, vMountains), _mm256_cmpeq_epi32(v12, vMountains)));
+        const __m256i noBeach = _mm256_or_si256(_mm256_cmpeq_epi32(v11, vOcean),
+                                                _mm256_or_si256(_mm256_cmpeq_epi32(v11, vRiver), _mm256_cmpeq_epi32(v11, vSwamp)));
+        const __m256i isMountains = _mm256_cmpeq_epi32(v11, vMountains);
+        const __m256i isMushroom = _mm256_cmpeq_epi32(v11, vMushroom);
+
+        __m256i r = _mm256_blendv_epi8(v11, _mm256_set1_epi32(beach), _mm256_andnot_si256(noBeach, nextToOcean));
+        r = _mm256_blendv_epi8(r, v11, isMountains);
+        r = _mm256_blendv_epi8(r, _mm256_set1_epi32(mountain_edge), _mm256_andnot_si256(allMountains, isMountains));
+        r = _mm256_blendv_epi8(r, v11, isMushroom);
+        r = _mm256_blendv_epi8(r, _mm256_set1_epi32(mushroom_field_shore), _mm256_and_si256(isMushroom, nextToOcean));
+        _mm256_storeu_si256((__m256i *)(out + i + j * w), r);
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// SSE4.1
+
+// mc15VoronoiCellAvx2() with two vectors of 2 pixels per row
+SEEDFINDER_TARGET("sse4.1")
+inline void mc15VoronoiCellSse41(const int64_t d[8], const int v[4], int *buf, int w)
+{
+    const __m128d mi[2] = {_mm_set_pd(10240, 0), _mm_set_pd(30720, 20480)};
+    const __m128d v00 = _mm_set1_pd(v[0]), v10 = _mm_set1_pd(v[1]);
+    const __m128d v01 = _mm_set1_pd(v[2]), v11 = _mm_set1_pd(v[3]);
+    __m128d sxa[2], sxb[2], sxc[2], sxd[2];
+    for (int k = 0; k < 2; ++k)
+    {
+        const __m128d xa = _mm_sub_pd(mi[k], _mm_set1_pd((double)d[0])), xb = _mm_sub_pd(mi[k], _mm_set1_pd((double)d[2]));
+        const __m128d xc = _mm_sub_pd(mi[k], _mm_set1_pd((double)d[4])), xd = _mm_sub_pd(mi[k], _mm_set1_pd((double)d[6]));
+        sxa[k] = _mm_mul_pd(xa, xa);
+        sxb[k] = _mm_mul_pd(xb, xb);
+        sxc[k] = _mm_mul_pd(xc, xc);
+        sxd[k] = _mm_mul_pd(xd, xd);
+    }
+
+    for (int jj = 0; jj < 4; ++jj)
+    {
+        const double mj = 10240.0 * jj;
+        const __m128d sja = _mm_set1_pd((mj - d[1]) * (mj - d[1])), sjb = _mm_set1_pd((mj - d[3]) * (mj - d[3]));
+        const __m128d sjc = _mm_set1_pd((mj - d[5]) * (mj - d[5])), sjd = _mm_set1_pd((mj - d[7]) * (mj - d[7]));
+        __m128i half[2];
+        for (int k = 0; k < 2; ++k)
+        {
+            const __m128d da = _mm_add_pd(sxa[k], sja), db = _mm_add_pd(sxb[k], sjb);
+            const __m128d dc = _mm_add_pd(sxc[k], sjc), dd = _mm_add_pd(sxd[k], sjd);
+            const __m128d aMin = _mm_and_pd(_mm_cmplt_pd(da, db), _mm_and_pd(_mm_cmplt_pd(da, dc), _mm_cmplt_pd(da, dd)));
+            const __m128d bMin = _mm_and_pd(_mm_cmplt_pd(db, da), _mm_and_pd(_mm_cmplt_pd(db, dc), _mm_cmplt_pd(db, dd)));
+            const __m128d cMin = _mm_and_pd(_mm_cmplt_pd(dc, da), _mm_and_pd(_mm_cmplt_pd(dc, db), _mm_cmplt_pd(dc, dd)));
+            __m128d r = _mm_blendv_pd(v11, v01, cMin);
+            r = _mm_blendv_pd(r, v10, bMin);
+            r = _mm_blendv_pd(r, v00, aMin);
+            half[k] = _mm_cvtpd_epi32(r);
+        }
+        _mm_storeu_si128((__m128i *)(buf + jj * w), _mm_unpacklo_epi64(half[0], half[1]));
+    }
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline void mc15VoronoiRowSse41(const int *out, int pX, int pW, int pz, int x, int j4, int w, int h, uint64_t ss, uint64_t st,
+                               Mc15VoronoiJitterRow top, Mc15VoronoiJitterRow bottom, int *buf)
+{
+    const int j0 = std::max(0, -j4), j1 = std::min(4, h - j4);
+    for (int pi = 0; pi < pW - 1; ++pi)
+    {
+        const int i4 = (pX + pi) * 4 - x;
+        const int v[4] = {out[pi], out[pi + 1], out[pi + pW], out[pi + 1 + pW]};
+        const int i0 = std::max(0, -i4), i1 = std::min(4, w - i4);
+        const bool whole = i0 == 0 && i1 == 4 && j0 == 0 && j1 == 4;
+
+        if (v[0] == v[1] && v[0] == v[2] && v[0] == v[3])
+        {
+            if (!whole)
+            {
+                mc15VoronoiFill(v[0], i4, j4, i0, i1, j0, j1, buf, w);
+                continue;
+            }
+            const __m128i fill = _mm_set1_epi32(v[0]);
+            for (int jj = 0; jj < 4; ++jj)
+                _mm_storeu_si128((__m128i *)(buf + (j4 + jj) * w + i4), fill);
+            continue;
+        }
+
+        int64_t d[8];
+        mc15VoronoiCorners(top, bottom, ss, st, pX, pz, pi, d);
+        if (whole)
+            mc15VoronoiCellSse41(d, v, buf + j4 * w + i4, w);
+        else
+            mc15VoronoiPixels(d, v, i4, j4, i0, i1, j0, j1, buf, w);
+    }
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline __m128i mc15ZoomStepSse41(__m128i cs)
+{
+    const __m128i mul = _mm_set1_epi32((int)MC15_ZOOM_MUL), add = _mm_set1_epi32((int)MC15_ZOOM_ADD);
+    return _mm_mullo_epi32(cs, _mm_add_epi32(_mm_mullo_epi32(cs, mul), add));
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline __m128i mc15Bit24Sse41(__m128i cs)
+{
+    const __m128i bit = _mm_set1_epi32(1 << 24);
+    return _mm_cmpeq_epi32(_mm_and_si128(cs, bit), bit);
+}
+
+template <bool Fuzzy>
+SEEDFINDER_TARGET("sse4.1")
+inline int mc15ZoomRowSse41(const int *r0, const int *r1, int pW, int pX, int chunkZ, uint32_t ss, uint32_t st, int *o0, int *o1)
+{
+    const __m128i lane = _mm_setr_epi32(0, 2, 4, 6);
+    const __m128i vz = _mm_set1_epi32(chunkZ), vst = _mm_set1_epi32((int)st), vss = _mm_set1_epi32((int)ss);
+
+    int i = 0;
+    for (; i + 4 <= pW; i += 4)
+    {
+        const __m128i v00 = _mm_loadu_si128((const __m128i *)(r0 + i));
+        const __m128i v10 = _mm_loadu_si128((const __m128i *)(r0 + i + 1));
+        const __m128i v01 = _mm_loadu_si128((const __m128i *)(r1 + i));
+        const __m128i v11 = _mm_loadu_si128((const __m128i *)(r1 + i + 1));
+
+        const __m128i vx = _mm_add_epi32(_mm_set1_epi32((i + pX) * 2), lane);
+        __m128i cs = _mm_add_epi32(vss, vx);
+        cs = _mm_add_epi32(mc15ZoomStepSse41(cs), vz);
+        cs = _mm_add_epi32(mc15ZoomStepSse41(cs), vx);
+        cs = _mm_add_epi32(mc15ZoomStepSse41(cs), vz);
+        const __m128i o01 = _mm_blendv_epi8(v00, v01, mc15Bit24Sse41(cs));
+        cs = _mm_add_epi32(mc15ZoomStepSse41(cs), vst);
+        const __m128i o10 = _mm_blendv_epi8(v00, v10, mc15Bit24Sse41(cs));
+
+        const __m128i pick = _mm_and_si128(_mm_srli_epi32(_mm_add_epi32(mc15ZoomStepSse41(cs), vst), 24), _mm_set1_epi32(3));
+        __m128i o11 = _mm_blendv_epi8(v11, v01, _mm_cmpeq_epi32(pick, _mm_set1_epi32(2)));
+        o11 = _mm_blendv_epi8(o11, v10, _mm_cmpeq_epi32(pick, _mm_set1_epi32(1)));
+        o11 = _mm_blendv_epi8(o11, v00, _mm_cmpeq_epi32(pick, _mm_setzero_si128()));
+
+        if (!Fuzzy)
+        {
+            const __m128i e0010 = _mm_cmpeq_epi32(v00, v10), e0001 = _mm_cmpeq_epi32(v00, v01);
+            const __m128i e0011 = _mm_cmpeq_epi32(v00, v11), e1001 = _mm_cmpeq_epi32(v10, v01);
+            const __m128i e1011 = _mm_cmpeq_epi32(v10, v11), e0111 = _mm_cmpeq_epi32(v01, v11);
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i cv00 = _mm_sub_epi32(_mm_sub_epi32(_mm_sub_epi32(zero, e0010), e0001), e0011);
+            const __m128i cv10 = _mm_sub_epi32(_mm_sub_epi32(zero, e1001), e1011);
+            const __m128i cv01 = _mm_sub_epi32(zero, e0111);
+            o11 = _mm_blendv_epi8(o11, v01, _mm_cmpgt_epi32(cv01, cv00));
+            o11 = _mm_blendv_epi8(o11, v10, _mm_cmpgt_epi32(cv10, cv00));
+            o11 = _mm_blendv_epi8(o11, v00, _mm_and_si128(_mm_cmpgt_epi32(cv00, cv10), _mm_cmpgt_epi32(cv00, cv01)));
+        }
+
+        _mm_storeu_si128((__m128i *)(o0 + 2 * i), _mm_unpacklo_epi32(v00, o10));
+        _mm_storeu_si128((__m128i *)(o0 + 2 * i + 4), _mm_unpackhi_epi32(v00, o10));
+        _mm_storeu_si128((__m128i *)(o1 + 2 * i), _mm_unpacklo_epi32(o01, o11));
+        _mm_storeu_si128((__m128i *)(o1 + 2 * i + 4), _mm_unpackhi_epi32(o01, o11));
+    }
+    return i;
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline int mc15SmoothRowSse41(int *out, int pW, int j, int w, int x, int z, uint64_t ss)
+{
+    int i = 0;
+    for (; i + 4 <= w; i += 4)
+    {
+        const int *a = out + i + j * pW;
+        const __m128i v11 = _mm_loadu_si128((const __m128i *)(a + pW + 1));
+        const __m128i v01 = _mm_loadu_si128((const __m128i *)(a + pW));
+        const __m128i v10 = _mm_loadu_si128((const __m128i *)(a + 1));
+        const __m128i v21 = _mm_loadu_si128((const __m128i *)(a + pW + 2));
+        const __m128i v12 = _mm_loadu_si128((const __m128i *)(a + 2 * pW + 1));
+
+        const __m128i same = _mm_and_si128(_mm_cmpeq_epi32(v11, v01), _mm_cmpeq_epi32(v11, v10));
+        const __m128i e0121 = _mm_cmpeq_epi32(v01, v21), e1012 = _mm_cmpeq_epi32(v10, v12);
+        __m128i r = _mm_blendv_epi8(v11, v01, e0121);
+        r = _mm_blendv_epi8(r, v10, e1012);
+        r = _mm_blendv_epi8(r, v11, same);
+
+        alignas(16) int cells[4];
+        _mm_store_si128((__m128i *)cells, r);
+        int random = _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(same, _mm_and_si128(e0121, e1012))));
+        for (int k = 0; random; ++k, random >>= 1)
+            if (random & 1)
+                cells[k] = getChunkSeed(ss, i + k + x, j + z) & (1ULL << 24) ? a[k + 1] : a[k + pW];
+        _mm_storeu_si128((__m128i *)(out + i + j * w), _mm_load_si128((const __m128i *)cells));
+    }
+    return i;
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline int mc15ShoreRowSse41(int *out, int pW, int j, int w)
+{
+    const __m128i vOcean = _mm_set1_epi32(ocean), vMountains = _mm_set1_epi32(mountains);
+    const __m128i vMushroom = _mm_set1_epi32(mushroom_fields);
+    const __m128i vRiver = _mm_set1_epi32(river), vSwamp = _mm_set1_epi32(swamp);
+
+    int i = 0;
+    for (; i + 4 <= w; i += 4)
+    {
+        const int *a = out + i + j * pW;
+        const __m128i v11 = _mm_loadu_si128((const __m128i *)(a + pW + 1));
+        const __m128i v10 = _mm_loadu_si128((const __m128i *)(a + 1));
+        const __m128i v21 = _mm_loadu_si128((const __m128i *)(a + pW + 2));
+        const __m128i v01 = _mm_loadu_si128((const __m128i *)(a + pW));
+        const __m128i v12 = _mm_loadu_si128((const __m128i *)(a + 2 * pW + 1));
+
+        const __m128i nextToOcean = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(v10, vOcean), _mm_cmpeq_epi32(v21, vOcean)),
+                                                 _mm_or_si128(_mm_cmpeq_epi32(v01, vOcean), _mm_cmpeq_epi32(v12, vOcean)));
+        const __m128i allMountains = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi32(v10, vMountains), _mm_cmpeq_epi32(v21, vMountains)),
+                                                   _mm_and_si128(_mm_cmpeq_epi32(v01, vMountains), _mm_cmpeq_epi32(v12, vMountains)));
+        const __m128i noBeach = _mm_or_si128(_mm_cmpeq_epi32(v11, vOcean),
+                                             _mm_or_si128(_mm_cmpeq_epi32(v11, vRiver), _mm_cmpeq_epi32(v11, vSwamp)));
+        const __m128i isMountains = _mm_cmpeq_epi32(v11, vMountains);
+        const __m128i isMushroom = _mm_cmpeq_epi32(v11, vMushroom);
+
+        __m128i r = _mm_blendv_epi8(v11, _mm_set1_epi32(beach), _mm_andnot_si128(noBeach, nextToOcean));
+        r = _mm_blendv_epi8(r, v11, isMountains);
+        r = _mm_blendv_epi8(r, _mm_set1_epi32(mountain_edge), _mm_andnot_si128(allMountains, isMountains));
+        r = _mm_blendv_epi8(r, v11, isMushroom);
+        r = _mm_blendv_epi8(r, _mm_set1_epi32(mushroom_field_shore), _mm_and_si128(isMushroom, nextToOcean));
+        _mm_storeu_si128((__m128i *)(out + i + j * w), r);
+    }
+    return i;
+}
+
+#endif // SEEDFINDER_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+// mc15VoronoiCellsScalar() on the given path. scratch holds
+// mc15VoronoiScratch(pW) ints and must not overlap out or buf.
+inline void mc15VoronoiCells(const int *out, int pX, int pZ, int pW, int pH, int x, int z, int w, int h,
+                             uint64_t ss, uint64_t st, int *buf, int *scratch, Mc15Isa isa = mc15Isa())
+{
+#if SEEDFINDER_X86
+    if (isa != MC15_SCALAR)
+    {
+        // The lower row of points of a row of cells is the upper one of the next
+        Mc15VoronoiJitterRow rows[2];
+        for (int k = 0; k < 2; ++k)
+        {
+            rows[k] = {scratch + 3 * k * pW, scratch + (3 * k + 1) * pW, scratch + (3 * k + 2) * pW};
+            std::fill(rows[k].tag, rows[k].tag + pW, INT_MIN);
+        }
+
+        for (int pj = 0; pj < pH - 1; ++pj)
+        {
+            const int pz = pZ + pj, j4 = pz * 4 - z;
+            if (isa == MC15_AVX2)
+                mc15VoronoiRowAvx2(out + pj * pW, pX, pW, pz, x, j4, w, h, ss, st, rows[pj & 1], rows[(pj + 1) & 1], buf);
+            else
+                mc15VoronoiRowSse41(out + pj * pW, pX, pW, pz, x, j4, w, h, ss, st, rows[pj & 1], rows[(pj + 1) & 1], buf);
+        }
+        return;
+    }
+#endif
+    (void)scratch;
+    mc15VoronoiCellsScalar(out, pX, pZ, pW, pH, x, z, w, h, ss, st, buf);
+}
+
+// Zoomed cells of mapZoom() (or mapZoomFuzzy()) of the parent area (pX, pZ,
+// pW, pH) in out into buf, 2 * pW cells wide. The last row and column read
+// past the parent area, into buf as it is written; the layer never uses them,
+// and they differ between the paths.
+template <bool Fuzzy>
+inline void mc15ZoomCells(const int *out, int pX, int pZ, int pW, int pH, uint32_t ss, uint32_t st, int *buf, Mc15Isa isa = mc15Isa())
+{
+    const int newW = 2 * pW;
+    isa = mc15RowIsa(isa, pW);
+    for (int j = 0; j < pH; ++j)
+    {
+        const int *r0 = out + j * pW, *r1 = out + (j + 1) * pW;
+        int *o0 = buf + 2 * j * newW, *o1 = o0 + newW;
+        const int chunkZ = (j + pZ) * 2;
+        int i = 0;
+#if SEEDFINDER_X86
+        if (isa == MC15_AVX2)
+            i = mc15ZoomRowAvx2<Fuzzy>(r0, r1, pW, pX, chunkZ, ss, st, o0, o1);
+        else if (isa == MC15_SSE41)
+            i = mc15ZoomRowSse41<Fuzzy>(r0, r1, pW, pX, chunkZ, ss, st, o0, o1);
+#endif
+        mc15ZoomRowScalar<Fuzzy>(r0, r1, i, pW, pX, chunkZ, ss, st, o0, o1);
+    }
+}
+
+// mapSmooth() in place: the parent area (x - 1, z - 1, w + 2, h + 2) in out
+// becomes the w x h cells at (x, z). Cell (i, j) only reads parent rows
+// j .. j+2, which are not written yet.
+inline void mc15SmoothCells(int *out, int x, int z, int w, int h, uint64_t ss, Mc15Isa isa = mc15Isa())
+{
+    const int pW = w + 2;
+    isa = mc15RowIsa(isa, w);
+    for (int j = 0; j < h; ++j)
+    {
+        int i = 0;
+#if SEEDFINDER_X86
+        if (isa == MC15_AVX2)
+            i = mc15SmoothRowAvx2(out, pW, j, w, x, z, ss);
+        else if (isa == MC15_SSE41)
+            i = mc15SmoothRowSse41(out, pW, j, w, x, z, ss);
+#endif
+        for (; i < w; ++i)
+            out[i + j * w] = mc15SmoothCell(out + i + j * pW, pW, ss, i + x, j + z);
+    }
+}
+
+// mapShore() before 1.7 in place, as mc15SmoothCells()
+inline void mc15ShoreCells(int *out, int w, int h, Mc15Isa isa = mc15Isa())
+{
+    const int pW = w + 2;
+    isa = MC_VERSION <= MC_1_0 ? MC15_SCALAR : mc15RowIsa(isa, w);
+    for (int j = 0; j < h; ++j)
+    {
+        int i = 0;
+#if SEEDFINDER_X86
+        if (isa == MC15_AVX2)
+            i = mc15ShoreRowAvx2(out, pW, j, w);
+        else if (isa == MC15_SSE41)
+            i = mc15ShoreRowSse41(out, pW, j, w);
+#endif
+        for (; i < w; ++i)
+            out[i + j * w] = mc15ShoreCell(out + i + j * pW, pW);
+    }
+}
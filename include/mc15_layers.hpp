@@ -0,0 +1,630 @@
+#pragma once
+
+#include <config.hpp>
+#include <mc15_kernels.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+extern "C"
+{
+#include "generator.h"
+}
+
+// The 1.3 - 1.6 overworld layer chain of setupLayerStack() as C++ types.
+//
+// Every layer is a type that knows its salt, its parent type and its kernel,
+// so a query of one layer is a chain of direct calls the compiler can inline
+// instead of getMap pointers through generic Layer structs. The kernels are
+// the cubiomes ones with the version checks resolved for MC_VERSION, and the
+// output is bit-identical to genArea()/genBiomes() on the same seed. Compared
+// to the layer stack they skip the memset of genArea() (every kernel writes
+// its whole output) and the hills noise branch, which mapHills() generates
+// but never reads before 1.7. Large biomes are not supported.
+//
+// Seeds live in Mc15Seeds, indexed by the cubiomes layer ids, so one set of
+// types serves any number of generators.
+
+// setupLayer() salt of a layer at compile time, 0 stays 0
+inline constexpr uint64_t mc15LayerSalt(uint64_t base)
+{
+    uint64_t ls = base;
+    for (int i = 0; i < 3; ++i)
+        ls = ls * (ls * 6364136223846793005ULL + 1442695040888963407ULL) + base;
+    return ls;
+}
+
+// Largest parent side of a zoom layer over all alignments of a side of n cells
+inline constexpr int mc15ZoomParent(int n)
+{
+    return ((n + 1) >> 1) + 1;
+}
+
+// Same for the 1:4 parent of mapVoronoi114(), which shifts the area by 2
+inline constexpr int mc15VoronoiParent(int n)
+{
+    return ((n + 3) >> 2) + 2;
+}
+
+// Start salts and seeds of the layers for one world seed, as setLayerSeed()
+struct Mc15Seeds
+{
+    uint64_t startSalt[L_NUM] = {};
+    uint64_t startSeed[L_NUM] = {};
+};
+
+template <int Id, uint64_t SaltBase>
+struct Mc15Layer
+{
+    static constexpr int ID = Id;
+    static constexpr uint64_t SALT = mc15LayerSalt(SaltBase);
+
+    static void seed(Mc15Seeds &s, uint64_t worldSeed)
+    {
+        uint64_t st = worldSeed;
+        st = mcStepSeed(st, SALT);
+        st = mcStepSeed(st, SALT);
+        st = mcStepSeed(st, SALT);
+        s.startSalt[ID] = st;
+        s.startSeed[ID] = mcStepSeed(st, 0);
+    }
+};
+
+// mapContinent()
+template <int Id, uint64_t SaltBase>
+struct Mc15Continent : Mc15Layer<Id, SaltBase>
+{
+    using Parent = void;
+
+    static constexpr void mapInterval(int &, int &) {}
+
+    static constexpr size_t cacheSize(int w, int h)
+    {
+        return (size_t)w * h;
+    }
+
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        const uint64_t ss = s.startSeed[Id];
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                out[j * w + i] = mcFirstIsZero(getChunkSeed(ss, i + x, j + z), 10);
+
+        if (x > -w && x <= 0 && z > -h && z <= 0)
+            out[-z * w - x] = 1;
+    }
+};
+
+// mapZoom() and mapZoomFuzzy()
+template <int Id, uint64_t SaltBase, typename P, bool Fuzzy = false>
+struct Mc15Zoom : Mc15Layer<Id, SaltBase>
+{
+    using Parent = P;
+
+    static constexpr void mapInterval(int &lo, int &hi)
+    {
+        lo >>= 1;
+        hi = (hi + 1) >> 1;
+    }
+
+    static constexpr size_t cacheSize(int w, int h)
+    {
+        const int pW = mc15ZoomParent(w), pH = mc15ZoomParent(h);
+        return std::max(P::cacheSize(pW, pH), (size_t)5 * pW * pH);
+    }
+
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        const int pX = x >> 1, pZ = z >> 1;
+        const int pW = ((x + w) >> 1) - pX + 1, pH = ((z + h) >> 1) - pZ + 1;
+        P::gen(s, out, pX, pZ, pW, pH);
+
+        const int newW = 2 * pW;
+        int *buf = out + pW * pH;
+        mc15ZoomCells<Fuzzy>(out, pX, pZ, pW, pH, (uint32_t)s.startSeed[Id], (uint32_t)s.startSalt[Id], buf);
+
+        for (int j = 0; j < h; ++j)
+            memmove(out + j * w, buf + (j + (z & 1)) * newW + (x & 1), w * sizeof(int));
+    }
+};
+
+// Base of the layers reading the 3x3 neighbourhood of each cell.
+// Kernel::cell(s, a, pW, x, z) returns the cell at (x, z), where a points at
+// its top left neighbour in the parent area of width pW
+template <int Id, uint64_t SaltBase, typename P, typename Kernel>
+struct Mc15Neighbours : Mc15Layer<Id, SaltBase>
+{
+    using Parent = P;
+
+    static constexpr void mapInterval(int &lo, int &hi)
+    {
+        --lo;
+        ++hi;
+    }
+
+    static constexpr size_t cacheSize(int w, int h)
+    {
+        return std::max(P::cacheSize(w + 2, h + 2), (size_t)(w + 2) * (h + 2));
+    }
+
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        P::gen(s, out, x - 1, z - 1, w + 2, h + 2);
+
+        // Cell (i, j) only reads parent rows j .. j+2, which are not written yet
+        const int pW = w + 2;
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                out[i + j * w] = Kernel::cell(s, out + i + j * pW, pW, i + x, j + z);
+    }
+};
+
+// Base of the layers that change cells one by one
+template <int Id, uint64_t SaltBase, typename P, typename Kernel>
+struct Mc15SameArea : Mc15Layer<Id, SaltBase>
+{
+    using Parent = P;
+
+    static constexpr void mapInterval(int &, int &) {}
+
+    static constexpr size_t cacheSize(int w, int h)
+    {
+        return std::max(P::cacheSize(w, h), (size_t)w * h);
+    }
+
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        P::gen(s, out, x, z, w, h);
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                out[i + j * w] = Kernel::cell(s, out[i + j * w], i + x, j + z);
+    }
+};
+
+// mapLand16()
+template <int Id>
+struct Mc15LandKernel
+{
+    static int cell(const Mc15Seeds &s, const int *a, int pW, int x, int z)
+    {
+        const int v00 = a[0], v20 = a[2], v11 = a[pW + 1], v02 = a[2 * pW], v22 = a[2 * pW + 2];
+        int v = v11;
+
+        if (v11 != 0 || (v00 == 0 && v20 == 0 && v02 == 0 && v22 == 0))
+        {
+            if (v11 != 0 && (v00 == 0 || v20 == 0 || v02 == 0 || v22 == 0))
+            {
+                if (mcFirstIsZero(getChunkSeed(s.startSeed[Id], x, z), 5))
+                    v = v == snowy_tundra ? frozen_ocean : ocean;
+            }
+            return v;
+        }
+
+        const uint64_t st = s.startSalt[Id];
+        uint64_t cs = getChunkSeed(s.startSeed[Id], x, z);
+        int inc = 0;
+        v = 1;
+        if (v00 != ocean)
+        {
+            ++inc;
+            v = v00;
+            cs = mcStepSeed(cs, st);
+        }
+        if (v20 != ocean)
+        {
+            if (++inc == 1 || mcFirstIsZero(cs, 2))
+                v = v20;
+            cs = mcStepSeed(cs, st);
+        }
+        if (v02 != ocean)
+        {
+            switch (++inc)
+            {
+            case 1:
+                v = v02;
+                break;
+            case 2:
+                if (mcFirstIsZero(cs, 2))
+                    v = v02;
+                break;
+            default:
+                if (mcFirstIsZero(cs, 3))
+                    v = v02;
+            }
+            cs = mcStepSeed(cs, st);
+        }
+        if (v22 != ocean)
+        {
+            switch (++inc)
+            {
+            case 1:
+                v = v22;
+                break;
+            case 2:
+                if (mcFirstIsZero(cs, 2))
+                    v = v22;
+                break;
+            case 3:
+                if (mcFirstIsZero(cs, 3))
+                    v = v22;
+                break;
+            default:
+                if (mcFirstIsZero(cs, 4))
+                    v = v22;
+            }
+            cs = mcStepSeed(cs, st);
+        }
+
+        if (!mcFirstIsZero(cs, 3))
+            v = v == snowy_tundra ? frozen_ocean : ocean;
+        return v;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Land : Mc15Neighbours<Id, SaltBase, P, Mc15LandKernel<Id>>
+{
+};
+
+// mapSnow16()
+template <int Id>
+struct Mc15SnowKernel
+{
+    static int cell(const Mc15Seeds &s, const int *a, int pW, int x, int z)
+    {
+        const int v11 = a[pW + 1];
+        if (v11 == ocean)
+            return v11;
+        return mcFirstIsZero(getChunkSeed(s.startSeed[Id], x, z), 5) ? snowy_tundra : plains;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Snow : Mc15Neighbours<Id, SaltBase, P, Mc15SnowKernel<Id>>
+{
+};
+
+// mapMushroom()
+template <int Id>
+struct Mc15MushroomKernel
+{
+    static int cell(const Mc15Seeds &s, const int *a, int pW, int x, int z)
+    {
+        const int v11 = a[pW + 1];
+        if (v11 == 0 && !a[0] && !a[2] && !a[2 * pW] && !a[2 * pW + 2] &&
+            mcFirstIsZero(getChunkSeed(s.startSeed[Id], x, z), 100))
+            return mushroom_fields;
+        return v11;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Mushroom : Mc15Neighbours<Id, SaltBase, P, Mc15MushroomKernel<Id>>
+{
+};
+
+// mapBiome() before 1.7
+template <int Id>
+struct Mc15BiomeKernel
+{
+    static int cell(const Mc15Seeds &s, int id, int x, int z)
+    {
+        static constexpr int OLD_BIOMES[] = {desert, forest, mountains, swamp, plains, taiga, jungle};
+        static constexpr int OLD_BIOMES_11[] = {desert, forest, mountains, swamp, plains, taiga};
+
+        id &= ~0xf00;
+        if (id == ocean || id == mushroom_fields)
+            return id;
+
+        const uint64_t cs = getChunkSeed(s.startSeed[Id], x, z);
+        int v = MC_VERSION <= MC_1_1 ? OLD_BIOMES_11[mcFirstInt(cs, 6)] : OLD_BIOMES[mcFirstInt(cs, 7)];
+        if (id != plains && (v != taiga || MC_VERSION <= MC_1_2))
+            v = snowy_tundra;
+        return v;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Biome : Mc15SameArea<Id, SaltBase, P, Mc15BiomeKernel<Id>>
+{
+};
+
+// mapNoise() before 1.7
+template <int Id>
+struct Mc15NoiseKernel
+{
+    static int cell(const Mc15Seeds &s, int v, int x, int z)
+    {
+        return v > 0 ? mcFirstInt(getChunkSeed(s.startSeed[Id], x, z), 2) + 2 : 0;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Noise : Mc15SameArea<Id, SaltBase, P, Mc15NoiseKernel<Id>>
+{
+};
+
+// mapHills() before 1.7, where the river branch is never read
+template <int Id>
+struct Mc15HillsKernel
+{
+    static int cell(const Mc15Seeds &s, const int *a, int pW, int x, int z)
+    {
+        const int a11 = a[pW + 1];
+        uint64_t cs = getChunkSeed(s.startSeed[Id], x, z);
+        if (!mcFirstIsZero(cs, 3))
+            return a11;
+
+        const uint64_t st = s.startSalt[Id];
+        int hillID = a11;
+        switch (a11)
+        {
+        case desert:
+            hillID = desert_hills;
+            break;
+        case forest:
+            hillID = wooded_hills;
+            break;
+        case birch_forest:
+            hillID = birch_forest_hills;
+            break;
+        case dark_forest:
+            hillID = plains;
+            break;
+        case taiga:
+            hillID = taiga_hills;
+            break;
+        case giant_tree_taiga:
+            hillID = giant_tree_taiga_hills;
+            break;
+        case snowy_taiga:
+            hillID = snowy_taiga_hills;
+            break;
+        case plains:
+            hillID = forest;
+            break;
+        case snowy_tundra:
+            hillID = snowy_mountains;
+            break;
+        case jungle:
+            hillID = jungle_hills;
+            break;
+        case bamboo_jungle:
+            hillID = bamboo_jungle_hills;
+            break;
+        case ocean:
+        case mountains:
+            break;
+        case savanna:
+            hillID = savanna_plateau;
+            break;
+        default:
+            if (areSimilar(MC_VERSION, a11, wooded_badlands_plateau))
+                hillID = badlands;
+            else if (isDeepOcean(a11))
+            {
+                cs = mcStepSeed(cs, st);
+                if (mcFirstIsZero(cs, 3))
+                {
+                    cs = mcStepSeed(cs, st);
+                    hillID = mcFirstIsZero(cs, 2) ? plains : forest;
+                }
+            }
+            break;
+        }
+
+        if (hillID == a11)
+            return a11;
+
+        // All four direct neighbours must be similar before 1.7
+        const int equals = areSimilar(MC_VERSION, a[1], a11) + areSimilar(MC_VERSION, a[pW + 2], a11) +
+                           areSimilar(MC_VERSION, a[pW], a11) + areSimilar(MC_VERSION, a[2 * pW + 1], a11);
+        return equals >= 4 ? hillID : a11;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Hills : Mc15Neighbours<Id, SaltBase, P, Mc15HillsKernel<Id>>
+{
+};
+
+// mapShore() before 1.7
+struct Mc15ShoreKernel
+{
+    static int cell(const Mc15Seeds &, const int *a, int pW, int, int)
+    {
+        return mc15ShoreCell(a, pW);
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Shore : Mc15Neighbours<Id, SaltBase, P, Mc15ShoreKernel>
+{
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        P::gen(s, out, x - 1, z - 1, w + 2, h + 2);
+        mc15ShoreCells(out, w, h);
+    }
+};
+
+// mapSwampRiver()
+template <int Id>
+struct Mc15SwampRiverKernel
+{
+    static int cell(const Mc15Seeds &s, int v, int x, int z)
+    {
+        if (v != swamp && v != jungle && v != jungle_hills)
+            return v;
+        return mcFirstIsZero(getChunkSeed(s.startSeed[Id], x, z), v == swamp ? 6 : 8) ? river : v;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15SwampRiver : Mc15SameArea<Id, SaltBase, P, Mc15SwampRiverKernel<Id>>
+{
+};
+
+// mapSmooth()
+template <int Id>
+struct Mc15SmoothKernel
+{
+    static int cell(const Mc15Seeds &s, const int *a, int pW, int x, int z)
+    {
+        return mc15SmoothCell(a, pW, s.startSeed[Id], x, z);
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Smooth : Mc15Neighbours<Id, SaltBase, P, Mc15SmoothKernel<Id>>
+{
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        P::gen(s, out, x - 1, z - 1, w + 2, h + 2);
+        mc15SmoothCells(out, x, z, w, h, s.startSeed[Id]);
+    }
+};
+
+// mapRiver() before 1.7
+struct Mc15RiverKernel
+{
+    static int cell(const Mc15Seeds &, const int *a, int pW, int, int)
+    {
+        const int v11 = a[pW + 1];
+        if (v11 == 0)
+            return river;
+        return v11 == a[pW] && v11 == a[1] && v11 == a[2 * pW + 1] && v11 == a[pW + 2] ? -1 : river;
+    }
+};
+
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15River : Mc15Neighbours<Id, SaltBase, P, Mc15RiverKernel>
+{
+};
+
+// mapRiverMix() before 1.7, P is the biome branch and P2 the rivers
+template <int Id, uint64_t SaltBase, typename P, typename P2>
+struct Mc15RiverMix : Mc15Layer<Id, SaltBase>
+{
+    using Parent = P;
+
+    static constexpr void mapInterval(int &, int &) {}
+
+    static constexpr size_t cacheSize(int w, int h)
+    {
+        return std::max(P::cacheSize(w, h), (size_t)w * h + P2::cacheSize(w, h));
+    }
+
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        P::gen(s, out, x, z, w, h);
+        int *buf = out + w * h;
+        P2::gen(s, buf, x, z, w, h);
+
+        for (int idx = 0; idx < w * h; ++idx)
+        {
+            int v = out[idx];
+            if (buf[idx] == river && v != ocean)
+                v = v == snowy_tundra ? frozen_river : v == mushroom_fields || v == mushroom_field_shore ? mushroom_field_shore : river;
+            out[idx] = v;
+        }
+    }
+};
+
+// mapVoronoi114()
+template <int Id, uint64_t SaltBase, typename P>
+struct Mc15Voronoi : Mc15Layer<Id, SaltBase>
+{
+    using Parent = P;
+
+    static constexpr void mapInterval(int &lo, int &hi)
+    {
+        lo = (lo - 2) >> 2;
+        hi = ((hi - 2) >> 2) + 1;
+    }
+
+    static constexpr size_t cacheSize(int w, int h)
+    {
+        const int pW = mc15VoronoiParent(w), pH = mc15VoronoiParent(h);
+        return std::max(P::cacheSize(pW, pH), (size_t)pW * pH + (size_t)w * h + mc15VoronoiScratch(pW));
+    }
+
+    static void gen(const Mc15Seeds &s, int *out, int x, int z, int w, int h)
+    {
+        x -= 2;
+        z -= 2;
+        const int pX = x >> 2, pZ = z >> 2;
+        const int pW = ((x + w) >> 2) - pX + 2, pH = ((z + h) >> 2) - pZ + 2;
+        P::gen(s, out, pX, pZ, pW, pH);
+
+        int *buf = out + pW * pH;
+        mc15VoronoiCells(out, pX, pZ, pW, pH, x, z, w, h, s.startSeed[Id], s.startSalt[Id], buf, buf + w * h);
+        memmove(out, buf, sizeof(int) * w * h);
+    }
+};
+
+// Interval of cells of layer To that influences [lo, hi] of layer From,
+// following the biome branch as mapIntervalToLayer()
+template <typename From, typename To>
+constexpr void mc15MapInterval(int &lo, int &hi)
+{
+    if constexpr (!std::is_same_v<From, To>)
+    {
+        static_assert(!std::is_void_v<typename From::Parent>, "layer is not a parent of the other");
+        From::mapInterval(lo, hi);
+        mc15MapInterval<typename From::Parent, To>(lo, hi);
+    }
+}
+
+// The chain of setupLayerStack() for 1.3 - 1.6, salts as listed there
+using Mc15Continent4096 = Mc15Continent<L_CONTINENT_4096, 1>;
+using Mc15Zoom2048 = Mc15Zoom<L_ZOOM_2048, 2000, Mc15Continent4096, true>;
+using Mc15Land2048 = Mc15Land<L_LAND_2048, 1, Mc15Zoom2048>;
+using Mc15Zoom1024 = Mc15Zoom<L_ZOOM_1024, 2001, Mc15Land2048>;
+using Mc15Land1024 = Mc15Land<L_LAND_1024_A, 2, Mc15Zoom1024>;
+using Mc15Snow1024 = Mc15Snow<L_SNOW_1024, 2, Mc15Land1024>;
+using Mc15Zoom512 = Mc15Zoom<L_ZOOM_512, 2002, Mc15Snow1024>;
+using Mc15Land512 = Mc15Land<L_LAND_512, 3, Mc15Zoom512>;
+using Mc15Zoom256 = Mc15Zoom<L_ZOOM_256, 2003, Mc15Land512>;
+using Mc15Land256 = Mc15Land<L_LAND_256, 4, Mc15Zoom256>;
+using Mc15Mushroom256 = Mc15Mushroom<L_MUSHROOM_256, 5, Mc15Land256>;
+using Mc15Biome256 = Mc15Biome<L_BIOME_256, 200, Mc15Mushroom256>;
+using Mc15Zoom128 = Mc15Zoom<L_ZOOM_128, 1000, Mc15Biome256>;
+using Mc15Zoom64 = Mc15Zoom<L_ZOOM_64, 1001, Mc15Zoom128>;
+using Mc15Hills64 = Mc15Hills<L_HILLS_64, 1000, Mc15Zoom64>;
+using Mc15Zoom32 = Mc15Zoom<L_ZOOM_32, 1000, Mc15Hills64>;
+using Mc15Land32 = Mc15Land<L_LAND_32, 3, Mc15Zoom32>;
+using Mc15Zoom16 = Mc15Zoom<L_ZOOM_16, 1001, Mc15Land32>;
+using Mc15Shore16 = Mc15Shore<L_SHORE_16, 1000, Mc15Zoom16>;
+using Mc15SwampRiver16 = Mc15SwampRiver<L_SWAMP_RIVER_16, 1000, Mc15Shore16>;
+using Mc15Zoom8 = Mc15Zoom<L_ZOOM_8, 1002, Mc15SwampRiver16>;
+using Mc15Zoom4 = Mc15Zoom<L_ZOOM_4, 1003, Mc15Zoom8>;
+using Mc15Smooth4 = Mc15Smooth<L_SMOOTH_4, 1000, Mc15Zoom4>;
+
+using Mc15Noise256 = Mc15Noise<L_NOISE_256, 100, Mc15Mushroom256>;
+using Mc15ZoomRiver128 = Mc15Zoom<L_ZOOM_128_RIVER, 1000, Mc15Noise256>;
+using Mc15ZoomRiver64 = Mc15Zoom<L_ZOOM_64_RIVER, 1001, Mc15ZoomRiver128>;
+using Mc15ZoomRiver32 = Mc15Zoom<L_ZOOM_32_RIVER, 1002, Mc15ZoomRiver64>;
+using Mc15ZoomRiver16 = Mc15Zoom<L_ZOOM_16_RIVER, 1003, Mc15ZoomRiver32>;
+using Mc15ZoomRiver8 = Mc15Zoom<L_ZOOM_8_RIVER, 1004, Mc15ZoomRiver16>;
+using Mc15ZoomRiver4 = Mc15Zoom<L_ZOOM_4_RIVER, 1005, Mc15ZoomRiver8>;
+using Mc15River4 = Mc15River<L_RIVER_4, 1, Mc15ZoomRiver4>;
+using Mc15SmoothRiver4 = Mc15Smooth<L_SMOOTH_4_RIVER, 1000, Mc15River4>;
+
+using Mc15RiverMix4 = Mc15RiverMix<L_RIVER_MIX_4, 100, Mc15Smooth4, Mc15SmoothRiver4>;
+using Mc15Voronoi1 = Mc15Voronoi<L_VORONOI_1, 10, Mc15RiverMix4>;
+
+// Seeds every layer of the chain for worldSeed, as applySeed()
+inline void mc15ApplySeed(Mc15Seeds &s, uint64_t worldSeed)
+{
+    auto seedAll = [&](auto... layers)
+    { (decltype(layers)::seed(s, worldSeed), ...); };
+    seedAll(Mc15Continent4096{}, Mc15Zoom2048{}, Mc15Land2048{}, Mc15Zoom1024{}, Mc15Land1024{}, Mc15Snow1024{},
+            Mc15Zoom512{}, Mc15Land512{}, Mc15Zoom256{}, Mc15Land256{}, Mc15Mushroom256{}, Mc15Biome256{},
+            Mc15Zoom128{}, Mc15Zoom64{}, Mc15Hills64{}, Mc15Zoom32{}, Mc15Land32{}, Mc15Zoom16{}, Mc15Shore16{},
+            Mc15SwampRiver16{}, Mc15Zoom8{}, Mc15Zoom4{}, Mc15Smooth4{}, Mc15Noise256{}, Mc15ZoomRiver128{},
+            Mc15ZoomRiver64{}, Mc15ZoomRiver32{}, Mc15ZoomRiver16{}, Mc15ZoomRiver8{}, Mc15ZoomRiver4{},
+            Mc15River4{}, Mc15SmoothRiver4{}, Mc15RiverMix4{}, Mc15Voronoi1{});
+}
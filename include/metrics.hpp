@@ -0,0 +1,367 @@
+#pragma once
+
+#include <checkpoint.hpp>
+#include <options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Per candidate counters, every finder fills the same set (the layer cache
+// ones stay 0 in finders without a CoarseLayerCache)
+enum MetricCounter
+{
+    CTR_ITEMS,              // seeds, quad bases or regions finished
+    CTR_CANDIDATES,         // temple positions that entered the evaluator
+    CTR_REJECTED_BIOME,     // no temple biome at the chunk center
+    CTR_REJECTED_SCORE,     // could not beat the score to beat
+    CTR_SCORED,             // exact type and score known
+    CTR_NEW_BESTS,
+    CTR_LAYER_CACHE_HITS,   // coarse layer slabs answered from the cache
+    CTR_LAYER_CACHE_MISSES, // coarse layer slabs generated
+    CTR_NUM
+};
+
+// Timed stages of the hot path
+enum MetricStage
+{
+    STAGE_APPLY_SEED, // applySeed
+    STAGE_PLACEMENT,  // temple positions (getFeaturePosBatch)
+    STAGE_CASCADE,    // coarse layer cascade: center biome test and 1:4 score bound
+    STAGE_SCORE,      // 1:1 pass: exact type and footprint score
+    STAGE_TILE_LOAD,  // coarse layer tiles of the location finder
+    STAGE_NUM
+};
+
+inline constexpr const char *METRIC_COUNTER_NAMES[CTR_NUM] = {"items", "candidates", "rejected_biome", "rejected_score", "scored", "new_bests",
+                                                                      "layer_cache_hits", "layer_cache_misses"};
+inline constexpr const char *METRIC_STAGE_NAMES[STAGE_NUM] = {"apply_seed", "placement", "cascade", "score", "tile_load"};
+
+// Reading the clock costs about as much as a 1:256 layer lookup, so only every
+// n-th call of a stage is timed and counts for n calls
+inline constexpr uint64_t STAGE_SAMPLE_EVERY = 64;
+
+// Cost of one steady_clock read, subtracted from every timed call
+inline uint64_t clockReadNanos()
+{
+    static const uint64_t nanos = []
+    {
+        const int reads = 1000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < reads - 1; ++i)
+            (void)std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return (uint64_t)ns / reads;
+    }();
+    return nanos;
+}
+
+// Counters of one worker thread. Only the owner writes, so an update is a
+// relaxed load and store without a locked instruction; the reporter reads
+// them concurrently.
+class alignas(64) ThreadMetrics
+{
+public:
+    void add(MetricCounter c, uint64_t n = 1)
+    {
+        counters[c].store(counters[c].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    uint64_t counter(MetricCounter c) const
+    {
+        return counters[c].load(std::memory_order_relaxed);
+    }
+
+    uint64_t stageCalls(MetricStage s) const
+    {
+        return calls[s].load(std::memory_order_relaxed);
+    }
+
+    uint64_t stageNanos(MetricStage s) const
+    {
+        return nanos[s].load(std::memory_order_relaxed);
+    }
+
+    // Times one call of a stage for its lifetime. m may be null.
+    class StageTimer
+    {
+    public:
+        StageTimer(ThreadMetrics *m, MetricStage s)
+            : m(m), s(s)
+        {
+            if (!m)
+                return;
+            uint64_t n = m->calls[s].load(std::memory_order_relaxed);
+            m->calls[s].store(n + 1, std::memory_order_relaxed);
+            if (n % STAGE_SAMPLE_EVERY == 0)
+            {
+                sampled = true;
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~StageTimer()
+        {
+            if (!sampled)
+                return;
+            uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            ns -= std::min(ns, clockReadNanos());
+            m->nanos[s].store(m->nanos[s].load(std::memory_order_relaxed) + ns * STAGE_SAMPLE_EVERY, std::memory_order_relaxed);
+        }
+
+        StageTimer(const StageTimer &) = delete;
+        StageTimer &operator=(const StageTimer &) = delete;
+
+    private:
+        ThreadMetrics *m;
+        MetricStage s;
+        bool sampled = false;
+        std::chrono::steady_clock::time_point start;
+    };
+
+private:
+    std::atomic<uint64_t> counters[CTR_NUM] = {};
+    std::atomic<uint64_t> calls[STAGE_NUM] = {};
+    std::atomic<uint64_t> nanos[STAGE_NUM] = {}; // estimated from the sampled calls
+};
+
+// Sum over all workers at one point in time
+struct MetricsSnapshot
+{
+    double elapsed = 0; // seconds since the run started
+    uint64_t counters[CTR_NUM] = {};
+    uint64_t stageCalls[STAGE_NUM] = {};
+    uint64_t stageNanos[STAGE_NUM] = {};
+    int bestScore = -1;
+    double secondsToBest = -1; // when bestScore was reached, -1 before
+    uint64_t itemsToBest = 0;  // items finished by then
+};
+
+// Metrics of one finder run: a ThreadMetrics per worker and, with
+// --metrics <file>, a reporter thread that writes a snapshot every
+// metricsEverySeconds and once more when the run ends.
+//
+// jsonl appends one JSON object per snapshot. prom rewrites the file in the
+// Prometheus text format, for the node_exporter textfile collector.
+class FinderMetrics
+{
+public:
+    // totalItems is the number of items this run will finish, 0 if unbounded
+    FinderMetrics(const FinderOptions &opt, const char *finder, unsigned int numWorkers, uint64_t totalItems)
+        : finder(finder), path(opt.metricsPath), prometheus(opt.metricsFormat == "prom"),
+          interval(std::chrono::seconds(opt.metricsEverySeconds)), totalItems(totalItems),
+          startTime(std::chrono::steady_clock::now()), workers(numWorkers)
+    {
+        if (!path.empty())
+            reporter = std::thread([this]
+                                   { report(); });
+    }
+
+    ~FinderMetrics()
+    {
+        stop();
+    }
+
+    FinderMetrics(const FinderMetrics &) = delete;
+    FinderMetrics &operator=(const FinderMetrics &) = delete;
+
+    ThreadMetrics *worker(unsigned int i)
+    {
+        return &workers[i];
+    }
+
+    // Called for every new best result, from any thread
+    void recordBest(int score)
+    {
+        newBests.fetch_add(1, std::memory_order_relaxed);
+        int best = bestScore.load(std::memory_order_relaxed);
+        while (score > best && !bestScore.compare_exchange_weak(best, score, std::memory_order_relaxed))
+        {
+        }
+        if (score <= best)
+            return;
+
+        // Time to best: when the best score so far was first reached, to
+        // compare search orders. Ties do not move it.
+        uint64_t items = 0;
+        for (const ThreadMetrics &w : workers)
+            items += w.counter(CTR_ITEMS);
+        std::lock_guard<std::mutex> lock(bestMutex);
+        if (score >= bestReached.score)
+        {
+            bestReached.score = score;
+            bestReached.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            bestReached.items = items;
+        }
+    }
+
+    // Seconds and items until the best score was reached, seconds < 0 before
+    void timeToBest(double &seconds, uint64_t &items) const
+    {
+        std::lock_guard<std::mutex> lock(bestMutex);
+        seconds = bestReached.seconds;
+        items = bestReached.items;
+    }
+
+    MetricsSnapshot snapshot() const
+    {
+        MetricsSnapshot s;
+        s.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        for (const ThreadMetrics &w : workers)
+        {
+            for (int c = 0; c < CTR_NUM; ++c)
+                s.counters[c] += w.counter((MetricCounter)c);
+            for (int st = 0; st < STAGE_NUM; ++st)
+            {
+                s.stageCalls[st] += w.stageCalls((MetricStage)st);
+                s.stageNanos[st] += w.stageNanos((MetricStage)st);
+            }
+        }
+        s.counters[CTR_NEW_BESTS] += newBests.load(std::memory_order_relaxed);
+        s.bestScore = bestScore.load(std::memory_order_relaxed);
+        timeToBest(s.secondsToBest, s.itemsToBest);
+        return s;
+    }
+
+    // Stops the reporter after writing the final snapshot, the workers must be done
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (reporter.joinable())
+            reporter.join();
+    }
+
+private:
+    void report()
+    {
+        MetricsSnapshot prev;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            bool last = wake.wait_for(lock, interval, [this]
+                                      { return stopping; });
+            MetricsSnapshot cur = snapshot();
+            if (!write(cur, prev))
+                fprintf(stderr, "Failed to write metrics '%s'\n", path.c_str());
+            prev = cur;
+            if (last)
+                return;
+        }
+    }
+
+    bool write(const MetricsSnapshot &cur, const MetricsSnapshot &prev) const
+    {
+        // Rates over the last interval, the ETA from the average rate of the run
+        double dt = cur.elapsed - prev.elapsed;
+        double itemRate = dt > 0 ? (cur.counters[CTR_ITEMS] - prev.counters[CTR_ITEMS]) / dt : 0;
+        double candidateRate = dt > 0 ? (cur.counters[CTR_CANDIDATES] - prev.counters[CTR_CANDIDATES]) / dt : 0;
+        double avgRate = cur.elapsed > 0 ? cur.counters[CTR_ITEMS] / cur.elapsed : 0;
+        double eta = -1;
+        if (totalItems && avgRate > 0)
+            eta = cur.counters[CTR_ITEMS] >= totalItems ? 0 : (totalItems - cur.counters[CTR_ITEMS]) / avgRate;
+
+        return prometheus ? writePrometheus(cur, itemRate, candidateRate, eta)
+                          : writeJsonLine(cur, itemRate, candidateRate, eta);
+    }
+
+    bool writeJsonLine(const MetricsSnapshot &s, double itemRate, double candidateRate, double eta) const
+    {
+        FILE *fp = fopen(path.c_str(), "a");
+        if (!fp)
+            return false;
+
+        long long now = (long long)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        fprintf(fp, "{\"finder\":\"%s\",\"time\":%lld,\"elapsed_s\":%.3f,\"workers\":%zu", finder.c_str(), now, s.elapsed, workers.size());
+        for (int c = 0; c < CTR_NUM; ++c)
+            fprintf(fp, ",\"%s\":%llu", METRIC_COUNTER_NAMES[c], (unsigned long long)s.counters[c]);
+        fprintf(fp, ",\"items_per_s\":%.1f,\"candidates_per_s\":%.1f,\"total_items\":%llu", itemRate, candidateRate, (unsigned long long)totalItems);
+        if (eta >= 0)
+            fprintf(fp, ",\"eta_s\":%.0f", eta);
+        else
+            fprintf(fp, ",\"eta_s\":null");
+        fprintf(fp, ",\"best_score\":%d", s.bestScore);
+        if (s.secondsToBest >= 0)
+            fprintf(fp, ",\"time_to_best_s\":%.3f,\"items_to_best\":%llu", s.secondsToBest, (unsigned long long)s.itemsToBest);
+        else
+            fprintf(fp, ",\"time_to_best_s\":null,\"items_to_best\":null");
+        fprintf(fp, ",\"stage_s\":{");
+        for (int st = 0; st < STAGE_NUM; ++st)
+            fprintf(fp, "%s\"%s\":%.6f", st ? "," : "", METRIC_STAGE_NAMES[st], s.stageNanos[st] / 1e9);
+        fprintf(fp, "},\"stage_calls\":{");
+        for (int st = 0; st < STAGE_NUM; ++st)
+            fprintf(fp, "%s\"%s\":%llu", st ? "," : "", METRIC_STAGE_NAMES[st], (unsigned long long)s.stageCalls[st]);
+        fprintf(fp, "}}\n");
+        return fclose(fp) == 0;
+    }
+
+    bool writePrometheus(const MetricsSnapshot &s, double itemRate, double candidateRate, double eta) const
+    {
+        const std::string tmpPath = path + ".tmp";
+        FILE *fp = fopen(tmpPath.c_str(), "w");
+        if (!fp)
+            return false;
+
+        const char *f = finder.c_str();
+        fprintf(fp, "# TYPE seedfinder_elapsed_seconds gauge\nseedfinder_elapsed_seconds{finder=\"%s\"} %.3f\n", f, s.elapsed);
+        fprintf(fp, "# TYPE seedfinder_workers gauge\nseedfinder_workers{finder=\"%s\"} %zu\n", f, workers.size());
+        for (int c = 0; c < CTR_NUM; ++c)
+            fprintf(fp, "# TYPE seedfinder_%s_total counter\nseedfinder_%s_total{finder=\"%s\"} %llu\n",
+                    METRIC_COUNTER_NAMES[c], METRIC_COUNTER_NAMES[c], f, (unsigned long long)s.counters[c]);
+        fprintf(fp, "# TYPE seedfinder_items_per_second gauge\nseedfinder_items_per_second{finder=\"%s\"} %.1f\n", f, itemRate);
+        fprintf(fp, "# TYPE seedfinder_candidates_per_second gauge\nseedfinder_candidates_per_second{finder=\"%s\"} %.1f\n", f, candidateRate);
+        fprintf(fp, "# TYPE seedfinder_total_items gauge\nseedfinder_total_items{finder=\"%s\"} %llu\n", f, (unsigned long long)totalItems);
+        if (eta >= 0)
+            fprintf(fp, "# TYPE seedfinder_eta_seconds gauge\nseedfinder_eta_seconds{finder=\"%s\"} %.0f\n", f, eta);
+        fprintf(fp, "# TYPE seedfinder_best_score gauge\nseedfinder_best_score{finder=\"%s\"} %d\n", f, s.bestScore);
+        if (s.secondsToBest >= 0)
+        {
+            fprintf(fp, "# TYPE seedfinder_time_to_best_seconds gauge\nseedfinder_time_to_best_seconds{finder=\"%s\"} %.3f\n", f, s.secondsToBest);
+            fprintf(fp, "# TYPE seedfinder_items_to_best gauge\nseedfinder_items_to_best{finder=\"%s\"} %llu\n", f, (unsigned long long)s.itemsToBest);
+        }
+        fprintf(fp, "# TYPE seedfinder_stage_seconds_total counter\n");
+        for (int st = 0; st < STAGE_NUM; ++st)
+            fprintf(fp, "seedfinder_stage_seconds_total{finder=\"%s\",stage=\"%s\"} %.6f\n", f, METRIC_STAGE_NAMES[st], s.stageNanos[st] / 1e9);
+        fprintf(fp, "# TYPE seedfinder_stage_calls_total counter\n");
+        for (int st = 0; st < STAGE_NUM; ++st)
+            fprintf(fp, "seedfinder_stage_calls_total{finder=\"%s\",stage=\"%s\"} %llu\n", f, METRIC_STAGE_NAMES[st], (unsigned long long)s.stageCalls[st]);
+
+        if (fclose(fp) != 0)
+            return false;
+        return replaceFile(tmpPath, path);
+    }
+
+    std::string finder;
+    std::string path;
+    bool prometheus;
+    std::chrono::steady_clock::duration interval;
+    uint64_t totalItems;
+    std::chrono::steady_clock::time_point startTime;
+
+    std::vector<ThreadMetrics> workers;
+    std::atomic<uint64_t> newBests{0};
+    std::atomic<int> bestScore{-1};
+
+    struct BestReached
+    {
+        int score = -1;
+        double seconds = -1;
+        uint64_t items = 0;
+    };
+    mutable std::mutex bestMutex; // protects bestReached
+    BestReached bestReached;
+
+    std::mutex mutex; // protects stopping
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread reporter;
+};
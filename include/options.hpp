@@ -0,0 +1,116 @@
+#pragma once
+
+#include <config.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Largest --tile-regions, keeps the tiles of a worker below ~60 MB
+inline constexpr unsigned int MAX_TILE_REGIONS = 256;
+
+// Largest --batch
+inline constexpr unsigned int MAX_BATCH_SIZE = 1 << 20;
+
+// Largest --top-k
+inline constexpr unsigned int MAX_TOP_K = 4096;
+
+// Command line options shared by the finders
+struct FinderOptions
+{
+    // First seed (seed finder) or first quad base index (quad finder)
+    uint64_t startSeed = 0;
+
+    // This process handles every item with (item - startSeed) % shardCount == shardIndex
+    uint32_t shardIndex = 0;
+    uint32_t shardCount = 1;
+
+    // Progress file, empty to disable. Resumed from when it already exists
+    std::string checkpointPath;
+    unsigned int checkpointEverySeconds = 60;
+
+    // Worker threads, 0 for one per hardware thread
+    unsigned int threads = 0;
+
+    // Pin worker i to the i-th CPU, one per physical core before SMT siblings
+    bool pinThreads = false;
+
+    // Stop after this many seeds (seed finder) or quad bases (quad finder), 0 for no limit
+    uint64_t maxItems = 0;
+
+    // Quad finder: scan these bases instead of the searchAll48 result
+    std::vector<uint64_t> quadBases;
+
+    // Quad finder: search the bases best ranked first (see rankQuadBases())
+    // instead of in index order. Items, shards and checkpoints are in that order.
+    bool rankedBases = true;
+
+    // Seed finder: walk the structure seeds and, within each, its 65536
+    // upper 16 bit siblings (see siblingOrderSeed()). Items, shards and
+    // checkpoints are in that order, startSeed is the first seed of it.
+    bool siblingOrder = false;
+
+    // Temple types searched for, a combination of TempleType bits
+    int templeTypes = SELECTED_TEMPLE_TYPES;
+
+    // Height of the biome queries
+    int queryY = QUERY_Y;
+
+    // Search radius in blocks (rounded down to whole regions), 0 for the
+    // finder's default: 65536 for the seed finder, the whole world for the
+    // location finder
+    unsigned int areaRadiusBlocks = 0;
+
+    // Candidates per batch of the CandidatePipeline (seed and location
+    // finders), 0 for PIPELINE_BATCH
+    unsigned int batchSize = 0;
+
+    // Items (seeds, quad bases or regions) between progress lines, 0 for the
+    // finder's default
+    uint64_t progressEvery = 0;
+
+    // Location finder: side of the square of regions whose coarse biome layers
+    // are generated at once, 0 walks the region spiral without tiles
+    unsigned int tileRegions = 32;
+
+    // Location finder: also find groups of 2 to 4 temples that share one AFK
+    // sphere, scored by the swamp spawn blocks in reach (see TempleClusterIndex).
+    // Scores every temple, not only the top-K.
+    bool clusters = false;
+
+    // Results kept overall and per temple type, the finders prune below the K-th score
+    unsigned int topK = 16;
+
+    // Binary result file appended to, empty for the finder's file in logs/
+    std::string resultsPath;
+
+    // Bin width of the score histogram, 0 to disable
+    unsigned int histogramBinWidth = 16;
+
+    // Query server: Unix socket to listen on, empty for stdin and stdout
+    std::string socketPath;
+
+    // Metrics snapshot file, empty to disable. Format "jsonl" or "prom"
+    std::string metricsPath;
+    std::string metricsFormat = "jsonl";
+    unsigned int metricsEverySeconds = 10;
+};
+
+// Whole decimal numbers of the command line, false on anything else
+inline bool parse_u64(const char *s, uint64_t &out)
+{
+    char *endptr = nullptr;
+    out = (uint64_t)strtoull(s, &endptr, 10);
+    return endptr && endptr != s && *endptr == '\0';
+}
+
+// Counts (--top, --size, --threads) of the subcommands
+inline bool parse_count(const char *s, size_t &out)
+{
+    uint64_t n = 0;
+    if (!parse_u64(s, n) || n > SIZE_MAX)
+        return false;
+    out = (size_t)n;
+    return true;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <checkpoint.hpp>
+#include <mapped_file.hpp>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+extern "C"
+{
+#include "finders.h"
+}
+
+// Radius of isQuadBase() for the quad finder's bases
+inline constexpr int QUAD_BASE_RADIUS = 148;
+
+// Everything the base list of searchAll48 depends on
+struct QuadBaseKey
+{
+    int32_t mcVersion;
+    int32_t salt;
+    int32_t regionSize;
+    int32_t chunkRange;
+    int32_t structType;
+    int32_t radius;
+    int32_t lowBitN;
+    int32_t reserved;
+    uint64_t lowBitsHash; // FNV-1a of the zero terminated low bit table
+};
+
+inline QuadBaseKey quadBaseKey(int mcVersion, const StructureConfig &sconf, int radius, const uint64_t *lowBits, int lowBitN)
+{
+    QuadBaseKey key = {};
+    key.mcVersion = mcVersion;
+    key.salt = sconf.salt;
+    key.regionSize = sconf.regionSize;
+    key.chunkRange = sconf.chunkRange;
+    key.structType = sconf.structType;
+    key.radius = radius;
+    key.lowBitN = lowBitN;
+    key.lowBitsHash = 0xcbf29ce484222325ULL;
+    for (const uint64_t *b = lowBits; *b; ++b)
+        for (int i = 0; i < 8; ++i)
+            key.lowBitsHash = (key.lowBitsHash ^ ((*b >> (8 * i)) & 0xff)) * 0x100000001b3ULL;
+    return key;
+}
+
+inline bool operator==(const QuadBaseKey &a, const QuadBaseKey &b)
+{
+    return memcmp(&a, &b, sizeof(QuadBaseKey)) == 0;
+}
+
+// Quad base cache file: a QuadBaseCacheHeader followed by the count sorted
+// 48-bit bases as uint64_t in host byte order. The file is mapped as is, so
+// the bases are used straight from the page cache.
+inline constexpr char QUAD_BASE_CACHE_MAGIC[8] = {'W', 'T', 'F', 'Q', 'B', 'A', 'S', 'E'};
+inline constexpr uint32_t QUAD_BASE_CACHE_VERSION = 1;
+
+struct QuadBaseCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    QuadBaseKey key;
+    uint64_t count;
+};
+
+static_assert(sizeof(QuadBaseKey) == 40, "quad base key layout changed");
+static_assert(sizeof(QuadBaseCacheHeader) == 64, "quad base cache header layout changed");
+
+// Cache file name of a key, so different configs never share a file
+inline std::string quadBaseCachePath(const QuadBaseKey &key)
+{
+    char name[96];
+    snprintf(name, sizeof(name), "logs/quad_bases_%d_%d_r%d_%016" PRIx64 ".bin", key.mcVersion, key.salt, key.radius, key.lowBitsHash);
+    return name;
+}
+
+// Writes the bases to path in one step (through a temporary file), so
+// concurrent launches never see a partial cache. Creates the directory.
+inline bool saveQuadBases(const std::string &path, const QuadBaseKey &key, const uint64_t *bases, uint64_t count)
+{
+    std::error_code ec;
+    if (std::filesystem::path(path).has_parent_path())
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    QuadBaseCacheHeader header = {};
+    memcpy(header.magic, QUAD_BASE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = QUAD_BASE_CACHE_VERSION;
+    header.key = key;
+    header.count = count;
+
+    const std::string tmpPath = path + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(bases, sizeof(uint64_t), count, fp) == count;
+    ok &= fclose(fp) == 0;
+    return ok && replaceFile(tmpPath, path);
+}
+
+// Mapped base list of a cache file
+class QuadBaseCache
+{
+public:
+    // Maps path if it holds the bases of key, returns false (after printing
+    // why, unless the file does not exist) otherwise
+    bool open(const std::string &path, const QuadBaseKey &key)
+    {
+        std::ifstream probe(path);
+        if (!probe)
+            return false;
+        probe.close();
+
+        if (!file.open(path, sizeof(QuadBaseCacheHeader)))
+        {
+            fprintf(stderr, "Failed to map quad base cache '%s'\n", path.c_str());
+            return false;
+        }
+        const QuadBaseCacheHeader &h = *(const QuadBaseCacheHeader *)file.data();
+        if (memcmp(h.magic, QUAD_BASE_CACHE_MAGIC, sizeof(h.magic)) != 0 || h.version != QUAD_BASE_CACHE_VERSION || !(h.key == key))
+        {
+            fprintf(stderr, "Quad base cache '%s' is for another version or config\n", path.c_str());
+            file.close();
+            return false;
+        }
+        if (file.size() != sizeof(QuadBaseCacheHeader) + h.count * sizeof(uint64_t))
+        {
+            fprintf(stderr, "Quad base cache '%s' is truncated\n", path.c_str());
+            file.close();
+            return false;
+        }
+        return true;
+    }
+
+    const uint64_t *bases() const
+    {
+        return (const uint64_t *)(file.data() + sizeof(QuadBaseCacheHeader));
+    }
+
+    uint64_t count() const
+    {
+        return file.data() ? ((const QuadBaseCacheHeader *)file.data())->count : 0;
+    }
+
+private:
+    MappedFile file;
+};
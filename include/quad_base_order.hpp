@@ -0,0 +1,87 @@
+#pragma once
+
+#include <finder_utils.hpp>
+#include <quad_base_cache.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Seed independent quality of a quad base, from the positions of its 4
+// temples alone. The scores themselves need the biomes of every seed, so
+// this only decides which bases are searched first.
+struct QuadBaseRank
+{
+    // Footprint blocks of the 4 temples within 128 blocks (horizontally) of
+    // the center of their bounding box, where the player would AFK
+    int blocksInReach;
+
+    // Radius of the sphere enclosing all 4 temples (isQuadBase()), smaller is better
+    float radius;
+};
+
+// Ranks the base the way the quad finder places its temples: regions
+// (-1,-1), (-1,0), (0,-1), (0,0) of the base moved by (-1,-1)
+inline QuadBaseRank rankQuadBase(const StructureConfig &sconf, uint64_t base, int templeTypes)
+{
+    const int w = footprintW(templeTypes), d = footprintD(templeTypes);
+    const uint64_t s48 = moveStructure(base - sconf.salt, -1, -1);
+
+    Pos p[4];
+    for (int j = 0; j < 4; ++j)
+        p[j] = getFeaturePos(sconf, s48, j / 2 - 1, j % 2 - 1);
+
+    int minX = p[0].x, maxX = p[0].x, minZ = p[0].z, maxZ = p[0].z;
+    for (int j = 1; j < 4; ++j)
+    {
+        minX = std::min(minX, p[j].x);
+        maxX = std::max(maxX, p[j].x);
+        minZ = std::min(minZ, p[j].z);
+        maxZ = std::max(maxZ, p[j].z);
+    }
+
+    // Block centers against the center of the box, doubled to stay in integers
+    const int64_t cx = (int64_t)minX + maxX + w, cz = (int64_t)minZ + maxZ + d;
+    const int64_t reachSq = 4 * 128 * 128;
+    QuadBaseRank rank = {0, isQuadBase(sconf, base - sconf.salt, QUAD_BASE_RADIUS)};
+    for (int j = 0; j < 4; ++j)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            const int64_t dx = 2 * (int64_t)(p[j].x + x) + 1 - cx;
+            for (int z = 0; z < d; ++z)
+            {
+                const int64_t dz = 2 * (int64_t)(p[j].z + z) + 1 - cz;
+                rank.blocksInReach += dx * dx + dz * dz <= reachSq;
+            }
+        }
+    }
+    return rank;
+}
+
+// True if a should be searched before b: more footprint in reach, then the
+// smaller enclosing radius (0, not a quad base at all, last)
+inline bool rankedBefore(const QuadBaseRank &a, const QuadBaseRank &b)
+{
+    if (a.blocksInReach != b.blocksInReach)
+        return a.blocksInReach > b.blocksInReach;
+    if ((a.radius > 0) != (b.radius > 0))
+        return a.radius > 0;
+    return a.radius < b.radius;
+}
+
+// Indices of the bases, best ranked first. Ties keep the index order, so the
+// order is the same on every launch and shards and checkpoints can use it.
+inline std::vector<uint64_t> rankQuadBases(const StructureConfig &sconf, const uint64_t *bases, uint64_t count, int templeTypes)
+{
+    std::vector<QuadBaseRank> ranks(count);
+    std::vector<uint64_t> order(count);
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        ranks[i] = rankQuadBase(sconf, bases[i], templeTypes);
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b)
+                     { return rankedBefore(ranks[a], ranks[b]); });
+    return order;
+}
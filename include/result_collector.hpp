@@ -0,0 +1,487 @@
+#pragma once
+
+#include <finder_utils.hpp>
+#include <metrics.hpp>
+#include <options.hpp>
+#include <result_file.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Results waiting for the writer per worker, a full ring makes the worker wait
+constexpr size_t RESULT_RING_SIZE = 1024;
+
+// Histogram bins, scores past the last bin are counted in it
+constexpr int HISTOGRAM_BINS = 1024;
+
+// Ties with the K-th score kept per list on top of the K results. Witch huts
+// fully in swamp all score the same, so ties can otherwise grow without bound.
+constexpr size_t MAX_EXTRA_TIES = 256;
+
+// How often the writer drains the worker rings
+constexpr auto RESULT_WRITER_PERIOD = std::chrono::milliseconds(20);
+
+struct FoundTemple
+{
+    int type;
+    int swampSpawnBlocks;
+    int x, z;
+};
+
+// One reported result: a single temple, or the 4 temples of a quad
+struct FoundResult
+{
+    int64_t seed = 0;
+    int score = 0; // sum over the temples, in reach of the AFK point for clusters
+    int count = 0;
+    FoundTemple temples[4] = {};
+};
+
+// Collects the results of a run without making the workers wait on each other.
+//
+// Workers only check threshold() and push results that reach it into their own
+// ring. A writer thread drains the rings, keeps the top-K results overall and
+// per temple type (ties with the K-th score are kept), prints new bests and
+// appends every result that enters the top-K to the text log and the binary
+// result file (opt.resultsPath, else resultsPath), one flush per batch.
+// threshold() is the lowest score that can still enter a list: the K-th
+// score of the selected type with the weakest list (of the overall list for
+// quads, which have no per-type lists). The finders prune with it instead of
+// with the best score. A resumed run only gets back the best result of the
+// earlier runs, so its lists cover this launch and that result.
+//
+// Every worker also counts the score of each candidate it scored into its
+// histogram, written to histogramPath at the end. Candidates pruned below the
+// threshold are never scored, so the counts are complete for scores at or
+// above the final threshold (printed as exact-from).
+class ResultCollector
+{
+public:
+    ResultCollector(const FinderOptions &opt, ResultFormat format, const char *logPath, const char *logHeader,
+                    const char *resultsPath, const char *histogramPath, unsigned int workers, FinderMetrics *metrics = nullptr)
+        : format(format), topK(std::max(1u, opt.topK)), binWidth(opt.histogramBinWidth), templeTypes(opt.templeTypes),
+          histogramPath(histogramPath), metrics(metrics), rings(workers)
+    {
+        log = fopen(logPath, "a");
+        if (!log)
+            fprintf(stderr, "Failed to open log file '%s'\n", logPath);
+        else
+            fprintf(log, "%s", logHeader);
+
+        ResultFileHeader header = {};
+        memcpy(header.magic, RESULT_FILE_MAGIC, sizeof(header.magic));
+        header.version = RESULT_FILE_VERSION;
+        header.recordSize = sizeof(ResultRecord);
+        header.finder = format;
+        header.mcVersion = MC_VERSION;
+        header.startSeed = opt.startSeed;
+        header.shardIndex = opt.shardIndex;
+        header.shardCount = opt.shardCount;
+        header.templeTypes = (uint32_t)opt.templeTypes;
+        header.topK = topK;
+        header.queryY = opt.queryY;
+        header.createdUnix = (int64_t)time(nullptr);
+        resultFile.open(opt.resultsPath.empty() ? resultsPath : opt.resultsPath, header);
+
+        for (Ring &ring : rings)
+        {
+            ring.results.resize(RESULT_RING_SIZE);
+            if (binWidth)
+                ring.histogram = std::vector<std::atomic<uint64_t>>(HISTOGRAM_BINS);
+        }
+        writer = std::thread([this]
+                             { run(); });
+    }
+
+    ~ResultCollector()
+    {
+        stop();
+    }
+
+    ResultCollector(const ResultCollector &) = delete;
+    ResultCollector &operator=(const ResultCollector &) = delete;
+
+    // Lowest score that can still enter the top-K of any selected temple type
+    int threshold() const
+    {
+        return minScore.load(std::memory_order_relaxed);
+    }
+
+    // Lowest score a single temple of the type (as isViableTemplePos) can
+    // still enter the top-K with, threshold() for quads
+    int threshold(int templeType) const
+    {
+        return perTypeLists() ? typeMinScore[templeType & 3].load(std::memory_order_relaxed) : threshold();
+    }
+
+    // Hands a result to the writer. Only one thread at a time may use a worker slot.
+    void submit(unsigned int worker, const FoundResult &r)
+    {
+        Ring &ring = rings[worker];
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        while (head - ring.tail.load(std::memory_order_acquire) >= RESULT_RING_SIZE)
+            std::this_thread::yield(); // the writer is behind
+        ring.results[head % RESULT_RING_SIZE] = r;
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    // Counts a scored candidate in the histogram of the worker
+    void recordScore(unsigned int worker, int score)
+    {
+        if (!binWidth)
+            return;
+        std::atomic<uint64_t> &bin = rings[worker].histogram[std::min(score / (int)binWidth, HISTOGRAM_BINS - 1)];
+        bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Puts a result found by an earlier run (e.g. from a checkpoint) into the top-K without logging it
+    void restore(const FoundResult &r)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        hasBest = true;
+        best = r;
+        resumed = true;
+        insert(overall, r);
+        if (perTypeLists() && r.count == 1)
+            insert(perType[r.temples[0].type], r);
+        updateThreshold();
+    }
+
+    // Waits until the writer has taken every result submitted before the call
+    void sync()
+    {
+        std::vector<uint64_t> heads;
+        for (const Ring &ring : rings)
+            heads.push_back(ring.head.load(std::memory_order_acquire));
+        for (size_t i = 0; i < rings.size(); ++i)
+            while (rings[i].tail.load(std::memory_order_acquire) < heads[i])
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Best result so far, false if there is none
+    bool bestResult(FoundResult &out)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        out = best;
+        return hasBest;
+    }
+
+    // Drains the rings, prints the top-K tables and writes the histogram. The workers must be done.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            if (stopping)
+                return;
+            stopping = true;
+        }
+        wake.notify_all();
+        writer.join();
+
+        printTop();
+        writeHistogram();
+        if (log)
+            fclose(log);
+        log = nullptr;
+        resultFile.close();
+    }
+
+private:
+    struct alignas(64) Ring
+    {
+        std::atomic<uint64_t> head{0}; // written by the worker
+        alignas(64) std::atomic<uint64_t> tail{0}; // written by the writer
+        std::vector<FoundResult> results;
+        std::vector<std::atomic<uint64_t>> histogram;
+    };
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        for (;;)
+        {
+            bool last = wake.wait_for(lock, RESULT_WRITER_PERIOD, [this]
+                                      { return stopping; });
+            drain();
+            if (last)
+                return;
+        }
+    }
+
+    void drain()
+    {
+        bool wrote = false;
+        for (Ring &ring : rings)
+        {
+            uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+            uint64_t head = ring.head.load(std::memory_order_acquire);
+            for (; tail < head; ++tail)
+            {
+                wrote |= take(ring.results[tail % RESULT_RING_SIZE]);
+                ring.tail.store(tail + 1, std::memory_order_release);
+            }
+        }
+        if (wrote && log)
+            fflush(log);
+        if (wrote)
+            resultFile.flush();
+        fflush(stdout);
+    }
+
+    // Merges one result, returns true if it was logged
+    bool take(const FoundResult &r)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (r.score < (r.count == 1 ? threshold(r.temples[0].type) : threshold()))
+            return false;
+
+        // Ties replace the best, as the finders always did
+        if (!hasBest || r.score >= best.score)
+        {
+            hasBest = true;
+            best = r;
+            printNewBest(r);
+            if (metrics)
+                metrics->recordBest(r.score);
+        }
+
+        insert(overall, r);
+        if (perTypeLists() && r.count == 1)
+            insert(perType[r.temples[0].type], r);
+        updateThreshold();
+
+        writeLog(r);
+        return true;
+    }
+
+    // Keeps the list sorted by score, dropping what falls below the K-th score
+    void insert(std::vector<FoundResult> &list, const FoundResult &r)
+    {
+        if (list.size() >= topK + MAX_EXTRA_TIES && r.score <= list.back().score)
+        {
+            ++droppedTies;
+            return;
+        }
+
+        auto pos = std::upper_bound(list.begin(), list.end(), r, [](const FoundResult &a, const FoundResult &b)
+                                    { return a.score > b.score; });
+        list.insert(pos, r);
+        if (list.size() > topK)
+        {
+            int kth = list[topK - 1].score;
+            while (list.back().score < kth)
+                list.pop_back();
+            if (list.size() > topK + MAX_EXTRA_TIES)
+            {
+                list.pop_back();
+                ++droppedTies;
+            }
+        }
+    }
+
+    // Only results of single temples have per-type lists
+    bool perTypeLists() const
+    {
+        return format != RF_QUAD && format != RF_CLUSTER;
+    }
+
+    int kthScore(const std::vector<FoundResult> &list) const
+    {
+        return list.size() >= topK ? std::max(MIN_SWAMP_SPAWN_BLOCKS, list[topK - 1].score) : MIN_SWAMP_SPAWN_BLOCKS;
+    }
+
+    // A single temple enters the overall list only if it enters the list of
+    // its type, whose K-th score is never above the overall one
+    void updateThreshold()
+    {
+        if (!perTypeLists())
+        {
+            minScore.store(kthScore(overall), std::memory_order_relaxed);
+            return;
+        }
+
+        const int typeBits[4] = {0, TT_DESERT, TT_JUNGLE, TT_WITCH};
+        int lowest = INT_MAX;
+        for (int type = 1; type <= 3; ++type)
+        {
+            auto it = perType.find(type);
+            const int kth = it == perType.end() ? MIN_SWAMP_SPAWN_BLOCKS : kthScore(it->second);
+            typeMinScore[type].store(kth, std::memory_order_relaxed);
+            if (templeTypes & typeBits[type])
+                lowest = std::min(lowest, kth);
+        }
+        minScore.store(lowest == INT_MAX ? MIN_SWAMP_SPAWN_BLOCKS : lowest, std::memory_order_relaxed);
+    }
+
+    void printNewBest(const FoundResult &r) const
+    {
+        const FoundTemple &t = r.temples[0];
+        switch (format)
+        {
+        case RF_SEED:
+            printf("[NEW BEST] seed=%" PRId64 " type=%s swamp-spawn-blocks=%d -> /tp @p %d ~ %d\n",
+                   r.seed, templeTypeName(t.type), r.score, t.x, t.z);
+            break;
+        case RF_QUAD:
+            printf("[NEW BEST] seed=%" PRId64 ", swamp-spawn-blocks=%d\n", r.seed, r.score);
+            for (int j = 0; j < r.count; ++j)
+                printf("\t%s, %d: '/tp @p %d ~ %d'\n", templeTypeName(r.temples[j].type), r.temples[j].swampSpawnBlocks,
+                       r.temples[j].x, r.temples[j].z);
+            break;
+        case RF_LOCATION:
+            printf("[NEW BEST] type=%s swamp-spawn-blocks=%d -> /tp @p %d ~ %d\n", templeTypeName(t.type), r.score, t.x, t.z);
+            break;
+        case RF_CLUSTER:
+            printf("[NEW BEST] cluster of %d, swamp-spawn-blocks in reach=%d\n", r.count, r.score);
+            for (int j = 0; j < r.count; ++j)
+                printf("\t%s, %d: '/tp @p %d ~ %d'\n", templeTypeName(r.temples[j].type), r.temples[j].swampSpawnBlocks,
+                       r.temples[j].x, r.temples[j].z);
+            break;
+        }
+    }
+
+    void writeLog(const FoundResult &r)
+    {
+        for (int j = 0; j < r.count; ++j)
+        {
+            const FoundTemple &t = r.temples[j];
+            resultFile.append({r.seed, t.x, t.z, t.swampSpawnBlocks, r.score, (uint8_t)t.type, (uint8_t)format, (uint8_t)j, (uint8_t)r.count, 0});
+        }
+
+        if (!log)
+            return;
+
+        const FoundTemple &t = r.temples[0];
+        switch (format)
+        {
+        case RF_SEED:
+            fprintf(log, "%" PRId64 ",\t%s,\t%d,\t%d,\t%d\n", r.seed, templeTypeName(t.type), t.x, t.z, r.score);
+            break;
+        case RF_QUAD:
+            fprintf(log, "%" PRId64 ", %d\n", r.seed, r.score);
+            for (int j = 0; j < r.count; ++j)
+                fprintf(log, "\t%s - %d: %d, %d\n", templeTypeName(r.temples[j].type), r.temples[j].swampSpawnBlocks,
+                        r.temples[j].x, r.temples[j].z);
+            break;
+        case RF_LOCATION:
+            fprintf(log, "%s,\t%d,\t%d,\t%d\n", templeTypeName(t.type), t.x, t.z, r.score);
+            break;
+        case RF_CLUSTER:
+            fprintf(log, "%d, %d\n", r.count, r.score);
+            for (int j = 0; j < r.count; ++j)
+                fprintf(log, "\t%s - %d: %d, %d\n", templeTypeName(r.temples[j].type), r.temples[j].swampSpawnBlocks,
+                        r.temples[j].x, r.temples[j].z);
+            break;
+        }
+    }
+
+    void printTop() const
+    {
+        auto printList = [&](const char *name, const std::vector<FoundResult> &list)
+        {
+            for (size_t i = 0; i < std::min<size_t>(list.size(), topK); ++i)
+            {
+                const FoundResult &r = list[i];
+                if (format == RF_LOCATION)
+                    printf("[TOP] %s #%zu swamp-spawn-blocks=%d %s at (%d,%d)\n", name, i + 1, r.score,
+                           templeTypeName(r.temples[0].type), r.temples[0].x, r.temples[0].z);
+                else if (format == RF_CLUSTER)
+                    printf("[TOP] %s #%zu swamp-spawn-blocks=%d %d temples from (%d,%d)\n", name, i + 1, r.score,
+                           r.count, r.temples[0].x, r.temples[0].z);
+                else
+                    printf("[TOP] %s #%zu seed=%" PRId64 " swamp-spawn-blocks=%d\n", name, i + 1, r.seed, r.score);
+            }
+            if (list.size() > topK)
+                printf("[TOP] %s and %zu more tied at swamp-spawn-blocks=%d\n", name, list.size() - topK, list.back().score);
+        };
+
+        if (resumed)
+            printf("[TOP] resumed run: the lists hold this launch's results and the best of the earlier ones\n");
+        printList("overall", overall);
+        for (const auto &type : perType)
+            printList(templeTypeName(type.first), type.second);
+        if (droppedTies)
+            printf("[TOP] %" PRIu64 " more ties were not kept\n", droppedTies);
+        fflush(stdout);
+    }
+
+    // CSV of the bins with the number of scores at or above each bin, which is what tells how rare a score is
+    void writeHistogram() const
+    {
+        if (!binWidth)
+            return;
+
+        uint64_t bins[HISTOGRAM_BINS] = {};
+        int last = -1;
+        for (const Ring &ring : rings)
+            for (int b = 0; b < HISTOGRAM_BINS; ++b)
+                if ((bins[b] += ring.histogram[b].load(std::memory_order_relaxed)) && b > last)
+                    last = b;
+        if (last < 0)
+            return;
+
+        FILE *fp = fopen(histogramPath.c_str(), "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Failed to open histogram file '%s'\n", histogramPath.c_str());
+            return;
+        }
+
+        uint64_t total = 0;
+        for (int b = 0; b <= last; ++b)
+            total += bins[b];
+
+        auto binTo = [&](int b)
+        { return b == HISTOGRAM_BINS - 1 ? INT32_MAX : (b + 1) * (int)binWidth - 1; };
+
+        fprintf(fp, "score_from,score_to,count,at_least\n");
+        uint64_t atLeast = total;
+        for (int b = 0; b <= last; ++b)
+        {
+            fprintf(fp, "%d,%d,%" PRIu64 ",%" PRIu64 "\n", b * (int)binWidth, binTo(b), bins[b], atLeast);
+            atLeast -= bins[b];
+        }
+        fclose(fp);
+
+        printf("[HISTOGRAM] scored=%" PRIu64 " exact-from=%d top-bin=%d..%d count=%" PRIu64 " -> %s\n", total, threshold(),
+               last * (int)binWidth, binTo(last), bins[last], histogramPath.c_str());
+    }
+
+    const ResultFormat format;
+    const unsigned int topK;
+    const unsigned int binWidth;
+    const int templeTypes;
+    const std::string histogramPath;
+    FinderMetrics *metrics;
+
+    std::vector<Ring> rings;
+    std::atomic<int> minScore{MIN_SWAMP_SPAWN_BLOCKS};
+    std::atomic<int> typeMinScore[4] = {MIN_SWAMP_SPAWN_BLOCKS, MIN_SWAMP_SPAWN_BLOCKS, MIN_SWAMP_SPAWN_BLOCKS, MIN_SWAMP_SPAWN_BLOCKS};
+
+    // Writer state, also read by bestResult()
+    std::mutex stateMutex;
+    bool hasBest = false;
+    bool resumed = false;
+    FoundResult best;
+    std::vector<FoundResult> overall;
+    std::map<int, std::vector<FoundResult>> perType;
+    uint64_t droppedTies = 0;
+    FILE *log = nullptr;
+    ResultFileWriter resultFile;
+
+    std::mutex wakeMutex; // protects stopping
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread writer;
+};
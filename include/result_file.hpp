@@ -0,0 +1,330 @@
+#pragma once
+
+#include <mapped_file.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Log line layout and [NEW BEST] message of each finder, also the finder id
+// of the binary result records
+enum ResultFormat
+{
+    RF_SEED,
+    RF_QUAD,
+    RF_LOCATION,
+    RF_CLUSTER // location finder --clusters, groups sharing one AFK sphere
+};
+
+inline const char *resultFinderName(int finder)
+{
+    return finder == RF_SEED ? "seed" : finder == RF_QUAD ? "quad"
+                                    : finder == RF_LOCATION ? "loc"
+                                    : finder == RF_CLUSTER  ? "cluster"
+                                                            : "?";
+}
+
+// Binary result file: one ResultFileHeader, written when the file is created,
+// followed by fixed ResultRecords appended by every run. Fields are stored in
+// host byte order, i.e. little-endian on every platform the finders run on.
+inline constexpr char RESULT_FILE_MAGIC[8] = {'W', 'T', 'F', 'R', 'E', 'S', 'U', 'L'};
+inline constexpr uint32_t RESULT_FILE_VERSION = 1;
+
+// Parameters of the run that created the file
+struct ResultFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t finder; // ResultFormat
+    int32_t mcVersion;
+    uint64_t startSeed; // world seed of the location finder
+    uint32_t shardIndex, shardCount;
+    uint32_t templeTypes; // TempleType mask of --types
+    uint32_t topK;
+    int32_t queryY;
+    uint32_t reserved;
+    int64_t createdUnix;
+};
+
+// One temple of a result. A quad is stored as 4 records with the same seed
+// and total, index 0..3.
+struct ResultRecord
+{
+    int64_t seed;
+    int32_t x, z;
+    int32_t score; // swamp spawn blocks of this temple
+    int32_t total; // of the whole result, the sum over its temples (in reach of the AFK point for clusters)
+    uint8_t type;  // as isViableTemplePos
+    uint8_t finder;
+    uint8_t index;
+    uint8_t count;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ResultFileHeader) == 64, "result file header layout changed");
+static_assert(sizeof(ResultRecord) == 32, "result record layout changed");
+
+// Checks that a header was written by a compatible version
+inline bool validResultHeader(const ResultFileHeader &h)
+{
+    return memcmp(h.magic, RESULT_FILE_MAGIC, sizeof(h.magic)) == 0 && h.version == RESULT_FILE_VERSION &&
+           h.recordSize == sizeof(ResultRecord);
+}
+
+// Appends records to a result file in batches. A new file gets the header
+// first; an existing one must be from the same finder. A record torn by a
+// crash at the end of an existing file is cut off before appending.
+class ResultFileWriter
+{
+public:
+    static constexpr size_t BUFFER_RECORDS = 4096;
+
+    ResultFileWriter() = default;
+
+    ~ResultFileWriter()
+    {
+        close();
+    }
+
+    ResultFileWriter(const ResultFileWriter &) = delete;
+    ResultFileWriter &operator=(const ResultFileWriter &) = delete;
+
+    // Opens path for appending, truncate starts a new file. Returns false
+    // (after printing why) when the file cannot be used.
+    bool open(const std::string &filePath, const ResultFileHeader &header, bool truncate = false)
+    {
+        close();
+        std::error_code ec;
+        uint64_t size = truncate ? 0 : std::filesystem::exists(filePath, ec) ? std::filesystem::file_size(filePath, ec)
+                                                                              : 0;
+        if (ec || size < sizeof(ResultFileHeader))
+            size = 0; // new, or torn while writing the header
+
+        if (size > 0)
+        {
+            ResultFileHeader existing;
+            FILE *in = fopen(filePath.c_str(), "rb");
+            bool ok = in && fread(&existing, sizeof(existing), 1, in) == 1;
+            if (in)
+                fclose(in);
+            if (!ok || !validResultHeader(existing) || existing.finder != header.finder)
+            {
+                fprintf(stderr, "Result file '%s' is not a %s result file of this version\n", filePath.c_str(), resultFinderName(header.finder));
+                return false;
+            }
+
+            uint64_t whole = sizeof(ResultFileHeader) + (size - sizeof(ResultFileHeader)) / sizeof(ResultRecord) * sizeof(ResultRecord);
+            if (whole != size)
+            {
+                std::filesystem::resize_file(filePath, whole, ec);
+                if (ec)
+                {
+                    fprintf(stderr, "Failed to cut the torn record off '%s'\n", filePath.c_str());
+                    return false;
+                }
+            }
+        }
+
+        fp = fopen(filePath.c_str(), size > 0 ? "ab" : "wb");
+        if (!fp)
+        {
+            fprintf(stderr, "Failed to open result file '%s'\n", filePath.c_str());
+            return false;
+        }
+        if (size == 0 && (fwrite(&header, sizeof(header), 1, fp) != 1 || fflush(fp) != 0))
+        {
+            fprintf(stderr, "Failed to write result file '%s'\n", filePath.c_str());
+            close();
+            return false;
+        }
+        path = filePath;
+        buffer.reserve(BUFFER_RECORDS);
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return fp != nullptr;
+    }
+
+    void append(const ResultRecord &r)
+    {
+        if (!fp)
+            return;
+        buffer.push_back(r);
+        if (buffer.size() >= BUFFER_RECORDS)
+            flush();
+    }
+
+    // Writes the buffered records in one go
+    bool flush()
+    {
+        if (!fp || buffer.empty())
+            return true;
+        bool ok = fwrite(buffer.data(), sizeof(ResultRecord), buffer.size(), fp) == buffer.size() && fflush(fp) == 0;
+        if (!ok)
+            fprintf(stderr, "Failed to write result file '%s'\n", path.c_str());
+        buffer.clear();
+        return ok;
+    }
+
+    void close()
+    {
+        if (!fp)
+            return;
+        flush();
+        fclose(fp);
+        fp = nullptr;
+    }
+
+private:
+    FILE *fp = nullptr;
+    std::string path;
+    std::vector<ResultRecord> buffer;
+};
+
+// Result file mapped read-only, see MappedFile
+class MappedResultFile
+{
+public:
+    // Maps path, returns false (after printing why) when it is not a valid result file
+    bool open(const std::string &path)
+    {
+        if (!file.open(path, sizeof(ResultFileHeader)) || !validResultHeader(header()))
+        {
+            fprintf(stderr, "'%s' is not a result file of this version\n", path.c_str());
+            file.close();
+            return false;
+        }
+        return true;
+    }
+
+    const ResultFileHeader &header() const
+    {
+        return *(const ResultFileHeader *)file.data();
+    }
+
+    // Whole records only, a torn record at the end is ignored
+    size_t size() const
+    {
+        return file.data() ? (file.size() - sizeof(ResultFileHeader)) / sizeof(ResultRecord) : 0;
+    }
+
+    const ResultRecord *records() const
+    {
+        return (const ResultRecord *)(file.data() + sizeof(ResultFileHeader));
+    }
+
+private:
+    MappedFile file;
+};
+
+// Order of selectResults(). Both keep the temples of a result together and
+// put identical records next to each other.
+enum ResultOrder
+{
+    RO_SCORE, // best total first
+    RO_SEED   // ascending seed
+};
+
+struct ResultQuery
+{
+    ResultOrder order = RO_SCORE;
+    bool dedup = true;
+    size_t topK = 0; // results (not records) with the best totals, 0 for all
+};
+
+// Sorts, deduplicates and cuts the records of the mapped files. A result is
+// the run of consecutive records of a file from its index 0 record on; it is
+// ordered and compared as a whole, so results with the same seed and total
+// never interleave. Only the spans and the returned pointers into the
+// mappings are allocated.
+inline std::vector<const ResultRecord *> selectResults(const std::vector<MappedResultFile> &files, const ResultQuery &q)
+{
+    struct Span
+    {
+        const ResultRecord *first;
+        size_t size;
+    };
+    std::vector<Span> spans;
+    size_t total = 0;
+    for (const MappedResultFile &f : files)
+    {
+        const ResultRecord *r = f.records();
+        for (size_t i = 0; i < f.size(); ++i)
+        {
+            const bool next = i > 0 && r[i].index == r[i - 1].index + 1 && r[i].seed == r[i - 1].seed &&
+                              r[i].total == r[i - 1].total && r[i].finder == r[i - 1].finder;
+            if (next)
+                ++spans.back().size;
+            else
+                spans.push_back({r + i, 1});
+        }
+        total += f.size();
+    }
+
+    // Seed and total lead, the temples then tell results with the same ones apart
+    auto tail = [](const ResultRecord &r)
+    { return std::make_tuple(r.finder, r.count, r.index, r.type, r.x, r.z, r.score); };
+    auto tailLess = [&](const Span &a, const Span &b)
+    {
+        return std::lexicographical_compare(a.first, a.first + a.size, b.first, b.first + b.size,
+                                            [&](const ResultRecord &x, const ResultRecord &y)
+                                            { return tail(x) < tail(y); });
+    };
+    auto byScore = [&](const Span &a, const Span &b)
+    {
+        if (a.first->total != b.first->total)
+            return a.first->total > b.first->total;
+        if (a.first->seed != b.first->seed)
+            return a.first->seed < b.first->seed;
+        return tailLess(a, b);
+    };
+    auto bySeed = [&](const Span &a, const Span &b)
+    {
+        if (a.first->seed != b.first->seed)
+            return a.first->seed < b.first->seed;
+        if (a.first->total != b.first->total)
+            return a.first->total > b.first->total;
+        return tailLess(a, b);
+    };
+    auto same = [&](const Span &a, const Span &b)
+    {
+        return a.first->seed == b.first->seed && a.first->total == b.first->total &&
+               std::equal(a.first, a.first + a.size, b.first, b.first + b.size,
+                          [&](const ResultRecord &x, const ResultRecord &y)
+                          { return tail(x) == tail(y); });
+    };
+
+    if (q.order == RO_SCORE || q.topK)
+        std::sort(spans.begin(), spans.end(), byScore);
+    else
+        std::sort(spans.begin(), spans.end(), bySeed);
+    if (q.dedup)
+        spans.erase(std::unique(spans.begin(), spans.end(), same), spans.end());
+
+    if (q.topK)
+    {
+        // A result starts at its first temple
+        size_t results = 0, end = 0;
+        for (; end < spans.size(); ++end)
+            if (spans[end].first->index == 0 && ++results > q.topK)
+                break;
+        spans.resize(end);
+        if (q.order == RO_SEED)
+            std::sort(spans.begin(), spans.end(), bySeed);
+    }
+
+    std::vector<const ResultRecord *> out;
+    out.reserve(total);
+    for (const Span &span : spans)
+        for (size_t i = 0; i < span.size; ++i)
+            out.push_back(span.first + i);
+    return out;
+}
@@ -0,0 +1,850 @@
+#pragma once
+
+#include <cpu_features.hpp>
+#include <finder_utils.hpp>
+#include <structure_batch.hpp>
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+// Coarse stages of the viability cascade for several world seeds at once.
+// The quad finder keeps the four temple positions of a 48-bit base while the
+// upper 16 bits of the seed change, so the same cells are generated for every
+// seed. The AVX2 path keeps one seed per 64-bit lane and runs the MC_1_5 layer
+// graph of cubiomes (continent, zoom, land, snow, mushroom, biome, hills, shore
+// and swamp river) on the influence area of each temple center at 1:16, which
+// gives bit-identical cells to genArea(). Seeds that pass all the stages before
+// SEED_LANE_RESUME_STAGE go on to TempleEvaluator::bound() from that stage.
+
+inline constexpr int SEED_LANE_REGS = 2;                   // 256-bit registers per lane vector
+inline constexpr int SEED_LANES = 4 * SEED_LANE_REGS;      // seeds filtered at once
+inline constexpr int SEED_LANE_MAX_TEMPLES = 4;            // temple positions per seed
+inline constexpr int SEED_LANE_RESUME_STAGE = CS_4;        // first stage left to the evaluator
+inline constexpr int SEED_LANE_LAST_STAGE = CS_16;         // stage generated for each temple
+inline constexpr int SEED_LANE_TABLE_SIZE = 256;           // biome ids looked up by the lanes
+
+#if SEEDFINDER_X86
+
+// One 64-bit value per seed
+struct alignas(32) LaneVec
+{
+    __m256i v[SEED_LANE_REGS];
+};
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneSet(int64_t x)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_set1_epi64x(x);
+    return r;
+}
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneAdd(const LaneVec &a, const LaneVec &b)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_add_epi64(a.v[k], b.v[k]);
+    return r;
+}
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneAnd(const LaneVec &a, const LaneVec &b)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_and_si256(a.v[k], b.v[k]);
+    return r;
+}
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneOr(const LaneVec &a, const LaneVec &b)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_or_si256(a.v[k], b.v[k]);
+    return r;
+}
+
+// ~a & b
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneAndNot(const LaneVec &a, const LaneVec &b)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_andnot_si256(a.v[k], b.v[k]);
+    return r;
+}
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneEq(const LaneVec &a, const LaneVec &b)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_cmpeq_epi64(a.v[k], b.v[k]);
+    return r;
+}
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneEq(const LaneVec &a, int64_t b)
+{
+    return laneEq(a, laneSet(b));
+}
+
+// mask ? a : b, with mask lanes all ones or all zeros
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneSelect(const LaneVec &mask, const LaneVec &a, const LaneVec &b)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_blendv_epi8(b.v[k], a.v[k], mask.v[k]);
+    return r;
+}
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneSelect(const LaneVec &mask, int64_t a, const LaneVec &b)
+{
+    return laneSelect(mask, laneSet(a), b);
+}
+
+// Bit k set if lane k of the mask is set
+SEEDFINDER_TARGET("avx2")
+inline uint32_t laneBits(const LaneVec &mask)
+{
+    uint32_t bits = 0;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        bits |= (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(mask.v[k])) << (4 * k);
+    return bits;
+}
+
+// table[id] for each lane, ids must be below SEED_LANE_TABLE_SIZE
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneLookup(const int64_t *table, const LaneVec &id)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_i64gather_epi64((const long long *)table, id.v[k], 8);
+    return r;
+}
+
+// mcStepSeed() with a constant salt
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneStepSeed(const LaneVec &s, uint64_t salt)
+{
+    const __m256i c = _mm256_set1_epi64x((int64_t)1442695040888963407ULL);
+    const __m256i sv = _mm256_set1_epi64x((int64_t)salt);
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+    {
+        __m256i a = s.v[k];
+        __m256i b = _mm256_add_epi64(mulLo64Avx2(a, 6364136223846793005ULL), c);
+
+        // a * b, both varying per lane
+        __m256i lo = _mm256_mul_epu32(a, b);
+        __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                         _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+        r.v[k] = _mm256_add_epi64(_mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32)), sv);
+    }
+    return r;
+}
+
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneChunkSeed(const LaneVec &ss, int x, int z)
+{
+    LaneVec cs = laneAdd(ss, laneSet(x));
+    cs = laneStepSeed(cs, (uint64_t)(int64_t)z);
+    cs = laneStepSeed(cs, (uint64_t)(int64_t)x);
+    return laneStepSeed(cs, (uint64_t)(int64_t)z);
+}
+
+// (int64_t)cs >> 24 as a double, exact since it has 40 bits
+SEEDFINDER_TARGET("avx2")
+inline __m256d laneFirstBits(__m256i cs)
+{
+    const __m256i sign = _mm256_set1_epi64x(1LL << 39);
+    const __m256i magic = _mm256_set1_epi64x(0x4338000000000000LL); // bits of 2^52 + 2^51
+    __m256i v = _mm256_sub_epi64(_mm256_xor_si256(_mm256_srli_epi64(cs, 24), sign), sign);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(v, magic)), _mm256_set1_pd(6755399441055744.0));
+}
+
+// Remainder of laneFirstBits() by Mod rounded towards minus infinity. The
+// quotient from the reciprocal is at most one off for 40-bit values, which
+// the two corrections fix.
+template <int Mod>
+SEEDFINDER_TARGET("avx2")
+inline __m256d laneFirstMod(__m256i cs)
+{
+    const __m256d m = _mm256_set1_pd(Mod);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d d = laneFirstBits(cs);
+    __m256d q = _mm256_floor_pd(_mm256_mul_pd(d, _mm256_set1_pd(1.0 / Mod)));
+    __m256d r = _mm256_sub_pd(d, _mm256_mul_pd(q, m));
+    r = _mm256_add_pd(r, _mm256_and_pd(_mm256_cmp_pd(r, zero, _CMP_LT_OQ), m));
+    return _mm256_sub_pd(r, _mm256_and_pd(_mm256_cmp_pd(r, m, _CMP_GE_OQ), m));
+}
+
+// mcFirstIsZero(cs, Mod) as a lane mask, the remainder is zero either way it is rounded
+template <int Mod>
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneFirstIsZero(const LaneVec &cs)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+    {
+        if constexpr ((Mod & (Mod - 1)) == 0)
+            r.v[k] = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_srli_epi64(cs.v[k], 24), _mm256_set1_epi64x(Mod - 1)),
+                                        _mm256_setzero_si256());
+        else
+            r.v[k] = _mm256_castpd_si256(_mm256_cmp_pd(laneFirstMod<Mod>(cs.v[k]), _mm256_setzero_pd(), _CMP_EQ_OQ));
+    }
+    return r;
+}
+
+// mcFirstInt(cs, Mod), which moves negative remainders up by Mod
+template <int Mod>
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneFirstInt(const LaneVec &cs)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+    {
+        if constexpr ((Mod & (Mod - 1)) == 0)
+        {
+            r.v[k] = _mm256_and_si256(_mm256_srli_epi64(cs.v[k], 24), _mm256_set1_epi64x(Mod - 1));
+        }
+        else
+        {
+            const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+            __m256d rem = laneFirstMod<Mod>(cs.v[k]);
+            r.v[k] = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(rem, magic)), _mm256_set1_epi64x(0x4338000000000000LL));
+        }
+    }
+    return r;
+}
+
+// The zoom layers step the chunk seed in 32 bits: cs * (cs * 1284865837 + 4150755663),
+// valid in the low 32 bits of each lane
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneZoomStep(const LaneVec &cs, const LaneVec &salt)
+{
+    const __m256i a = _mm256_set1_epi64x(1284865837);
+    const __m256i b = _mm256_set1_epi64x(4150755663LL);
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+    {
+        __m256i t = _mm256_add_epi64(_mm256_mul_epu32(cs.v[k], a), b);
+        r.v[k] = _mm256_add_epi64(_mm256_mul_epu32(cs.v[k], t), salt.v[k]);
+    }
+    return r;
+}
+
+// (cs >> 24) & Mask of the 32-bit zoom seed
+SEEDFINDER_TARGET("avx2")
+inline LaneVec laneZoomBits(const LaneVec &cs, int64_t mask)
+{
+    LaneVec r;
+    for (int k = 0; k < SEED_LANE_REGS; ++k)
+        r.v[k] = _mm256_and_si256(_mm256_srli_epi64(cs.v[k], 24), _mm256_set1_epi64x(mask));
+    return r;
+}
+
+#endif
+
+// Filters the seeds of a batch down to those whose temples can all be viable.
+// One filter per thread: it owns a generator for the layer graph and the
+// scalar path, and lane buffers sized for the current temple positions.
+// templeTypes selects the viable types through the biome table.
+class SeedLaneFilter
+{
+public:
+    explicit SeedLaneFilter(int templeTypes = SELECTED_TEMPLE_TYPES)
+    {
+        setupGenerator(&g, MC_VERSION, 0);
+        entry = getLayerForScale(&g, BIOME_QUERY_SCALE);
+        for (int s = 0; s < SEED_LANE_RESUME_STAGE; ++s)
+            stages[s] = cascadeStageLayer(&g, s);
+
+        for (int id = 0; id < SEED_LANE_TABLE_SIZE; ++id)
+        {
+            int t = templeTypeForBiome(id, templeTypes);
+            templeTable[id] = t ? 1 << t : 0;
+            categoryTable[id] = getCategory(MC_VERSION, id);
+            hillsTable[id] = hillsVariant(id);
+        }
+
+#if SEEDFINDER_X86
+        lanes = cpuHasAvx2() && supportsLanes();
+#endif
+    }
+
+    // True if the batches run in SIMD lanes instead of one seed at a time
+    bool vectorized() const
+    {
+        return lanes;
+    }
+
+    // Counts candidates and rejections into m, null to disable
+    void setMetrics(ThreadMetrics *m)
+    {
+        metrics = m;
+    }
+
+    // Temple positions (block coordinates of the origins) tested by filter()
+    void setPositions(const int *x, const int *z, int count)
+    {
+        temples = std::min(count, SEED_LANE_MAX_TEMPLES);
+        size_t scalarLen = 0;
+        for (int j = 0; j < temples; ++j)
+        {
+            for (int s = 0; s < SEED_LANE_RESUME_STAGE; ++s)
+            {
+                int x0 = x[j] + HALF_CHUNK, x1 = x0, z0 = z[j] + HALF_CHUNK, z1 = z0;
+                mapIntervalToLayer(entry, stages[s], x0, x1);
+                mapIntervalToLayer(entry, stages[s], z0, z1);
+                areas[j][s] = {x0, z0, x1 - x0 + 1, z1 - z0 + 1};
+                scalarLen = std::max(scalarLen, getMinLayerCacheSize(stages[s], areas[j][s].w, areas[j][s].h));
+            }
+        }
+
+        // The coarser stages of temples close together share one area each,
+        // which covers the stage tests and what the next stage reads from it.
+        // Only worth it if it is not larger than the areas read per temple.
+        size_t laneLen = scalarLen;
+        int sharedCellCount = 0, separateCellCount = 0;
+        for (int s = SEED_LANE_LAST_STAGE - 1; s >= 0; --s)
+        {
+            Area u = s + 1 < SEED_LANE_LAST_STAGE ? readArea(stages[s + 1], shared[s + 1], stages[s]) : areas[0][s];
+            for (int j = 0; j < temples; ++j)
+            {
+                Area own = readArea(stages[SEED_LANE_LAST_STAGE], areas[j][SEED_LANE_LAST_STAGE], stages[s]);
+                separateCellCount += own.w * own.h;
+                if (s + 1 == SEED_LANE_LAST_STAGE)
+                    u = unionArea(u, own);
+                u = unionArea(u, areas[j][s]);
+            }
+            shared[s] = u;
+            sharedCellCount += u.w * u.h;
+            laneLen = std::max(laneLen, getMinLayerCacheSize(stages[s], u.w, u.h));
+        }
+        sharedStages = sharedCellCount <= separateCellCount ? SEED_LANE_LAST_STAGE : 0;
+#if SEEDFINDER_X86
+        for (int s = 0; s < sharedStages; ++s)
+            sharedCells[s].resize((size_t)shared[s].w * shared[s].h);
+#endif
+
+        if (cache.size() < scalarLen)
+            cache.resize(scalarLen);
+#if SEEDFINDER_X86
+        if (laneCache.size() < laneLen)
+            laneCache.resize(laneLen);
+#else
+        (void)laneLen;
+#endif
+    }
+
+    // Runs the stages before SEED_LANE_RESUME_STAGE for all temples of each of
+    // the SEED_LANES seeds. Bit k of the result is set if seeds[k] passed, in
+    // which case candidateTypes(k, j) holds the temple types temple j can
+    // still become (bit t for type t) at the last stage.
+    uint32_t filter(const uint64_t *seeds)
+    {
+        ThreadMetrics::StageTimer timer(metrics, STAGE_CASCADE);
+#if SEEDFINDER_X86
+        if (lanes)
+            return filterLanes(seeds);
+#endif
+        return filterScalar(seeds);
+    }
+
+    int candidateTypes(int lane, int temple) const
+    {
+        return types[lane][temple];
+    }
+
+    const CascadeStats &cascadeStats() const
+    {
+        return stats;
+    }
+
+private:
+    struct Area
+    {
+        int x, z, w, h;
+    };
+
+    // mapHills() before 1.7 without the random hills of deep oceans and the
+    // badlands cases, none of which the MC_1_5 chain generates
+    static int hillsVariant(int id)
+    {
+        switch (id)
+        {
+        case desert:
+            return desert_hills;
+        case forest:
+            return wooded_hills;
+        case birch_forest:
+            return birch_forest_hills;
+        case dark_forest:
+            return plains;
+        case taiga:
+            return taiga_hills;
+        case giant_tree_taiga:
+            return giant_tree_taiga_hills;
+        case snowy_taiga:
+            return snowy_taiga_hills;
+        case plains:
+            return forest;
+        case snowy_tundra:
+            return snowy_mountains;
+        case jungle:
+            return jungle_hills;
+        case bamboo_jungle:
+            return bamboo_jungle_hills;
+        case savanna:
+            return savanna_plateau;
+        default:
+            return id;
+        }
+    }
+
+    // Records a stage test of one temple for the seeds still alive, where
+    // passMask has bit k set if seed k has a temple biome in the area
+    void record(int s, uint32_t passMask)
+    {
+        uint32_t rejected = live & ~passMask;
+        stats.tested[s] += std::bitset<32>(live).count();
+        stats.rejected[s] += std::bitset<32>(rejected).count();
+        if (metrics)
+        {
+            if (s == CS_256)
+                metrics->add(CTR_CANDIDATES, std::bitset<32>(live).count());
+            metrics->add(CTR_REJECTED_BIOME, std::bitset<32>(rejected).count());
+        }
+        live &= passMask;
+    }
+
+    static Area unionArea(const Area &a, const Area &b)
+    {
+        int x0 = std::min(a.x, b.x), z0 = std::min(a.z, b.z);
+        int x1 = std::max(a.x + a.w, b.x + b.w), z1 = std::max(a.z + a.h, b.z + b.h);
+        return {x0, z0, x1 - x0, z1 - z0};
+    }
+
+    // Area of layer 'to' that generating area a of layer 'from' reads,
+    // following the parent areas of the lane kernels
+    static Area readArea(const Layer *from, Area a, const Layer *to)
+    {
+        for (const Layer *l = from; l && l != to; l = l->p)
+        {
+            if (l->getMap == mapZoom || l->getMap == mapZoomFuzzy)
+            {
+                int pX = a.x >> 1, pZ = a.z >> 1;
+                a = {pX, pZ, ((a.x + a.w) >> 1) - pX + 1, ((a.z + a.h) >> 1) - pZ + 1};
+            }
+            else if (l->getMap != mapBiome && l->getMap != mapSwampRiver)
+                a = {a.x - 1, a.z - 1, a.w + 2, a.h + 2};
+        }
+        return a;
+    }
+
+    uint32_t filterScalar(const uint64_t *seeds)
+    {
+        uint32_t result = 0;
+        for (int k = 0; k < SEED_LANES; ++k)
+        {
+            applySeed(&g, DIM_OVERWORLD, (int64_t)seeds[k]);
+            live = 1;
+            for (int j = 0; j < temples && live; ++j)
+            {
+                for (int s = 0; s < SEED_LANE_RESUME_STAGE && live; ++s)
+                {
+                    const Area &a = areas[j][s];
+                    int found = 0;
+                    if (genArea(stages[s], cache.data(), a.x, a.z, a.w, a.h) == 0)
+                        for (int i = 0; i < a.w * a.h; ++i)
+                            found |= templeTable[cache[i]];
+                    record(s, found ? 1 : 0);
+                    types[k][j] = found;
+                }
+            }
+            result |= live << k;
+        }
+        return result;
+    }
+
+#if SEEDFINDER_X86
+    // All layers the lanes walk through must have a lane kernel below
+    bool supportsLanes() const
+    {
+        if (MC_VERSION <= MC_1_2 || MC_VERSION > MC_1_6)
+            return false;
+        int onChain = 0;
+        for (const Layer *l = stages[SEED_LANE_RESUME_STAGE - 1]; l; l = l->p)
+        {
+            for (int s = 0; s < SEED_LANE_RESUME_STAGE; ++s)
+                onChain += l == stages[s];
+
+            mapfunc_t *map = l->getMap;
+            if (map != mapContinent && map != mapZoomFuzzy && map != mapZoom && map != mapLand16 &&
+                map != mapSnow16 && map != mapMushroom && map != mapBiome && map != mapHills &&
+                map != mapShore && map != mapSwampRiver)
+                return false;
+            if (l->layerSalt == LAYER_INIT_SHA)
+                return false;
+        }
+        return onChain == SEED_LANE_RESUME_STAGE;
+    }
+
+    SEEDFINDER_TARGET("avx2")
+    uint32_t filterLanes(const uint64_t *seeds)
+    {
+        // Start seeds of the layers for this batch, as setLayerSeed()
+        LaneVec ws;
+        for (int k = 0; k < SEED_LANE_REGS; ++k)
+            ws.v[k] = _mm256_loadu_si256((const __m256i *)(seeds + 4 * k));
+        for (const Layer *l = stages[SEED_LANE_RESUME_STAGE - 1]; l; l = l->p)
+        {
+            int li = (int)(l - g.ls.layers);
+            if (l->layerSalt == 0)
+            {
+                startSalt[li] = startSeed[li] = laneSet(0);
+                continue;
+            }
+            LaneVec st = laneStepSeed(ws, l->layerSalt);
+            st = laneStepSeed(st, l->layerSalt);
+            startSalt[li] = laneStepSeed(st, l->layerSalt);
+            startSeed[li] = laneStepSeed(startSalt[li], 0);
+        }
+
+        // The coarser stages are generated once for the area around all
+        // temples, each one is read by the next and by the stage tests
+        for (sharedReady = 0; sharedReady < sharedStages; ++sharedReady)
+        {
+            const Area &a = shared[sharedReady];
+            laneArea(stages[sharedReady], laneCache.data(), a.x, a.z, a.w, a.h);
+            std::copy(laneCache.begin(), laneCache.begin() + a.w * a.h, sharedCells[sharedReady].begin());
+        }
+
+        live = (1u << SEED_LANES) - 1;
+        for (int j = 0; j < temples && live; ++j)
+        {
+            for (int s = 0; s <= SEED_LANE_LAST_STAGE && live; ++s)
+            {
+                if (s < sharedStages)
+                {
+                    testStage(s, j, sharedCells[s].data(), shared[s]);
+                    continue;
+                }
+                const Area &a = areas[j][s];
+                laneArea(stages[s], laneCache.data(), a.x, a.z, a.w, a.h);
+                testStage(s, j, laneCache.data(), a);
+            }
+        }
+        return live;
+    }
+
+    // Tests stage s of temple j on the cells of area 'at'
+    SEEDFINDER_TARGET("avx2")
+    void testStage(int s, int j, const LaneVec *cells, const Area &at)
+    {
+        const Area &a = areas[j][s];
+        LaneVec found = laneSet(0);
+        for (int iz = 0; iz < a.h; ++iz)
+            for (int ix = 0; ix < a.w; ++ix)
+                found = laneOr(found, laneLookup(templeTable, cells[(a.z - at.z + iz) * at.w + (a.x - at.x + ix)]));
+
+        record(s, ~laneBits(laneEq(found, 0)) & ((1u << SEED_LANES) - 1));
+        if (s == SEED_LANE_LAST_STAGE)
+        {
+            alignas(32) int64_t t[SEED_LANES];
+            for (int k = 0; k < SEED_LANE_REGS; ++k)
+                _mm256_store_si256((__m256i *)(t + 4 * k), found.v[k]);
+            for (int k = 0; k < SEED_LANES; ++k)
+                types[k][j] = (int)t[k];
+        }
+    }
+
+    // genArea() of layer l for all lanes, copied from the shared areas
+    // where they are ready
+    SEEDFINDER_TARGET("avx2")
+    void laneArea(const Layer *l, LaneVec *out, int x, int z, int w, int h)
+    {
+        for (int s = 0; s < sharedReady; ++s)
+        {
+            const Area &a = shared[s];
+            if (l == stages[s] && x >= a.x && z >= a.z && x + w <= a.x + a.w && z + h <= a.z + a.h)
+            {
+                for (int j = 0; j < h; ++j)
+                    for (int i = 0; i < w; ++i)
+                        out[j * w + i] = sharedCells[s][(z - a.z + j) * a.w + (x - a.x + i)];
+                return;
+            }
+        }
+
+        const int li = (int)(l - g.ls.layers);
+        mapfunc_t *map = l->getMap;
+        if (map == mapContinent)
+            laneContinent(li, out, x, z, w, h);
+        else if (map == mapZoom || map == mapZoomFuzzy)
+            laneZoom(l, li, out, x, z, w, h, map == mapZoomFuzzy);
+        else if (map == mapBiome || map == mapSwampRiver)
+            laneSameArea(l, li, out, x, z, w, h);
+        else
+            laneNeighbours(l, li, out, x, z, w, h);
+    }
+
+    SEEDFINDER_TARGET("avx2")
+    void laneContinent(int li, LaneVec *out, int x, int z, int w, int h)
+    {
+        const LaneVec one = laneSet(1);
+        for (int j = 0; j < h; ++j)
+            for (int i = 0; i < w; ++i)
+                out[j * w + i] = laneAnd(laneFirstIsZero<10>(laneChunkSeed(startSeed[li], i + x, j + z)), one);
+
+        if (x > -w && x <= 0 && z > -h && z <= 0)
+            out[-z * w - x] = one;
+    }
+
+    // mapZoom() and mapZoomFuzzy()
+    SEEDFINDER_TARGET("avx2")
+    void laneZoom(const Layer *l, int li, LaneVec *out, int x, int z, int w, int h, bool fuzzy)
+    {
+        const int pX = x >> 1, pZ = z >> 1;
+        const int pW = ((x + w) >> 1) - pX + 1, pH = ((z + h) >> 1) - pZ + 1;
+        laneArea(l->p, out, pX, pZ, pW, pH);
+
+        const int newW = 2 * pW;
+        LaneVec *buf = out + pW * pH;
+        const LaneVec &ss = startSeed[li], &st = startSalt[li];
+
+        for (int j = 0; j < pH; ++j)
+        {
+            for (int i = 0; i < pW; ++i)
+            {
+                // Past the last parent row and column only the even cells are
+                // used, which do not read the missing neighbours
+                const int i1 = std::min(i + 1, pW - 1), j1 = std::min(j + 1, pH - 1);
+                const LaneVec &v00 = out[j * pW + i], &v10 = out[j * pW + i1];
+                const LaneVec &v01 = out[j1 * pW + i], &v11 = out[j1 * pW + i1];
+                LaneVec *cell = buf + 2 * j * newW + 2 * i;
+
+                const int chunkX = (i + pX) * 2, chunkZ = (j + pZ) * 2;
+                LaneVec cs = laneAdd(ss, laneSet(chunkX));
+                cs = laneZoomStep(cs, laneSet(chunkZ));
+                cs = laneZoomStep(cs, laneSet(chunkX));
+                cs = laneZoomStep(cs, laneSet(chunkZ));
+
+                cell[0] = v00;
+                cell[newW] = laneSelect(laneEq(laneZoomBits(cs, 1), 1), v01, v00);
+                cs = laneZoomStep(cs, st);
+                cell[1] = laneSelect(laneEq(laneZoomBits(cs, 1), 1), v10, v00);
+
+                // Random pick of the diagonal cell, mapZoom() only uses it on a tie
+                cs = laneZoomStep(cs, st);
+                LaneVec r = laneZoomBits(cs, 3);
+                LaneVec pick = laneSelect(laneEq(r, 0), v00, laneSelect(laneEq(r, 1), v10, laneSelect(laneEq(r, 2), v01, v11)));
+                if (!fuzzy)
+                {
+                    // select4(): the most common of the four wins, ties go to the random pick
+                    LaneVec e00_10 = laneEq(v00, v10), e00_01 = laneEq(v00, v01), e00_11 = laneEq(v00, v11);
+                    LaneVec e10_01 = laneEq(v10, v01), e10_11 = laneEq(v10, v11), e01_11 = laneEq(v01, v11);
+                    LaneVec cv00, cv10, cv01;
+                    for (int k = 0; k < SEED_LANE_REGS; ++k)
+                    {
+                        // Counts are negated as the masks are -1
+                        cv00.v[k] = _mm256_add_epi64(_mm256_add_epi64(e00_10.v[k], e00_01.v[k]), e00_11.v[k]);
+                        cv10.v[k] = _mm256_add_epi64(e10_01.v[k], e10_11.v[k]);
+                        cv01.v[k] = e01_11.v[k];
+                    }
+                    LaneVec win00, win10, win01;
+                    for (int k = 0; k < SEED_LANE_REGS; ++k)
+                    {
+                        win00.v[k] = _mm256_and_si256(_mm256_cmpgt_epi64(cv10.v[k], cv00.v[k]), _mm256_cmpgt_epi64(cv01.v[k], cv00.v[k]));
+                        win10.v[k] = _mm256_cmpgt_epi64(cv00.v[k], cv10.v[k]);
+                        win01.v[k] = _mm256_cmpgt_epi64(cv00.v[k], cv01.v[k]);
+                    }
+                    pick = laneSelect(win00, v00, laneSelect(win10, v10, laneSelect(win01, v01, pick)));
+                }
+                cell[newW + 1] = pick;
+            }
+        }
+
+        // Forward copy, the destination never passes the source
+        for (int j = 0; j < h; ++j)
+        {
+            const LaneVec *src = buf + (j + (z & 1)) * newW + (x & 1);
+            for (int i = 0; i < w; ++i)
+                out[j * w + i] = src[i];
+        }
+    }
+
+    // Layers reading only the cell itself: mapBiome() and mapSwampRiver()
+    SEEDFINDER_TARGET("avx2")
+    void laneSameArea(const Layer *l, int li, LaneVec *out, int x, int z, int w, int h)
+    {
+        laneArea(l->p, out, x, z, w, h);
+
+        const LaneVec &ss = startSeed[li];
+        const bool biome = l->getMap == mapBiome;
+        for (int j = 0; j < h; ++j)
+        {
+            for (int i = 0; i < w; ++i)
+            {
+                LaneVec &v = out[j * w + i];
+                LaneVec cs = laneChunkSeed(ss, i + x, j + z);
+                if (biome)
+                {
+                    LaneVec id = laneAndNot(laneSet(0xf00), v);
+                    LaneVec keep = laneOr(laneEq(id, ocean), laneEq(id, mushroom_fields));
+                    LaneVec b = laneLookup(OLD_BIOMES, laneFirstInt<7>(cs));
+                    LaneVec snowy = laneAndNot(laneOr(laneEq(id, plains), laneEq(b, taiga)), laneSet(-1));
+                    v = laneSelect(keep, id, laneSelect(snowy, snowy_tundra, b));
+                }
+                else
+                {
+                    LaneVec swampRiver = laneAnd(laneEq(v, swampland), laneFirstIsZero<6>(cs));
+                    LaneVec jungleRiver = laneAnd(laneOr(laneEq(v, jungle), laneEq(v, jungle_hills)), laneFirstIsZero<8>(cs));
+                    v = laneSelect(laneOr(swampRiver, jungleRiver), river, v);
+                }
+            }
+        }
+    }
+
+    // Layers reading the 3x3 neighbourhood: mapLand16(), mapSnow16(),
+    // mapMushroom(), mapHills() and mapShore(). Each cell is written after
+    // all its parents are read, which keeps the in-place update of cubiomes.
+    SEEDFINDER_TARGET("avx2")
+    void laneNeighbours(const Layer *l, int li, LaneVec *out, int x, int z, int w, int h)
+    {
+        const int pW = w + 2;
+        laneArea(l->p, out, x - 1, z - 1, pW, h + 2);
+
+        mapfunc_t *map = l->getMap;
+        const LaneVec &ss = startSeed[li], &st = startSalt[li];
+        const LaneVec zero = laneSet(0);
+        for (int j = 0; j < h; ++j)
+        {
+            for (int i = 0; i < w; ++i)
+            {
+                const LaneVec *row0 = out + j * pW + i, *row1 = row0 + pW, *row2 = row1 + pW;
+                const LaneVec v11 = row1[1];
+                LaneVec v;
+
+                if (map == mapShore)
+                {
+                    LaneVec anyOcean = laneOr(laneOr(laneEq(row0[1], 0), laneEq(row1[2], 0)), laneOr(laneEq(row1[0], 0), laneEq(row2[1], 0)));
+                    LaneVec allMountains = laneAnd(laneAnd(laneEq(row0[1], mountains), laneEq(row1[2], mountains)),
+                                                   laneAnd(laneEq(row1[0], mountains), laneEq(row2[1], mountains)));
+                    LaneVec mushroom = laneEq(v11, mushroom_fields), mountain = laneEq(v11, mountains);
+                    LaneVec keep = laneOr(laneOr(mushroom, mountain), laneOr(laneEq(v11, ocean), laneOr(laneEq(v11, river), laneEq(v11, swampland))));
+                    v = laneSelect(laneAnd(mushroom, anyOcean), mushroom_field_shore, v11);
+                    v = laneSelect(laneAndNot(allMountains, mountain), mountain_edge, v);
+                    v = laneSelect(laneAndNot(keep, anyOcean), beach, v);
+                    out[j * w + i] = v;
+                    continue;
+                }
+
+                LaneVec cs = laneChunkSeed(ss, i + x, j + z);
+                if (map == mapSnow16)
+                {
+                    v = laneSelect(laneEq(v11, ocean), v11, laneSelect(laneFirstIsZero<5>(cs), snowy_tundra, laneSet(plains)));
+                }
+                else if (map == mapHills)
+                {
+                    // Before 1.7 the hills need all four neighbours similar, the
+                    // hills noise branch is not read
+                    LaneVec cat = laneLookup(categoryTable, v11);
+                    LaneVec similar = laneAnd(laneAnd(laneEq(laneLookup(categoryTable, row0[1]), cat), laneEq(laneLookup(categoryTable, row1[2]), cat)),
+                                              laneAnd(laneEq(laneLookup(categoryTable, row1[0]), cat), laneEq(laneLookup(categoryTable, row2[1]), cat)));
+                    v = laneSelect(laneAnd(similar, laneFirstIsZero<3>(cs)), laneLookup(hillsTable, v11), v11);
+                }
+                else
+                {
+                    LaneVec diagOcean00 = laneEq(row0[0], 0), diagOcean20 = laneEq(row0[2], 0);
+                    LaneVec diagOcean02 = laneEq(row2[0], 0), diagOcean22 = laneEq(row2[2], 0);
+                    LaneVec allOcean = laneAnd(laneAnd(diagOcean00, diagOcean20), laneAnd(diagOcean02, diagOcean22));
+                    LaneVec centerOcean = laneEq(v11, 0);
+
+                    if (map == mapMushroom)
+                    {
+                        v = laneSelect(laneAnd(laneAnd(centerOcean, allOcean), laneFirstIsZero<100>(cs)), mushroom_fields, v11);
+                    }
+                    else
+                    {
+                        // mapLand16(): land next to the sea may sink, sea next to land may rise
+                        LaneVec anyOcean = laneOr(laneOr(diagOcean00, diagOcean20), laneOr(diagOcean02, diagOcean22));
+                        LaneVec sink = laneAnd(laneAndNot(centerOcean, anyOcean), laneFirstIsZero<5>(cs));
+                        v = laneSelect(sink, laneSelect(laneEq(v11, snowy_tundra), frozen_ocean, zero), v11);
+
+                        LaneVec rise = laneAndNot(allOcean, centerOcean);
+                        if (laneBits(rise))
+                            v = laneSelect(rise, landRise(cs, st, row0[0], row0[2], row2[0], row2[2]), v);
+                    }
+                }
+                out[j * w + i] = v;
+            }
+        }
+    }
+
+    // Ocean cell of mapLand16() with land on a diagonal: picks one of the
+    // land neighbours, stepping the chunk seed once for each of them
+    SEEDFINDER_TARGET("avx2")
+    LaneVec landRise(LaneVec cs, const LaneVec &st, const LaneVec &v00, const LaneVec &v20, const LaneVec &v02, const LaneVec &v22)
+    {
+        const LaneVec land[4] = {v00, v20, v02, v22};
+        LaneVec v = laneSet(1);
+        LaneVec inc = laneSet(0);
+        for (int n = 0; n < 4; ++n)
+        {
+            LaneVec isLand = laneAndNot(laneEq(land[n], ocean), laneSet(-1));
+            inc = laneSelect(isLand, laneAdd(inc, laneSet(1)), inc);
+
+            // The n-th land cell wins with odds 1/inc
+            LaneVec take = laneEq(inc, 1);
+            if (n >= 1)
+                take = laneOr(take, laneAnd(laneEq(inc, 2), laneFirstIsZero<2>(cs)));
+            if (n >= 2)
+                take = laneOr(take, laneAnd(laneEq(inc, 3), laneFirstIsZero<3>(cs)));
+            if (n >= 3)
+                take = laneOr(take, laneAnd(laneEq(inc, 4), laneFirstIsZero<4>(cs)));
+            v = laneSelect(laneAnd(isLand, take), land[n], v);
+
+            LaneVec next;
+            for (int k = 0; k < SEED_LANE_REGS; ++k)
+                next.v[k] = _mm256_add_epi64(laneStepSeed(cs, 0).v[k], st.v[k]);
+            cs = laneSelect(isLand, next, cs);
+        }
+
+        LaneVec sink = laneAndNot(laneFirstIsZero<3>(cs), laneSet(-1));
+        return laneSelect(sink, laneSelect(laneEq(v, snowy_tundra), frozen_ocean, laneSet(0)), v);
+    }
+
+    LaneVec startSeed[L_NUM];
+    LaneVec startSalt[L_NUM];
+    std::vector<LaneVec> laneCache;
+    std::vector<LaneVec> sharedCells[SEED_LANE_LAST_STAGE];
+    int sharedReady = 0;
+#endif
+
+    // Biomes of mapBiome() before 1.7, padded to a power of two
+    static constexpr int64_t OLD_BIOMES[8] = {desert, forest, mountains, swampland, plains, taiga, jungle, 0};
+
+    Generator g;
+    const Layer *entry;
+    const Layer *stages[SEED_LANE_RESUME_STAGE];
+    Area areas[SEED_LANE_MAX_TEMPLES][SEED_LANE_RESUME_STAGE];
+    Area shared[SEED_LANE_LAST_STAGE] = {};
+    int sharedStages = 0;
+    int temples = 0;
+    uint32_t live = 0;
+    int types[SEED_LANES][SEED_LANE_MAX_TEMPLES] = {};
+    int64_t templeTable[SEED_LANE_TABLE_SIZE];
+    int64_t categoryTable[SEED_LANE_TABLE_SIZE];
+    int64_t hillsTable[SEED_LANE_TABLE_SIZE];
+    std::vector<int> cache;
+    CascadeStats stats;
+    ThreadMetrics *metrics = nullptr;
+    bool lanes = false;
+};
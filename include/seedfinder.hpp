@@ -0,0 +1,44 @@
+#pragma once
+
+#include <options.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Outcome of one finder run, e.g. for benchmarks and tests
+struct FinderSummary
+{
+    uint64_t items = 0; // seeds, quad bases or regions processed
+    double seconds = 0;
+
+    // Best result, bestScore < 0 when nothing was found
+    int64_t bestSeed = 0;
+    int bestScore = -1;
+    int bestX = 0, bestZ = 0;
+    int bestType = 0;
+
+    // When the best score was first reached, seconds < 0 if never
+    double secondsToBest = -1;
+    uint64_t itemsToBest = 0;
+
+    // Location finder with --clusters: groups found and the best one, score < 0 if none
+    uint64_t clusters = 0;
+    int bestClusterScore = -1;
+    int bestClusterTemples = 0;
+};
+
+// Each finder fills summary (when given) before it returns
+int run_seed_finder(const FinderOptions &opt, FinderSummary *summary = nullptr);
+int run_quad_temple_finder(const FinderOptions &opt, FinderSummary *summary = nullptr);
+int run_location_finder(const FinderOptions &opt, FinderSummary *summary = nullptr);
+
+// 'serve' subcommand: answers area and temple requests from inFd on outFd, or
+// from the clients of opt.socketPath, until the input ends or Ctrl-C
+int run_query_server(const FinderOptions &opt, int inFd = 0, int outFd = 1);
+
+// 'results' subcommand: merges binary result files, args are the ones after it
+int run_results_tool(const char *prog, const std::vector<std::string> &args);
+
+// 'render' subcommand: writes and checks images of the results of binary result files
+int run_render_tool(const char *prog, const std::vector<std::string> &args);
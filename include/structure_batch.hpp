@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cpu_features.hpp>
+#include <cstdint>
+
+extern "C"
+{
+#include "finders.h"
+}
+
+// Batched getFeaturePos() for a line of regions. Region i of the batch is
+// (regX + i*stepX, regZ + i*stepZ), and its block position is written to
+// outX[i], outZ[i]. Only valid for structures placed with getFeaturePos(),
+// like the temples. The AVX2 and SSE4.1 paths keep one 48-bit LCG per 64-bit
+// lane and give bit-identical results to the scalar path.
+
+// Multipliers applied to the region coordinates when seeding the region RNG
+inline constexpr uint64_t REGION_SEED_MUL_X = 341873128712ULL;
+inline constexpr uint64_t REGION_SEED_MUL_Z = 132897987541ULL;
+
+inline void getFeaturePosBatchScalar(const StructureConfig &sconf, uint64_t seed, int regX, int regZ,
+                                     int stepX, int stepZ, int count, int *outX, int *outZ)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        Pos pos = getFeaturePos(sconf, seed, regX + i * stepX, regZ + i * stepZ);
+        outX[i] = pos.x;
+        outZ[i] = pos.z;
+    }
+}
+
+#if SEEDFINDER_X86
+
+// Division by the chunk range in the vector paths: (v * magic) >> shift, exact
+// for every 31-bit v (round-up method, see Granlund & Montgomery)
+struct ChunkRangeDivider
+{
+    uint32_t range;
+    uint32_t magic;
+    int shift;
+    bool pow2;
+
+    explicit ChunkRangeDivider(uint32_t r)
+        : range(r), magic(0), shift(31), pow2((r & (r - 1)) == 0)
+    {
+        if (!pow2)
+        {
+            int l = 0;
+            while ((1u << l) < r)
+                ++l;
+            magic = (uint32_t)((1ULL << (31 + l)) / r + 1);
+            shift = 31 + l;
+        }
+    }
+};
+
+SEEDFINDER_TARGET("avx2")
+inline __m256i mulLo64Avx2(__m256i a, uint64_t k)
+{
+    // 64x64 -> low 64 from three 32x32 -> 64 products
+    const __m256i klo = _mm256_set1_epi64x((int64_t)(k & 0xffffffff));
+    const __m256i khi = _mm256_set1_epi64x((int64_t)(k >> 32));
+    __m256i lo = _mm256_mul_epu32(a, klo);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), klo), _mm256_mul_epu32(a, khi));
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+SEEDFINDER_TARGET("avx2")
+inline __m256i chunkInRegionAvx2(__m256i v, const ChunkRangeDivider &div)
+{
+    // v = seed >> 17 has 31 bits, so every product below fits in 64 bits
+    const __m256i r = _mm256_set1_epi64x(div.range);
+    if (div.pow2)
+        return _mm256_srli_epi64(_mm256_mul_epu32(v, r), 31);
+    __m256i q = _mm256_srli_epi64(_mm256_mul_epu32(v, _mm256_set1_epi64x(div.magic)), div.shift);
+    return _mm256_sub_epi64(v, _mm256_mul_epu32(q, r));
+}
+
+SEEDFINDER_TARGET("avx2")
+inline void getFeaturePosBatchAvx2(const StructureConfig &sconf, uint64_t seed, int regX, int regZ,
+                                   int stepX, int stepZ, int count, int *outX, int *outZ)
+{
+    const uint64_t K = 0x5deece66dULL;
+    const __m256i M = _mm256_set1_epi64x((int64_t)((1ULL << 48) - 1));
+    const __m256i b = _mm256_set1_epi64x(0xb);
+    const __m256i scramble = _mm256_set1_epi64x((int64_t)K);
+    const ChunkRangeDivider div(sconf.chunkRange);
+
+    // Region seeds advance by a constant per batch element
+    const uint64_t step = (uint64_t)(int64_t)stepX * REGION_SEED_MUL_X + (uint64_t)(int64_t)stepZ * REGION_SEED_MUL_Z;
+    const uint64_t base = seed + (uint64_t)(int64_t)regX * REGION_SEED_MUL_X + (uint64_t)(int64_t)regZ * REGION_SEED_MUL_Z + sconf.salt;
+    __m256i s = _mm256_set_epi64x((int64_t)(base + 3 * step), (int64_t)(base + 2 * step), (int64_t)(base + step), (int64_t)base);
+    const __m256i sstep = _mm256_set1_epi64x((int64_t)(4 * step));
+
+    // Block origin of the regions, kept as 32-bit lanes like getFeaturePos
+    const __m128i lane = _mm_set_epi32(3, 2, 1, 0);
+    __m128i rx = _mm_add_epi32(_mm_set1_epi32(regX), _mm_mullo_epi32(lane, _mm_set1_epi32(stepX)));
+    __m128i rz = _mm_add_epi32(_mm_set1_epi32(regZ), _mm_mullo_epi32(lane, _mm_set1_epi32(stepZ)));
+    const __m128i rxstep = _mm_set1_epi32(4 * stepX), rzstep = _mm_set1_epi32(4 * stepZ);
+    const __m256i gather = _mm256_set_epi32(7, 7, 7, 7, 6, 4, 2, 0);
+    const __m128i regionSize = _mm_set1_epi32(sconf.regionSize);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i r = _mm256_xor_si256(s, scramble);
+        r = _mm256_and_si256(_mm256_add_epi64(mulLo64Avx2(r, K), b), M);
+        __m256i cx = chunkInRegionAvx2(_mm256_srli_epi64(r, 17), div);
+        r = _mm256_and_si256(_mm256_add_epi64(mulLo64Avx2(r, K), b), M);
+        __m256i cz = chunkInRegionAvx2(_mm256_srli_epi64(r, 17), div);
+
+        __m128i cx32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(cx, gather));
+        __m128i cz32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(cz, gather));
+        __m128i px = _mm_slli_epi32(_mm_add_epi32(_mm_mullo_epi32(rx, regionSize), cx32), 4);
+        __m128i pz = _mm_slli_epi32(_mm_add_epi32(_mm_mullo_epi32(rz, regionSize), cz32), 4);
+        _mm_storeu_si128((__m128i *)(outX + i), px);
+        _mm_storeu_si128((__m128i *)(outZ + i), pz);
+
+        s = _mm256_add_epi64(s, sstep);
+        rx = _mm_add_epi32(rx, rxstep);
+        rz = _mm_add_epi32(rz, rzstep);
+    }
+
+    getFeaturePosBatchScalar(sconf, seed, regX + i * stepX, regZ + i * stepZ, stepX, stepZ, count - i, outX + i, outZ + i);
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline __m128i mulLo64Sse41(__m128i a, uint64_t k)
+{
+    const __m128i klo = _mm_set1_epi64x((int64_t)(k & 0xffffffff));
+    const __m128i khi = _mm_set1_epi64x((int64_t)(k >> 32));
+    __m128i lo = _mm_mul_epu32(a, klo);
+    __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), klo), _mm_mul_epu32(a, khi));
+    return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline __m128i chunkInRegionSse41(__m128i v, const ChunkRangeDivider &div)
+{
+    const __m128i r = _mm_set1_epi64x(div.range);
+    if (div.pow2)
+        return _mm_srli_epi64(_mm_mul_epu32(v, r), 31);
+    __m128i q = _mm_srli_epi64(_mm_mul_epu32(v, _mm_set1_epi64x(div.magic)), div.shift);
+    return _mm_sub_epi64(v, _mm_mul_epu32(q, r));
+}
+
+SEEDFINDER_TARGET("sse4.1")
+inline void getFeaturePosBatchSse41(const StructureConfig &sconf, uint64_t seed, int regX, int regZ,
+                                    int stepX, int stepZ, int count, int *outX, int *outZ)
+{
+    const uint64_t K = 0x5deece66dULL;
+    const __m128i M = _mm_set1_epi64x((int64_t)((1ULL << 48) - 1));
+    const __m128i b = _mm_set1_epi64x(0xb);
+    const __m128i scramble = _mm_set1_epi64x((int64_t)K);
+    const ChunkRangeDivider div(sconf.chunkRange);
+
+    const uint64_t step = (uint64_t)(int64_t)stepX * REGION_SEED_MUL_X + (uint64_t)(int64_t)stepZ * REGION_SEED_MUL_Z;
+    const uint64_t base = seed + (uint64_t)(int64_t)regX * REGION_SEED_MUL_X + (uint64_t)(int64_t)regZ * REGION_SEED_MUL_Z + sconf.salt;
+    __m128i s = _mm_set_epi64x((int64_t)(base + step), (int64_t)base);
+    const __m128i sstep = _mm_set1_epi64x((int64_t)(2 * step));
+
+    const __m128i lane = _mm_set_epi32(0, 0, 1, 0);
+    __m128i rx = _mm_add_epi32(_mm_set1_epi32(regX), _mm_mullo_epi32(lane, _mm_set1_epi32(stepX)));
+    __m128i rz = _mm_add_epi32(_mm_set1_epi32(regZ), _mm_mullo_epi32(lane, _mm_set1_epi32(stepZ)));
+    const __m128i rxstep = _mm_set1_epi32(2 * stepX), rzstep = _mm_set1_epi32(2 * stepZ);
+    const __m128i regionSize = _mm_set1_epi32(sconf.regionSize);
+
+    int i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i r = _mm_xor_si128(s, scramble);
+        r = _mm_and_si128(_mm_add_epi64(mulLo64Sse41(r, K), b), M);
+        __m128i cx = chunkInRegionSse41(_mm_srli_epi64(r, 17), div);
+        r = _mm_and_si128(_mm_add_epi64(mulLo64Sse41(r, K), b), M);
+        __m128i cz = chunkInRegionSse41(_mm_srli_epi64(r, 17), div);
+
+        __m128i cx32 = _mm_shuffle_epi32(cx, _MM_SHUFFLE(3, 3, 2, 0));
+        __m128i cz32 = _mm_shuffle_epi32(cz, _MM_SHUFFLE(3, 3, 2, 0));
+        __m128i px = _mm_slli_epi32(_mm_add_epi32(_mm_mullo_epi32(rx, regionSize), cx32), 4);
+        __m128i pz = _mm_slli_epi32(_mm_add_epi32(_mm_mullo_epi32(rz, regionSize), cz32), 4);
+        _mm_storel_epi64((__m128i *)(outX + i), px);
+        _mm_storel_epi64((__m128i *)(outZ + i), pz);
+
+        s = _mm_add_epi64(s, sstep);
+        rx = _mm_add_epi32(rx, rxstep);
+        rz = _mm_add_epi32(rz, rzstep);
+    }
+
+    getFeaturePosBatchScalar(sconf, seed, regX + i * stepX, regZ + i * stepZ, stepX, stepZ, count - i, outX + i, outZ + i);
+}
+
+#endif // SEEDFINDER_X86
+
+// Fills outX/outZ with the widest path available on this CPU
+inline void getFeaturePosBatch(const StructureConfig &sconf, uint64_t seed, int regX, int regZ,
+                               int stepX, int stepZ, int count, int *outX, int *outZ)
+{
+#if SEEDFINDER_X86
+    if (cpuHasAvx2())
+        return getFeaturePosBatchAvx2(sconf, seed, regX, regZ, stepX, stepZ, count, outX, outZ);
+    if (cpuHasSse41())
+        return getFeaturePosBatchSse41(sconf, seed, regX, regZ, stepX, stepZ, count, outX, outZ);
+#endif
+    getFeaturePosBatchScalar(sconf, seed, regX, regZ, stepX, stepZ, count, outX, outZ);
+}
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Set by the SIGINT handler, the engines stop handing out work once it is
+inline std::atomic<bool> interruptRequested{false};
+
+inline void onInterrupt(int)
+{
+    interruptRequested.store(true);
+    std::signal(SIGINT, SIG_DFL); // a second Ctrl-C kills the process
+}
+
+// Makes Ctrl-C drain the running finder instead of killing it: the workers
+// finish the item they are on, then the finder saves its checkpoint and
+// flushes its results as at the end of a run
+inline void installInterruptHandler()
+{
+    std::signal(SIGINT, onInterrupt);
+}
+
+// Logical CPUs this process may run on, one per physical core first and then
+// their SMT siblings, so the first workers never share a core. Empty where
+// the topology is unknown.
+inline std::vector<int> cpuPinOrder()
+{
+    // (sibling rank, core, cpu), sorted
+    std::vector<std::tuple<int, int, int>> cpus;
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return {};
+
+    auto readId = [](int cpu, const char *name)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+        FILE *fp = fopen(path, "r");
+        int id = cpu;
+        if (fp)
+        {
+            if (fscanf(fp, "%d", &id) != 1)
+                id = cpu;
+            fclose(fp);
+        }
+        return id;
+    };
+
+    std::vector<std::pair<int, int>> cores; // (package, core id) -> index
+    std::vector<int> siblings;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        std::pair<int, int> key(readId(cpu, "physical_package_id"), readId(cpu, "core_id"));
+        size_t core = std::find(cores.begin(), cores.end(), key) - cores.begin();
+        if (core == cores.size())
+        {
+            cores.push_back(key);
+            siblings.push_back(0);
+        }
+        cpus.emplace_back(siblings[core]++, (int)core, cpu);
+    }
+#elif defined(_WIN32)
+    // Processor group 0 only, i.e. the first 64 logical CPUs
+    DWORD bytes = 0;
+    GetLogicalProcessorInformation(nullptr, &bytes);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(bytes / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (info.empty() || !GetLogicalProcessorInformation(info.data(), &bytes))
+        return {};
+    int core = 0;
+    for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION &p : info)
+    {
+        if (p.Relationship != RelationProcessorCore)
+            continue;
+        int rank = 0;
+        for (int cpu = 0; cpu < 64; ++cpu)
+            if (p.ProcessorMask & ((ULONG_PTR)1 << cpu))
+                cpus.emplace_back(rank++, core, cpu);
+        ++core;
+    }
+#endif
+    std::sort(cpus.begin(), cpus.end());
+    std::vector<int> order;
+    order.reserve(cpus.size());
+    for (const auto &c : cpus)
+        order.push_back(std::get<2>(c));
+    return order;
+}
+
+// Pins the calling thread to one logical CPU
+inline bool pinCurrentThread(int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Work-stealing scheduler shared by the finders. Work is a range of tickets
+// (see shardItem()), taken in order from a shared cursor in chunks. A chunk
+// becomes the range of one worker, which runs it front to back. Chunks are
+// sized so a chunk takes about CHUNK_SECONDS, but never more than a share of
+// what is left, so fast items do not hammer the cursor and the last items
+// are not stuck behind one worker. Once the cursor is exhausted, idle
+// workers steal the back half of the largest range left.
+//
+// Each worker also publishes the lowest ticket it is responsible for, so
+// every ticket below lowWater() is done and a checkpoint can resume from it.
+// Only the owner and a thief touch a range, under its own lock.
+class TaskEngine
+{
+public:
+    static constexpr double CHUNK_SECONDS = 0.05;
+    static constexpr uint64_t MAX_CHUNK = 1 << 16;
+
+    struct Stats
+    {
+        uint64_t chunks = 0; // taken from the cursor
+        uint64_t steals = 0;
+    };
+
+    TaskEngine(unsigned int workers, uint64_t firstTicket, uint64_t endTicket, bool pin = false)
+        : cursor(std::min(firstTicket, endTicket)), end(endTicket), pin(pin), slots(std::max(1u, workers))
+    {
+        for (Slot &slot : slots)
+            slot.low.store(NONE);
+    }
+
+    TaskEngine(const TaskEngine &) = delete;
+    TaskEngine &operator=(const TaskEngine &) = delete;
+
+    unsigned int workers() const
+    {
+        return (unsigned int)slots.size();
+    }
+
+    // Runs body(worker) on one thread per worker and waits for all of them.
+    // With pinning, worker i runs on the i-th CPU of cpuPinOrder().
+    template <typename Body>
+    void run(Body body)
+    {
+        const std::vector<int> cpus = pin ? cpuPinOrder() : std::vector<int>();
+        if (pin && cpus.empty())
+            fprintf(stderr, "CPU topology unknown, worker threads are not pinned\n");
+        else if (pin)
+            printf("[ENGINE] workers=%u pinned to %zu CPUs, physical cores first\n", workers(), cpus.size());
+
+        std::vector<std::thread> threads;
+        threads.reserve(slots.size());
+        for (unsigned int w = 0; w < workers(); ++w)
+        {
+            threads.emplace_back([this, &body, &cpus, w]()
+                                 {
+                if (!cpus.empty())
+                    pinCurrentThread(cpus[w % cpus.size()]);
+                body(w); });
+        }
+        for (auto &th : threads)
+            th.join();
+
+        if (interrupted())
+            printf("[ENGINE] interrupted, resume from ticket %llu\n", (unsigned long long)lowWater());
+        fflush(stdout);
+    }
+
+    // Marks the previous ticket of this worker as done and returns the next
+    // one in ticket. False when all tickets are handed out or the run was
+    // interrupted, then the worker should return.
+    bool next(unsigned int worker, uint64_t &ticket)
+    {
+        Slot &s = slots[worker];
+        const auto now = std::chrono::steady_clock::now();
+        if (s.started)
+        {
+            double seconds = std::chrono::duration<double>(now - s.startedAt).count();
+            s.secondsPerItem = s.secondsPerItem > 0 ? 0.8 * s.secondsPerItem + 0.2 * seconds : seconds;
+        }
+        s.startedAt = now;
+
+        if (interrupted())
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.low.store(s.begin < s.end ? s.begin : NONE);
+            s.started = false;
+            return false;
+        }
+
+        s.started = popOwn(s, ticket) || takeChunk(s, ticket) || steal(worker, ticket);
+        return s.started;
+    }
+
+    bool interrupted() const
+    {
+        return interruptRequested.load(std::memory_order_relaxed);
+    }
+
+    // Every ticket below this is done
+    uint64_t lowWater() const
+    {
+        uint64_t low = std::min(cursor.load(), end);
+        for (const Slot &slot : slots)
+            low = std::min(low, slot.low.load());
+        return low;
+    }
+
+    Stats statistics() const
+    {
+        Stats total;
+        for (const Slot &slot : slots)
+        {
+            total.chunks += slot.chunks.load(std::memory_order_relaxed);
+            total.steals += slot.steals.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    static constexpr uint64_t NONE = UINT64_MAX;
+
+    struct alignas(64) Slot
+    {
+        std::mutex mutex;
+        uint64_t begin = 0, end = 0;   // tickets not started yet, under mutex
+        std::atomic<uint64_t> low;     // lowest ticket not done, NONE if none
+        std::atomic<uint64_t> chunks{0};
+        std::atomic<uint64_t> steals{0};
+
+        // Owner only
+        bool started = false;
+        double secondsPerItem = 0;
+        std::chrono::steady_clock::time_point startedAt;
+    };
+
+    bool popOwn(Slot &s, uint64_t &ticket)
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.begin >= s.end)
+            return false;
+        ticket = s.begin++;
+        s.low.store(ticket);
+        return true;
+    }
+
+    uint64_t chunkSize(const Slot &s, uint64_t first) const
+    {
+        uint64_t size = s.secondsPerItem > 0 ? (uint64_t)std::min<double>(MAX_CHUNK, CHUNK_SECONDS / s.secondsPerItem) : 1;
+        uint64_t share = (end - first) / (2 * slots.size());
+        return std::max<uint64_t>(1, std::min(size, share));
+    }
+
+    bool takeChunk(Slot &s, uint64_t &ticket)
+    {
+        // Publish a lower bound first so a concurrent lowWater() never skips the chunk
+        uint64_t first = cursor.load();
+        s.low.store(first);
+        uint64_t count = 0;
+        do
+        {
+            if (first >= end)
+            {
+                s.low.store(NONE);
+                return false;
+            }
+            count = chunkSize(s, first);
+        } while (!cursor.compare_exchange_weak(first, first + count));
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.begin = first + 1;
+        s.end = first + count;
+        s.low.store(first);
+        s.chunks.fetch_add(1, std::memory_order_relaxed);
+        ticket = first;
+        return true;
+    }
+
+    // Back half of the largest range of the other workers
+    bool steal(unsigned int thief, uint64_t &ticket)
+    {
+        Slot &s = slots[thief];
+        for (;;)
+        {
+            unsigned int victim = thief;
+            uint64_t largest = 0;
+            for (unsigned int w = 0; w < workers(); ++w)
+            {
+                if (w == thief)
+                    continue;
+                std::lock_guard<std::mutex> lock(slots[w].mutex);
+                if (slots[w].end - slots[w].begin > largest)
+                {
+                    largest = slots[w].end - slots[w].begin;
+                    victim = w;
+                }
+            }
+            if (victim == thief)
+                return false;
+
+            Slot &v = slots[victim];
+            uint64_t first, last;
+            {
+                std::lock_guard<std::mutex> lock(v.mutex);
+                if (v.begin >= v.end)
+                    continue; // taken meanwhile, look again
+                first = v.begin + (v.end - v.begin) / 2;
+                last = v.end;
+                s.low.store(first); // before the victim lets go of it
+                v.end = first;
+            }
+
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.begin = first + 1;
+            s.end = last;
+            s.steals.fetch_add(1, std::memory_order_relaxed);
+            ticket = first;
+            return true;
+        }
+    }
+
+    std::atomic<uint64_t> cursor;
+    const uint64_t end;
+    const bool pin;
+    std::vector<Slot> slots;
+};
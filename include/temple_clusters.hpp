@@ -0,0 +1,268 @@
+#pragma once
+
+#include <finder_utils.hpp>
+#include <result_collector.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+// Radius of the sphere around the player in which mobs spawn
+constexpr int AFK_RADIUS = 128;
+
+// Group of 2 to 4 temples that all reach into the sphere around one AFK point
+struct TempleCluster
+{
+    FoundResult result; // score is the swamp spawn blocks in reach, see fits()
+    Pos afk;
+};
+
+// Finds the clusters among the temples of a scan in one pass.
+//
+// Temples are kept in a hash map keyed by region. Regions are 512 blocks and
+// a temple starts in the first 384 of its region, so temples two regions apart
+// never share a 256 block sphere and every cluster lies in a 2x2 window of
+// regions. A window is evaluated once, as soon as the work items scanning its
+// regions are all completed, and a temple is dropped once its 4 windows are
+// done. Memory follows the front of the scan instead of growing with it.
+//
+// itemOf(regionX, regionZ) is the work item scanning a region, 0 for regions
+// outside the scan. add() and complete() must be called in item order.
+class TempleClusterIndex
+{
+public:
+    TempleClusterIndex(int64_t seed, int regionBlocks, std::function<uint64_t(int, int)> itemOf)
+        : seed(seed), regionBlocks(regionBlocks), itemOf(std::move(itemOf))
+    {
+    }
+
+    // Adds a scored temple of the item being completed
+    void add(const FoundTemple &t)
+    {
+        const int rx = floorDiv(t.x, regionBlocks), rz = floorDiv(t.z, regionBlocks);
+        if (!temples.try_emplace(key(rx, rz), Tracked{t, 4}).second)
+            return;
+        peak = std::max(peak, temples.size());
+
+        // The windows of the temple are due once their last region is scanned
+        for (int j = 0; j < 4; ++j)
+        {
+            const int wx = rx - 1 + j % 2, wz = rz - 1 + j / 2;
+            if (!scheduled.insert(key(wx, wz)).second)
+                continue;
+            uint64_t due = 0;
+            for (int k = 0; k < 4; ++k)
+                due = std::max(due, itemOf(wx + k % 2, wz + k / 2));
+            pending.emplace(due, std::make_pair(wx, wz));
+        }
+    }
+
+    // Items up to and including item are done: evaluates the windows they
+    // complete and calls report(const TempleCluster &) for each cluster found
+    template <typename Report>
+    void complete(uint64_t item, Report &&report)
+    {
+        while (!pending.empty() && pending.begin()->first <= item)
+        {
+            const auto [wx, wz] = pending.begin()->second;
+            pending.erase(pending.begin());
+            evaluate(wx, wz, report);
+        }
+    }
+
+    // Evaluates every window still open, after the scan or an interrupt
+    template <typename Report>
+    void finish(Report &&report)
+    {
+        complete(UINT64_MAX, report);
+    }
+
+    // Clusters found with n = 2, 3 or 4 temples
+    uint64_t clusters(int n) const
+    {
+        return found[n];
+    }
+
+    // Most temples held at once
+    size_t peakTemples() const
+    {
+        return peak;
+    }
+
+    // Best cluster so far, false if none
+    bool bestCluster(TempleCluster &out) const
+    {
+        out = best;
+        return best.result.count > 0;
+    }
+
+    // True if every temple has blocks in the sphere around one AFK point, sets
+    // afk to its center and score to the swamp spawn blocks in reach. The
+    // sphere is the one of getOptimalAfk(): the player stands half the height
+    // of the tallest piece above its spawning spaces. A temple whose footprint
+    // is only partly in reach counts its swamp spawn blocks in proportion, as
+    // the biome of each block is not kept.
+    static bool fits(const FoundTemple *const *t, int n, Pos &afk, int &score)
+    {
+        PieceSize piece = {0, 0, 0};
+        for (int i = 0; i < n; ++i)
+        {
+            const PieceSize own = templePiece(t[i]->type);
+            piece = {std::max(piece.w, own.w), std::max(piece.h, own.h), std::max(piece.d, own.d)};
+        }
+        const double rsq = AFK_RADIUS * AFK_RADIUS - piece.h * piece.h / 4.0;
+
+        // The nearest blocks of two temples are at most a diameter apart
+        for (int i = 0; i < n; ++i)
+        {
+            for (int j = i + 1; j < n; ++j)
+            {
+                const PieceSize a = templePiece(t[i]->type), b = templePiece(t[j]->type);
+                const double dx = std::max({0, t[j]->x - (t[i]->x + a.w - 1), t[i]->x - (t[j]->x + b.w - 1)});
+                const double dz = std::max({0, t[j]->z - (t[i]->z + a.d - 1), t[i]->z - (t[j]->z + b.d - 1)});
+                if (dx * dx + dz * dz > 4 * rsq)
+                    return false;
+            }
+        }
+
+        // getOptimalAfk() always takes 4 structures, smaller groups repeat theirs
+        Pos p[4];
+        for (int k = 0; k < 4; ++k)
+            p[k] = {t[k % n]->x, t[k % n]->z};
+        afk = getOptimalAfk(p, piece.w, piece.h, piece.d, nullptr);
+
+        // Its block count repeats those temples, so count each footprint once
+        // at its own size
+        score = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            const PieceSize own = templePiece(t[i]->type);
+            int inReach = 0;
+            for (int px = 0; px < own.w; ++px)
+            {
+                const double dx = t[i]->x + px - afk.x;
+                for (int pz = 0; pz < own.d; ++pz)
+                {
+                    const double dz = t[i]->z + pz - afk.z;
+                    inReach += dx * dx + dz * dz <= rsq;
+                }
+            }
+            if (inReach == 0)
+                return false;
+            const int blocks = own.w * own.d;
+            score += (int)(((int64_t)t[i]->swampSpawnBlocks * inReach + blocks / 2) / blocks);
+        }
+        return true;
+    }
+
+private:
+    struct Tracked
+    {
+        FoundTemple temple;
+        int windowsLeft;
+    };
+
+    static int floorDiv(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    static uint64_t key(int regionX, int regionZ)
+    {
+        return (uint64_t)(uint32_t)regionX << 32 | (uint32_t)regionZ;
+    }
+
+    // Reports the best cluster of the window, by swamp spawn blocks in reach
+    // and then by temples. A group of temples is only tried in the window at
+    // its lowest region x and z, so the windows overlapping on a pair never
+    // report it twice.
+    template <typename Report>
+    void evaluate(int wx, int wz, Report &report)
+    {
+        scheduled.erase(key(wx, wz));
+
+        Tracked *members[4];
+        int regionX[4], regionZ[4], n = 0;
+        for (int k = 0; k < 4; ++k)
+        {
+            auto it = temples.find(key(wx + k % 2, wz + k / 2));
+            if (it == temples.end())
+                continue;
+            members[n] = &it->second;
+            regionX[n] = wx + k % 2;
+            regionZ[n] = wz + k / 2;
+            ++n;
+        }
+
+        // Groups of the window, highest sum of their temples' scores (then most
+        // temples) first. The sum bounds the score in reach, so the groups
+        // after one that beats it cannot. MEMBERS is the number of temples in
+        // each 4 bit mask.
+        static constexpr int MEMBERS[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+        std::array<std::pair<int, int>, 11> groups;
+        size_t groupCount = 0;
+        for (int mask = 1; mask < 1 << n; ++mask)
+        {
+            bool lowX = false, lowZ = false;
+            int score = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                if (mask >> i & 1)
+                {
+                    lowX |= regionX[i] == wx;
+                    lowZ |= regionZ[i] == wz;
+                    score += members[i]->temple.swampSpawnBlocks;
+                }
+            }
+            if (lowX && lowZ && MEMBERS[mask] >= 2 && groupCount < groups.size())
+                groups[groupCount++] = {score * 8 + MEMBERS[mask], mask};
+        }
+        std::sort(groups.begin(), groups.begin() + groupCount, std::greater<>());
+
+        TempleCluster window = {};
+        for (size_t g = 0; g < groupCount && groups[g].first > window.result.score * 8 + window.result.count; ++g)
+        {
+            const FoundTemple *t[4];
+            TempleCluster c;
+            c.result.seed = seed;
+            for (int i = 0; i < n; ++i)
+            {
+                if (groups[g].second >> i & 1)
+                {
+                    t[c.result.count] = &members[i]->temple;
+                    c.result.temples[c.result.count++] = members[i]->temple;
+                }
+            }
+            if (fits(t, c.result.count, c.afk, c.result.score) &&
+                c.result.score * 8 + c.result.count > window.result.score * 8 + window.result.count)
+                window = c;
+        }
+        if (window.result.count > 0)
+        {
+            ++found[window.result.count];
+            if (window.result.score > best.result.score)
+                best = window;
+            report(window);
+        }
+
+        for (int i = 0; i < n; ++i)
+            if (--members[i]->windowsLeft == 0)
+                temples.erase(key(regionX[i], regionZ[i]));
+    }
+
+    const int64_t seed;
+    const int regionBlocks;
+    const std::function<uint64_t(int, int)> itemOf;
+
+    std::unordered_map<uint64_t, Tracked> temples;      // by region
+    std::unordered_set<uint64_t> scheduled;             // windows in pending
+    std::multimap<uint64_t, std::pair<int, int>> pending; // windows by the item completing them
+    size_t peak = 0;
+    uint64_t found[5] = {};
+    TempleCluster best = {};
+};
@@ -1,153 +1,391 @@
+#include <biome_tiles.hpp>
+#include <candidate_pipeline.hpp>
 #include <finder_utils.hpp>
+#include <metrics.hpp>
+#include <options.hpp>
+#include <result_collector.hpp>
+#include <seedfinder.hpp>
+#include <structure_batch.hpp>
+#include <task_engine.hpp>
+#include <temple_clusters.hpp>
 
-// Extra config
+#include <cinttypes>
+#include <cmath>
+#include <map>
+#include <memory>
+
+// Extra config, the first two are the defaults of --radius and --progress-every
 constexpr unsigned int AREA_RADIUS_BLOCKS = 30000000;
-constexpr unsigned int AREA_RADIUS_REGIONS = AREA_RADIUS_BLOCKS / (CHUNK_SIZE * 32); // 58593
-constexpr unsigned int PRINT_PROGRESS_EVERY_REGIONS = 137327930;                     // Every ~1%
+constexpr unsigned int PRINT_PROGRESS_EVERY_REGIONS = 137327930;                     // Every ~1% of the whole world
+constexpr uint64_t SPIRAL_CHUNK_REGIONS = 1 << 16;                                    // Regions handed to a worker at once
 
 // Directions for spiral traversal in order: right, up, left, down
 constexpr int dx[4] = {1, 0, -1, 0};
 constexpr int dy[4] = {0, 1, 0, -1};
 
-int run_location_finder(uint64_t seed = 0)
+// The spiral starts at region (0,0) and then walks legs of length 1, 1, 2, 2, 3, 3, ...
+// turning right -> up -> left -> down. Spiral index i is the i-th region visited.
+struct SpiralLeg
+{
+    uint64_t leg;    // leg number j
+    uint64_t offset; // position of the index inside the leg
+    uint64_t length; // regions in the leg
+};
+
+// First spiral index of leg j: legs 0 .. 2m-1 hold m(m+1) regions, legs 0 .. 2m hold (m+1)^2
+inline uint64_t spiralLegStart(uint64_t leg)
+{
+    uint64_t m = leg / 2;
+    return 1 + (leg % 2 == 0 ? m * (m + 1) : (m + 1) * (m + 1));
+}
+
+// Leg holding spiral index (index >= 1)
+inline SpiralLeg spiralLegOf(uint64_t index)
+{
+    // Largest m with m(m+1) <= index-1, from the float root and then fixed up
+    uint64_t k = index - 1;
+    uint64_t m = (uint64_t)((std::sqrt(4.0 * (double)k + 1.0) - 1.0) / 2.0);
+    while (m > 0 && m * (m + 1) > k)
+        --m;
+    while ((m + 1) * (m + 2) <= k)
+        ++m;
+
+    uint64_t leg = 2 * m + (k >= (m + 1) * (m + 1) ? 1 : 0);
+    return {leg, index - spiralLegStart(leg), leg / 2 + 1};
+}
+
+// Region of spiral index in closed form
+inline void spiralRegion(uint64_t index, int &regionX, int &regionZ)
 {
-    printf("Searching through whole %llu seed...\n\n", seed);
+    if (index == 0)
+    {
+        regionX = regionZ = 0;
+        return;
+    }
+
+    SpiralLeg l = spiralLegOf(index);
+
+    // Leg 4q starts at (-q,-q), the other three at the corners walked to from there
+    int q = (int)(l.leg / 4);
+    int dir = (int)(l.leg % 4);
+    const int startX[4] = {-q, q + 1, q + 1, -q - 1};
+    const int startZ[4] = {-q, -q, q + 1, q + 1};
+
+    regionX = startX[dir] + dx[dir] * (int)(l.offset + 1);
+    regionZ = startZ[dir] + dy[dir] * (int)(l.offset + 1);
+}
 
-    std::ofstream log("logs/location_finder.log", std::ios::app);
-    if (!log)
-        fprintf(stderr, "Failed to open log file 'logs/location_finder.log'\n");
-    else
-        log << "\n\nstructure_type,\tworld_x,\tworld_z,\tswamp_spawn_blocks\n";
+// Spiral index of a region, the inverse of spiralRegion(). Leg 4q runs along
+// z = -q, 4q+1 along x = q+1, 4q+2 along z = q+1 and 4q+3 along x = -q-1.
+inline uint64_t spiralIndex(int regionX, int regionZ)
+{
+    const int64_t x = regionX, z = regionZ;
+    if (x == 0 && z == 0)
+        return 0;
+
+    if (z <= 0 && x >= z + 1 && x <= 1 - z)
+        return spiralLegStart(4 * (uint64_t)-z) + (uint64_t)(x - z - 1);
+    if (x >= 1 && z >= 2 - x && z <= x)
+        return spiralLegStart(4 * (uint64_t)(x - 1) + 1) + (uint64_t)(z + x - 2);
+    if (z >= 1 && x >= -z && x <= z - 1)
+        return spiralLegStart(4 * (uint64_t)(z - 1) + 2) + (uint64_t)(z - 1 - x);
+    const int64_t q = -x - 1;
+    return spiralLegStart(4 * (uint64_t)q + 3) + (uint64_t)(q - z);
+}
+
+// Candidate found in a work item, reported once all items before it are done
+struct LocationResult
+{
+    int type;
+    int swampSpawnBlocks;
+    int x, z;
+};
+
+struct CompletedItem
+{
+    uint64_t regions = 0;
+    std::vector<LocationResult> results;
+    std::vector<LocationResult> scored; // every scored temple, with --clusters
+};
+
+int run_location_finder(const FinderOptions &opt, FinderSummary *summary)
+{
+    const uint64_t seed = opt.startSeed;
+    const auto startTime = std::chrono::steady_clock::now();
+    printf("Searching through whole %" PRIu64 " seed...\n\n", seed);
 
     int styp = Desert_Pyramid;
     StructureConfig sconf;
     getStructureConfig(styp, MC_VERSION, &sconf);
 
-    const uint64_t totalRegions = (2ULL * AREA_RADIUS_REGIONS + 1ULL) * (2ULL * AREA_RADIUS_REGIONS + 1ULL);
+    const int R = (int)(opt.areaRadiusBlocks ? opt.areaRadiusBlocks : AREA_RADIUS_BLOCKS) / (sconf.regionSize * CHUNK_SIZE);
+    const uint64_t totalRegions = (2ULL * R + 1ULL) * (2ULL * R + 1ULL);
+    const uint64_t printProgressEvery = opt.progressEvery ? opt.progressEvery : PRINT_PROGRESS_EVERY_REGIONS;
+
+    // Work items are either square tiles of regions in spiral order (tiled scan)
+    // or chunks of the region spiral itself
+    const int tileRegions = (int)opt.tileRegions;
+    const int regionBlocks = sconf.regionSize * CHUNK_SIZE;
+    const int tileRings = tileRegions ? (R + tileRegions / 2) / tileRegions + 1 : 0;
+    const uint64_t totalItems = tileRegions ? (2ULL * tileRings + 1ULL) * (2ULL * tileRings + 1ULL)
+                                            : (totalRegions + SPIRAL_CHUNK_REGIONS - 1) / SPIRAL_CHUNK_REGIONS;
 
-    const unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned int numThreads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    // Workers take work items in order (stealing the last ones), so each region is visited once
+    TaskEngine engine(numThreads, 0, totalItems, opt.pinThreads);
+
+    // Items finished ahead of the first unfinished one wait here, so results are reported center-out
+    std::mutex commitMutex; // protects the fields below and printf
+    std::map<uint64_t, CompletedItem> pendingItems;
+    uint64_t committedItems = 0;
+    uint64_t scannedRegions = 0;
+    FinderMetrics metrics(opt, "loc", numThreads, totalRegions);
+
+    // Committed results are submitted through the first ring only, in commit order, so
+    // the collector sees them center-out. Its threshold prunes the candidates.
+    ResultCollector results(opt, RF_LOCATION, "logs/location_finder.log", "\n\nstructure_type,\tworld_x,\tworld_z,\tswamp_spawn_blocks\n",
+                            "logs/location_finder.bin", "logs/location_finder_histogram.csv", numThreads, &metrics);
+
+    // With --clusters every scored temple also goes into the cluster index in
+    // commit order, and the groups sharing an AFK sphere into a collector of
+    // their own (always the files below, --results names the one above)
+    std::unique_ptr<ResultCollector> clusterResults;
+    std::unique_ptr<TempleClusterIndex> clusters;
+    if (opt.clusters)
+    {
+        FinderOptions clusterOpt = opt;
+        clusterOpt.resultsPath.clear();
+        clusterResults = std::make_unique<ResultCollector>(clusterOpt, RF_CLUSTER, "logs/location_clusters.log", "\n\ntemples, swamp_blocks_in_reach\n",
+                                                           "logs/location_clusters.bin", "logs/location_clusters_histogram.csv", 1);
 
-    std::atomic<int> mostSwampSpawnBlocks{0};
-    std::mutex logMutex;   // protects file writes and printf for NEW BEST
-    std::mutex printMutex; // protects periodic progress printf
+        // Work item scanning a region: its spiral chunk or the tile holding it
+        clusters = std::make_unique<TempleClusterIndex>(seed, regionBlocks, [=](int regionX, int regionZ) -> uint64_t
+                                                        {
+            if (std::abs(regionX) > R || std::abs(regionZ) > R)
+                return 0;
+            if (!tileRegions)
+                return spiralIndex(regionX, regionZ) / SPIRAL_CHUNK_REGIONS;
+            return spiralIndex((int)std::floor((regionX + tileRegions / 2) / (double)tileRegions),
+                               (int)std::floor((regionZ + tileRegions / 2) / (double)tileRegions)); });
+    }
 
-    // worker lambda: each thread executes the same spiral; only handles regions where (index % numThreads) == tid
-    auto worker = [&](unsigned int tid)
+    auto reportCluster = [&](const TempleCluster &c)
+    {
+        clusterResults->recordScore(0, c.result.score);
+        if (c.result.score >= clusterResults->threshold())
+            clusterResults->submit(0, c.result);
+    };
+
+    auto commit = [&](uint64_t item, CompletedItem &done, const CascadeStats &cascade, unsigned int tid)
+    {
+        std::lock_guard<std::mutex> lk(commitMutex);
+        std::swap(pendingItems[item], done);
+
+        for (auto it = pendingItems.begin(); it != pendingItems.end() && it->first == committedItems; it = pendingItems.erase(it))
+        {
+            for (const LocationResult &r : it->second.results)
+                results.submit(0, {(int64_t)seed, r.swampSpawnBlocks, 1, {{r.type, r.swampSpawnBlocks, r.x, r.z}}});
+            if (clusters)
+            {
+                for (const LocationResult &r : it->second.scored)
+                    clusters->add({r.type, r.swampSpawnBlocks, r.x, r.z});
+                clusters->complete(it->first, reportCluster);
+            }
+
+            uint64_t scannedBefore = scannedRegions;
+            ++committedItems;
+            scannedRegions += it->second.regions;
+
+            if (scannedBefore / printProgressEvery != scannedRegions / printProgressEvery)
+            {
+                FoundResult best;
+                results.bestResult(best);
+                printf("[PROGRESS] scanned-regions=%" PRIu64 " total-regions=%" PRIu64 " best-so-far: swamp-spawn-blocks=%d\n",
+                       scannedRegions, totalRegions, best.score);
+                printf("[CASCADE] worker=%u rejected: %s\n", tid, formatCascadeStats(cascade).c_str());
+            }
+        }
+    };
+
+    // Worker lambda, instantiated for the temple types of the search
+    auto worker = [&](unsigned int tid, auto templeTypes)
     {
         // thread-local generator/state
+        ThreadMetrics *m = metrics.worker(tid);
         Generator g;
         setupGenerator(&g, MC_VERSION, 0);
-        applySeed(&g, DIM_OVERWORLD, seed);
+        {
+            ThreadMetrics::StageTimer timer(m, STAGE_APPLY_SEED);
+            applySeed(&g, DIM_OVERWORLD, seed);
+        }
 
-        uint64_t scannedRegions = 0;
+        // In the tiled scan the evaluator reads the coarse layers from the current tile
+        std::unique_ptr<BiomeTileStack> tiles;
+        if (tileRegions)
+        {
+            tiles = std::make_unique<BiomeTileStack>(&g, tileRegions * regionBlocks);
+            if (tid == 0)
+                printf("[TILES] tile=%dx%d regions, %.1f MB per worker\n", tileRegions, tileRegions, tiles->memoryBytes() / 1e6);
+        }
+        TempleEvaluatorFor<decltype(templeTypes)::value> eval(tiles ? tiles->generator() : &g, opt.queryY);
+        eval.setMetrics(m);
 
-        int regionX = 0, regionZ = 0;
-        Pos pos;
+        CandidatePipeline<decltype(eval)> pipeline(eval, opt.batchSize ? (int)opt.batchSize : PIPELINE_BATCH);
+        pipeline.setMetrics(m);
+        CompletedItem done;
 
-        // process origin (region 0)
-        getStructurePos(styp, MC_VERSION, seed, regionX, regionZ, &pos);
+        auto flush = [&]()
+        {
+            // Clusters are made of temples that may be too weak to be reported alone
+            const int minScore = results.threshold();
+            const int kept = pipeline.run(opt.clusters ? MIN_SWAMP_SPAWN_BLOCKS : minScore);
+            for (int i = 0; i < kept; ++i)
+            {
+                const TempleScore temple = pipeline.templeScores(i)[0];
+                const LocationResult r = {temple.type, temple.swampSpawnBlocks, pipeline.xs(i)[0], pipeline.zs(i)[0]};
+                results.recordScore(tid, temple.swampSpawnBlocks);
+                if (temple.swampSpawnBlocks >= results.threshold(temple.type))
+                    done.results.push_back(r);
+                if (opt.clusters)
+                    done.scored.push_back(r);
+            }
+            pipeline.clear();
+        };
 
-        if ((scannedRegions % numThreads) == tid)
+        // Positions of count regions along a line into the pipeline, which
+        // runs whenever it is full
+        auto placeLine = [&](int regionX, int regionZ, int stepX, int stepZ, int count)
         {
-            int templeType = isViableTemplePos(&g, pos.x, pos.z);
-            if (templeType)
+            for (int placed = 0; placed < count;)
             {
-                int swampSpawnBlocks = countSwampSpawnBlocks(&g, pos.x, pos.z, templeType);
-                if (swampSpawnBlocks > 0)
-                {
-                    int prev = mostSwampSpawnBlocks.load(std::memory_order_relaxed);
-                    if (swampSpawnBlocks >= prev)
-                    {
-                        // log/update under mutex to avoid interleaving file writes & prints
-                        std::lock_guard<std::mutex> lk(logMutex);
-                        prev = mostSwampSpawnBlocks.load();
-                        if (swampSpawnBlocks >= prev)
-                        {
-                            mostSwampSpawnBlocks.store(swampSpawnBlocks);
-                            const char *templeTypeName = (templeType == 1 ? "DesertPyramid" : templeType == 2 ? "JungleTemple"
-                                                                                                              : "WitchHut");
-                            printf("[NEW BEST] type=%s swamp-spawn-blocks=%d -> /tp @p %d ~ %d\n",
-                                   templeTypeName, swampSpawnBlocks, pos.x, pos.z);
-                            if (log)
-                            {
-                                log << templeTypeName << ",\t" << pos.x << ",\t" << pos.z << ",\t" << swampSpawnBlocks << "\n";
-                                log.flush();
-                            }
-                        }
-                    }
-                }
+                placed += pipeline.place(sconf, seed, regionX + stepX * placed, regionZ + stepZ * placed, stepX, stepZ, count - placed);
+                if (pipeline.space() == 0)
+                    flush();
             }
-        }
+            done.regions += count;
+            m->add(CTR_ITEMS, count);
+        };
 
-        ++scannedRegions;
+        // Tile in spiral order, clipped to the search area, row by row
+        auto scanTile = [&](uint64_t item)
+        {
+            int tileX, tileZ;
+            spiralRegion(item, tileX, tileZ);
+            int startX = tileX * tileRegions - tileRegions / 2, startZ = tileZ * tileRegions - tileRegions / 2;
+            int rx0 = std::max(-R, startX), rx1 = std::min(R, startX + tileRegions - 1);
+            int rz0 = std::max(-R, startZ), rz1 = std::min(R, startZ + tileRegions - 1);
+            if (rx0 > rx1 || rz0 > rz1)
+                return;
 
-        int stepLen = 1;
-        while (scannedRegions < totalRegions)
+            {
+                ThreadMetrics::StageTimer timer(m, STAGE_TILE_LOAD);
+                tiles->loadTile(rx0 * regionBlocks, rz0 * regionBlocks, (rx1 + 1) * regionBlocks - 1, (rz1 + 1) * regionBlocks - 1);
+            }
+            for (int regionZ = rz0; regionZ <= rz1; ++regionZ)
+                placeLine(rx0, regionZ, 1, 0, rx1 - rx0 + 1);
+        };
+
+        // Chunk of the region spiral, walked one leg at a time where each piece of a leg is a straight line
+        auto scanSpiralChunk = [&](uint64_t item)
         {
-            for (int direction = 0; direction < 4 && scannedRegions < totalRegions; ++direction)
+            uint64_t index = item * SPIRAL_CHUNK_REGIONS;
+            const uint64_t end = std::min(totalRegions, index + SPIRAL_CHUNK_REGIONS);
+
+            // origin region
+            if (index == 0)
             {
-                for (int step = 0; step < stepLen && scannedRegions < totalRegions; ++step, ++scannedRegions)
-                {
-                    // only thread 0 prints progress (to avoid interleaving)
-                    if (tid == 0 && (scannedRegions % PRINT_PROGRESS_EVERY_REGIONS == 0))
-                    {
-                        std::lock_guard<std::mutex> lk(printMutex);
-                        printf("[PROGRESS] scanned-regions=%llu total-regions=%llu best-so-far: swamp-spawn-blocks=%d\n",
-                               scannedRegions, totalRegions, mostSwampSpawnBlocks.load());
-                    }
-
-                    regionX += dx[direction];
-                    regionZ += dy[direction];
-
-                    // modulo partitioning: only the thread that owns this index will do the heavy work
-                    if ((scannedRegions % numThreads) != tid)
-                        continue;
-
-                    getStructurePos(styp, MC_VERSION, seed, regionX, regionZ, &pos);
-
-                    int templeType = isViableTemplePos(&g, pos.x, pos.z);
-                    if (templeType == 0)
-                        continue;
-
-                    int swampSpawnBlocks = countSwampSpawnBlocks(&g, pos.x, pos.z, templeType);
-                    if (swampSpawnBlocks <= 0)
-                        continue;
-
-                    int prev = mostSwampSpawnBlocks.load(std::memory_order_relaxed);
-                    if (swampSpawnBlocks >= prev)
-                    {
-                        std::lock_guard<std::mutex> lk(logMutex);
-                        prev = mostSwampSpawnBlocks.load();
-                        if (swampSpawnBlocks >= prev)
-                        {
-                            mostSwampSpawnBlocks.store(swampSpawnBlocks);
-                            const char *templeTypeName = (templeType == 1 ? "DesertPyramid" : templeType == 2 ? "JungleTemple"
-                                                                                                              : "WitchHut");
-                            printf("[NEW BEST] type=%s swamp-spawn-blocks=%d -> /tp @p %d ~ %d\n",
-                                   templeTypeName, swampSpawnBlocks, pos.x, pos.z);
-                            if (log)
-                            {
-                                log << templeTypeName << ",\t" << pos.x << ",\t" << pos.z << ",\t" << swampSpawnBlocks << "\n";
-                                log.flush();
-                            }
-                        }
-                    }
-                }
-                if (direction % 2 == 1)
-                    ++stepLen;
+                placeLine(0, 0, 0, 0, 1);
+                ++index;
             }
+
+            while (index < end)
+            {
+                SpiralLeg l = spiralLegOf(index);
+                int direction = (int)(l.leg % 4);
+                uint64_t legCount = std::min(l.length - l.offset, end - index);
+
+                int regionX, regionZ;
+                spiralRegion(index, regionX, regionZ);
+
+                placeLine(regionX, regionZ, dx[direction], dy[direction], (int)legCount);
+
+                index += legCount;
+            }
+        };
+
+        uint64_t item;
+        while (engine.next(tid, item))
+        {
+            if (tileRegions)
+                scanTile(item);
+            else
+                scanSpiralChunk(item);
+            flush();
+
+            commit(item, done, eval.cascadeStats(), tid);
+            done.regions = 0;
+            done.results.clear();
+            done.scored.clear();
         }
     };
 
-    // spawn threads
-    std::vector<std::thread> threads;
-    threads.reserve(numThreads);
-    for (unsigned int i = 0; i < numThreads; ++i)
-        threads.emplace_back(worker, i);
+    engine.run([&](unsigned int tid)
+               { withTempleTypes(opt.templeTypes, [&](auto templeTypes)
+                                 { worker(tid, templeTypes); }); });
 
-    for (auto &t : threads)
-        t.join();
+    // After an interrupt, items finished behind a gap were never committed
+    for (auto &[item, done] : pendingItems)
+    {
+        for (const LocationResult &r : done.results)
+            results.submit(0, {(int64_t)seed, r.swampSpawnBlocks, 1, {{r.type, r.swampSpawnBlocks, r.x, r.z}}});
+        if (clusters)
+            for (const LocationResult &r : done.scored)
+                clusters->add({r.type, r.swampSpawnBlocks, r.x, r.z});
+        scannedRegions += done.regions;
+    }
+    if (clusters)
+        clusters->finish(reportCluster);
 
-    printf("Done. best-so-far swamp-spawn-blocks=%d\n", mostSwampSpawnBlocks.load());
+    results.stop();
+    metrics.stop();
+
+    FoundResult best;
+    results.bestResult(best);
+    printf("Done. best-so-far swamp-spawn-blocks=%d\n", best.score);
+
+    TempleCluster bestCluster;
+    if (clusters)
+    {
+        clusterResults->stop();
+        printf("[CLUSTERS] pairs=%" PRIu64 " triples=%" PRIu64 " quads=%" PRIu64 " peak-tracked-temples=%zu\n",
+               clusters->clusters(2), clusters->clusters(3), clusters->clusters(4), clusters->peakTemples());
+        if (clusters->bestCluster(bestCluster))
+            printf("[CLUSTERS] best: temples=%d swamp-spawn-blocks=%d afk -> /tp @p %d ~ %d\n",
+                   bestCluster.result.count, bestCluster.result.score, bestCluster.afk.x, bestCluster.afk.z);
+    }
+
+    if (summary)
+    {
+        summary->items = scannedRegions;
+        summary->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    if (summary && clusters)
+    {
+        summary->clusters = clusters->clusters(2) + clusters->clusters(3) + clusters->clusters(4);
+        if (clusters->bestCluster(bestCluster))
+        {
+            summary->bestClusterScore = bestCluster.result.score;
+            summary->bestClusterTemples = bestCluster.result.count;
+        }
+    }
+    if (summary && results.bestResult(best))
+    {
+        summary->bestSeed = best.seed;
+        summary->bestScore = best.score;
+        summary->bestX = best.temples[0].x;
+        summary->bestZ = best.temples[0].z;
+        summary->bestType = best.temples[0].type;
+    }
     return 0;
 }
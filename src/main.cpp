@@ -2,25 +2,107 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <seedfinder.hpp>
 #include <string>
-
-int run_seed_finder(uint64_t startSeed);
-int run_quad_temple_finder(uint64_t startSeed);
-int run_location_finder(uint64_t startSeed);
+#include <task_engine.hpp>
 
 static void print_usage(const char *prog)
 {
-    std::cerr << "Usage: " << prog << " <finder> [startSeed]\n";
+    std::cerr << "Usage: " << prog << " <finder> [startSeed] [options]\n";
+    std::cerr << "       " << prog << " results <file.bin>... [--sort score|seed] [--top k] [--csv file] [--out file]\n";
+    std::cerr << "       " << prog << " serve [--socket path] [options]\n";
+    std::cerr << "       " << prog << " render <file.bin>... [--top k] [--size blocks] [--format png|ppm] [--out dir]\n";
     std::cerr << "Finders: seed  (seed finder), quad (quad temple finder), loc (location finder)\n";
+    std::cerr << "Serve: keeps workers with set-up generators and answers requests, one per line:\n";
+    std::cerr << "  area <seed>[,<seed>...] <x0> <z0> <x1> <z1> [minScore]   temples in a block rectangle\n";
+    std::cerr << "  temple <seed>[,<seed>...] <x> <z>                        temple of the region of a block\n";
+    std::cerr << "  --socket <path>           listen on a Unix socket instead of stdin/stdout\n";
+    std::cerr << "Options (seed and quad):\n";
+    std::cerr << "  --shard i/N               only search items where (item - startSeed) % N == i\n";
+    std::cerr << "  --siblings                seed: for each structure seed (lower 48 bits) all its 65536 upper 16 bits\n";
+    std::cerr << "  --checkpoint <file>       save progress to <file> and resume from it if it exists\n";
+    std::cerr << "  --checkpoint-every <sec>  seconds between checkpoint writes (default 60)\n";
+    std::cerr << "  --base-order <order>      quad: ranked (best bases first, default) or index\n";
+    std::cerr << "Options (loc):\n";
+    std::cerr << "  --tile-regions <n>        scan n x n region tiles, 0 for the plain region spiral (default 32)\n";
+    std::cerr << "  --clusters                also find 2 to 4 temples sharing one AFK sphere, to logs/location_clusters.*\n";
+    std::cerr << "Options (all):\n";
+    std::cerr << "  --threads <n>             worker threads (default one per hardware thread)\n";
+    std::cerr << "  --pin                     pin workers to CPUs, one per physical core before SMT siblings\n";
+    std::cerr << "  --types <list>            temple types to search, comma separated desert,jungle,witch or all (default all)\n";
+    std::cerr << "  --radius <blocks>         search radius of the seed and loc finders (default 65536 and the whole world)\n";
+    std::cerr << "  --query-y <y>             height of the biome queries (default 64)\n";
+    std::cerr << "  --batch <n>               candidates per pipeline batch (seed and loc, default 1024)\n";
+    std::cerr << "  --progress-every <n>      seeds, quad bases or regions between progress lines\n";
+    std::cerr << "  --top-k <n>               results kept overall and per temple type, ties included (default 16)\n";
+    std::cerr << "  --results <file>          binary result file to append to (default logs/<finder>.bin)\n";
+    std::cerr << "  --histogram-bin <w>       score histogram bin width, 0 to disable (default 16)\n";
+    std::cerr << "  --metrics <file>          write counters, stage times, rates and ETA to <file>\n";
+    std::cerr << "  --metrics-format <fmt>    jsonl (append one line per snapshot) or prom (Prometheus text file)\n";
+    std::cerr << "  --metrics-every <sec>     seconds between metrics snapshots (default 10)\n";
     std::cerr << "Examples:\n";
     std::cerr << "  " << prog << " seed 0\n";
     std::cerr << "  " << prog << " quad 123456789\n";
+    std::cerr << "  " << prog << " quad 0 --shard 1/4 --checkpoint quad-1.ckpt\n";
+    std::cerr << "  " << prog << " seed 0 --types witch --radius 16384\n";
+    std::cerr << "  " << prog << " seed 28257 --siblings --checkpoint siblings.ckpt\n";
+    std::cerr << "  " << prog << " loc 123456789 --metrics loc.prom --metrics-format prom\n";
+    std::cerr << "  " << prog << " results quad-*.bin --top 100 --csv best.csv\n";
+    std::cerr << "  " << prog << " render logs/location_finder.bin --top 1000 --out renders\n";
+}
+
+static bool parse_i64(const char *s, int64_t &out)
+{
+    char *endptr = nullptr;
+    out = (int64_t)strtoll(s, &endptr, 10);
+    return endptr && endptr != s && *endptr == '\0';
+}
+
+// "desert,jungle,witch" (any subset) or "all" to a TempleType mask
+static bool parse_temple_types(const std::string &s, int &out)
+{
+    out = 0;
+    size_t begin = 0;
+    while (begin <= s.size())
+    {
+        size_t end = s.find(',', begin);
+        if (end == std::string::npos)
+            end = s.size();
+        std::string name = s.substr(begin, end - begin);
+        if (name == "desert")
+            out |= TT_DESERT;
+        else if (name == "jungle")
+            out |= TT_JUNGLE;
+        else if (name == "witch")
+            out |= TT_WITCH;
+        else if (name == "all")
+            out |= TT_DESERT | TT_JUNGLE | TT_WITCH;
+        else
+            return false;
+        begin = end + 1;
+    }
+    return out != 0;
+}
+
+static bool parse_shard(const std::string &s, FinderOptions &opt)
+{
+    size_t slash = s.find('/');
+    uint64_t index = 0, count = 0;
+    if (slash == std::string::npos ||
+        !parse_u64(s.substr(0, slash).c_str(), index) || !parse_u64(s.substr(slash + 1).c_str(), count))
+        return false;
+    if (count == 0 || count > UINT32_MAX || index >= count)
+        return false;
+
+    opt.shardIndex = (uint32_t)index;
+    opt.shardCount = (uint32_t)count;
+    return true;
 }
 
 int main(int argc, char **argv)
 {
     std::string finder = "seed";
-    uint64_t startSeed = 0;
+    FinderOptions opt;
 
     if (argc >= 2)
     {
@@ -35,29 +117,158 @@ int main(int argc, char **argv)
         }
     }
 
-    if (argc >= 3)
+    if (finder == "results")
+        return run_results_tool(argv[0], std::vector<std::string>(argv + 2, argv + argc));
+    if (finder == "render")
+        return run_render_tool(argv[0], std::vector<std::string>(argv + 2, argv + argc));
+
+    int argi = 2;
+    if (argc > argi && strncmp(argv[argi], "--", 2) != 0)
     {
-        char *endptr = nullptr;
-        startSeed = (uint64_t)strtoull(argv[2], &endptr, 10);
-        if (endptr && *endptr != '\0')
+        if (!parse_u64(argv[argi], opt.startSeed))
         {
-            std::cerr << "Invalid seed: " << argv[2] << "\n";
+            std::cerr << "Invalid seed: " << argv[argi] << "\n";
             print_usage(argv[0]);
             return 2;
         }
+        ++argi;
     }
 
+    for (; argi < argc; ++argi)
+    {
+        std::string arg = argv[argi];
+        const char *value = argi + 1 < argc ? argv[argi + 1] : nullptr;
+        uint64_t number = 0;
+        int64_t signedNumber = 0;
+
+        if (arg == "--shard" && value && parse_shard(value, opt))
+        {
+            ++argi;
+        }
+        else if (arg == "--threads" && value && parse_u64(value, number) && number > 0 && number <= 4096)
+        {
+            opt.threads = (unsigned int)number;
+            ++argi;
+        }
+        else if (arg == "--pin")
+        {
+            opt.pinThreads = true;
+        }
+        else if (arg == "--siblings")
+        {
+            opt.siblingOrder = true;
+        }
+        else if (arg == "--clusters")
+        {
+            opt.clusters = true;
+        }
+        else if (arg == "--checkpoint" && value)
+        {
+            opt.checkpointPath = value;
+            ++argi;
+        }
+        else if (arg == "--checkpoint-every" && value && parse_u64(value, number) && number > 0)
+        {
+            opt.checkpointEverySeconds = (unsigned int)number;
+            ++argi;
+        }
+        else if (arg == "--base-order" && value && (std::string(value) == "ranked" || std::string(value) == "index"))
+        {
+            opt.rankedBases = std::string(value) == "ranked";
+            ++argi;
+        }
+        else if (arg == "--tile-regions" && value && parse_u64(value, number) && number <= MAX_TILE_REGIONS)
+        {
+            opt.tileRegions = (unsigned int)number;
+            ++argi;
+        }
+        else if (arg == "--types" && value && parse_temple_types(value, opt.templeTypes))
+        {
+            ++argi;
+        }
+        else if (arg == "--radius" && value && parse_u64(value, number) && number >= 512 && number <= 30000000)
+        {
+            opt.areaRadiusBlocks = (unsigned int)number;
+            ++argi;
+        }
+        else if (arg == "--query-y" && value && parse_i64(value, signedNumber) && signedNumber >= -64 && signedNumber <= 320)
+        {
+            opt.queryY = (int)signedNumber;
+            ++argi;
+        }
+        else if (arg == "--batch" && value && parse_u64(value, number) && number > 0 && number <= MAX_BATCH_SIZE)
+        {
+            opt.batchSize = (unsigned int)number;
+            ++argi;
+        }
+        else if (arg == "--progress-every" && value && parse_u64(value, number) && number > 0)
+        {
+            opt.progressEvery = number;
+            ++argi;
+        }
+        else if (arg == "--top-k" && value && parse_u64(value, number) && number > 0 && number <= MAX_TOP_K)
+        {
+            opt.topK = (unsigned int)number;
+            ++argi;
+        }
+        else if (arg == "--results" && value)
+        {
+            opt.resultsPath = value;
+            ++argi;
+        }
+        else if (arg == "--histogram-bin" && value && parse_u64(value, number) && number <= 1000000)
+        {
+            opt.histogramBinWidth = (unsigned int)number;
+            ++argi;
+        }
+        else if (arg == "--socket" && value)
+        {
+            opt.socketPath = value;
+            ++argi;
+        }
+        else if (arg == "--metrics" && value)
+        {
+            opt.metricsPath = value;
+            ++argi;
+        }
+        else if (arg == "--metrics-format" && value && (std::string(value) == "jsonl" || std::string(value) == "prom"))
+        {
+            opt.metricsFormat = value;
+            ++argi;
+        }
+        else if (arg == "--metrics-every" && value && parse_u64(value, number) && number > 0)
+        {
+            opt.metricsEverySeconds = (unsigned int)number;
+            ++argi;
+        }
+        else
+        {
+            std::cerr << "Invalid option: " << arg << "\n";
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Ctrl-C stops the workers after their current item, the finder then
+    // saves its checkpoint and results as usual
+    installInterruptHandler();
+
+    int rc = 0;
     if (finder == "seed" || finder == "seed_finder" || finder == "seedfinder")
     {
-        return run_seed_finder(startSeed);
+        rc = run_seed_finder(opt);
     }
     else if (finder == "quad" || finder == "quad_temple")
     {
-        return run_quad_temple_finder(startSeed);
+        rc = run_quad_temple_finder(opt);
     }
     else if (finder == "loc" || finder == "location")
     {
-        return run_location_finder(startSeed);
+        rc = run_location_finder(opt);
+    }
+    else if (finder == "serve")
+    {
+        rc = run_query_server(opt);
     }
     else
     {
@@ -65,4 +276,5 @@ int main(int argc, char **argv)
         print_usage(argv[0]);
         return 2;
     }
+    return rc == 0 && interruptRequested.load() ? 130 : rc;
 }
@@ -1,145 +1,252 @@
+#include <candidate_pipeline.hpp>
+#include <checkpoint.hpp>
 #include <finder_utils.hpp>
+#include <metrics.hpp>
+#include <quad_base_cache.hpp>
+#include <quad_base_order.hpp>
+#include <result_collector.hpp>
+#include <seed_lanes.hpp>
+#include <seedfinder.hpp>
+#include <structure_batch.hpp>
 
 int check(uint64_t s48, void *data)
 {
     const StructureConfig sconf = *(const StructureConfig *)data;
-    return isQuadBase(sconf, s48 - sconf.salt, 148);
+    return isQuadBase(sconf, s48 - sconf.salt, QUAD_BASE_RADIUS);
 }
 
-int run_quad_temple_finder(uint64_t startIndex = 0)
+int run_quad_temple_finder(const FinderOptions &opt, FinderSummary *summary)
 {
     int styp = Desert_Pyramid;
-
-    std::ofstream log("logs/quad_temple_finder.log", std::ios::app);
-    if (!log)
-        fprintf(stderr, "Failed to open log file 'logs/quad_temple_finder.log'\n");
-    else
-        log << "\n\nseed, total_swamp_blocks\n";
+    const auto startTime = std::chrono::steady_clock::now();
 
     uint64_t basecnt = 0;
-    uint64_t *bases = NULL;
-    int threads = std::max(1u, std::thread::hardware_concurrency());
-    Generator g;
+    const uint64_t *bases = NULL;
+    uint64_t *found = NULL; // owned result of searchAll48
+    QuadBaseCache cache;    // or the bases mapped from the cache file
+    int threads = opt.threads ? (int)opt.threads : (int)std::max(1u, std::thread::hardware_concurrency());
 
     StructureConfig sconf;
     getStructureConfig(styp, MC_VERSION, &sconf);
 
-    printf("Preparing seed bases...\n");
+    // low20QuadIdeal, low20QuadClassic, low20QuadHutBarely
+    const uint64_t *lowBits = low20QuadIdeal;
+    const int lowBitN = 20;
+    const QuadBaseKey key = quadBaseKey(MC_VERSION, sconf, QUAD_BASE_RADIUS, lowBits, lowBitN);
+    const std::string cachePath = quadBaseCachePath(key);
 
-    // https://github.com/Cubitect/cubiomes?tab=readme-ov-file#quad-witch-huts
-    int err = searchAll48(&bases, &basecnt, NULL, threads,
-                          low20QuadIdeal, 20, check, &sconf, NULL); // low20QuadIdeal, low20QuadClassic, low20QuadHutBarely
-
-    if (err || !bases)
+    if (!opt.quadBases.empty())
+    {
+        bases = opt.quadBases.data();
+        basecnt = opt.quadBases.size();
+    }
+    else if (cache.open(cachePath, key))
     {
-        printf("Failed to generate seed bases.\n");
-        exit(1);
+        bases = cache.bases();
+        basecnt = cache.count();
+        printf("Loaded %" PRIu64 " seed bases from %s.\n\n", basecnt, cachePath.c_str());
     }
     else
     {
-        printf("Found %" PRIu64 " seed bases.\n\n", basecnt);
+        printf("Preparing seed bases...\n");
+
+        // https://github.com/Cubitect/cubiomes?tab=readme-ov-file#quad-witch-huts
+        // Bases come out sorted for any thread count, so indices are stable across shards and restarts
+        int err = searchAll48(&found, &basecnt, NULL, threads,
+                              lowBits, lowBitN, check, &sconf, NULL);
+
+        if (err || !found)
+        {
+            printf("Failed to generate seed bases.\n");
+            exit(1);
+        }
+        else
+        {
+            printf("Found %" PRIu64 " seed bases.\n\n", basecnt);
+        }
+        bases = found;
+
+        // Later launches, shards and resumed runs map the list instead
+        if (!saveQuadBases(cachePath, key, found, basecnt))
+            fprintf(stderr, "Failed to write quad base cache '%s'\n", cachePath.c_str());
+    }
+
+    // Items are positions in the ranked order, indices into bases otherwise
+    std::vector<uint64_t> order;
+    if (opt.rankedBases)
+    {
+        const auto rankStart = std::chrono::steady_clock::now();
+        order = rankQuadBases(sconf, bases, basecnt, opt.templeTypes);
+        if (basecnt)
+        {
+            const QuadBaseRank first = rankQuadBase(sconf, bases[order[0]], opt.templeTypes);
+            printf("[ORDER] ranked %" PRIu64 " bases in %.2fs, first: index=%" PRIu64 " blocks-in-reach=%d radius=%.1f\n", basecnt,
+                   std::chrono::duration<double>(std::chrono::steady_clock::now() - rankStart).count(), order[0],
+                   first.blocksInReach, first.radius);
+        }
     }
 
-    std::mutex bestMutex;
-    int bestArea = 0;
+    Checkpoint cp;
+    if (!resumeCheckpoint(opt, opt.rankedBases ? "quad-ranked" : "quad", basecnt, cp))
+        return 2;
 
     const uint64_t numThreads =
         std::max<uint64_t>(1, std::min<uint64_t>((uint64_t)threads, basecnt));
-    std::atomic<uint64_t> nextIndex(startIndex);
+
+    // Base indices of this shard are handed out as tickets, see shardItem()
+    uint64_t ticketCount = shardTicketCount(opt, basecnt);
+    if (opt.maxItems)
+        ticketCount = std::min(ticketCount, cp.frontier + opt.maxItems);
+    TaskEngine engine((unsigned int)numThreads, cp.frontier, ticketCount, opt.pinThreads);
+    PeriodicCheckpoint checkpoint(opt, cp);
     std::atomic<uint64_t> processedBases(0);
-    const uint64_t printProgressEvery = 32;
+    FinderMetrics metrics(opt, "quad", (unsigned int)numThreads, ticketCount - std::min(ticketCount, cp.frontier));
 
-    std::vector<std::thread> workers;
-    workers.reserve(numThreads);
+    // Results go through per-worker rings to the collector, its threshold prunes quads from their 1:4 bounds
+    ResultCollector results(opt, RF_QUAD, "logs/quad_temple_finder.log", "\n\nseed, total_swamp_blocks\n",
+                            "logs/quad_temple_finder.bin", "logs/quad_temple_finder_histogram.csv", (unsigned int)numThreads, &metrics);
+    if (cp.bestScore >= 0)
+        results.restore({cp.bestSeed, cp.bestScore, 0, {}});
 
-    for (unsigned int tid = 0; tid < numThreads; ++tid)
+    auto fillBest = [&](Checkpoint &c)
     {
-        workers.emplace_back([tid, numThreads, basecnt, bases, styp, &sconf, &bestMutex, &bestArea, &log, &nextIndex, &processedBases, printProgressEvery]()
-                             {
-            Generator g;
-            setupGenerator(&g, MC_VERSION, 0);
-
-            for (;;)
+        // Results of the bases below the frontier must be in the checkpoint
+        results.sync();
+        FoundResult best;
+        if (!results.bestResult(best))
+            return;
+        c.bestSeed = best.seed;
+        c.bestScore = best.score;
+    };
+    const uint64_t printProgressEvery = opt.progressEvery ? opt.progressEvery : 32;
+
+    // Worker lambda, instantiated for the temple types of the search
+    auto worker = [bases, &order, &opt, &sconf, &results, &engine, &checkpoint, &fillBest, &processedBases, &metrics, printProgressEvery](unsigned int tid, auto templeTypes)
+    {
+        Generator g;
+        setupGenerator(&g, MC_VERSION, 0);
+        ThreadMetrics *m = metrics.worker(tid);
+        FixedTempleEvaluatorFor<decltype(templeTypes)::value> eval(&g, opt.queryY);
+        eval.setMetrics(m);
+        SeedLaneFilter lanes(opt.templeTypes);
+        lanes.setMetrics(m);
+
+        // The 4 temples of a seed are one group: they go through the
+        // remaining stages together and are dropped as soon as one fails
+        CandidatePipeline<decltype(eval)> pipeline(eval, 4, 4);
+        pipeline.setMetrics(m);
+
+        for (;;)
+        {
+            uint64_t ticket;
+            if (!engine.next(tid, ticket))
+                break;
+
+            uint64_t i = shardItem(opt, ticket);
+            if (!order.empty())
+                i = order[i];
+
+            uint64_t s48 = moveStructure(bases[i] - sconf.salt, -1, -1);
+
+            // Regions (-1,-1), (-1,0), (0,-1), (0,0) as two columns of the 2x2 tile
+            int tileX[4], tileZ[4];
+            pipeline.clear();
+            pipeline.place(sconf, s48, -1, -1, 0, 1, 2);
+            pipeline.place(sconf, s48, 0, -1, 0, 1, 2);
+            for (int j = 0; j < 4; ++j)
             {
-                uint64_t i = nextIndex.fetch_add(1, std::memory_order_relaxed);
-                if (i >= basecnt)
-                    break;
-
-                uint64_t s48 = moveStructure(bases[i] - sconf.salt, -1, -1);
+                tileX[j] = pipeline.xs(0)[j];
+                tileZ[j] = pipeline.zs(0)[j];
+            }
+            lanes.setPositions(tileX, tileZ, 4);
 
-                Pos pos[4];
-                getStructurePos(styp, MC_VERSION, s48, -1, -1, &pos[0]);
-                getStructurePos(styp, MC_VERSION, s48, -1, 0, &pos[1]);
-                getStructurePos(styp, MC_VERSION, s48, 0, -1, &pos[2]);
-                getStructurePos(styp, MC_VERSION, s48, 0, 0, &pos[3]);
+            for (uint64_t high = 0; high < 0x10000; high += SEED_LANES)
+            {
+                // Coarse stages for a batch of upper bits at once, only the survivors are generated one by one
+                uint64_t seeds[SEED_LANES];
+                for (int k = 0; k < SEED_LANES; ++k)
+                    seeds[k] = s48 | ((high + k) << 48);
+                const uint32_t survivors = lanes.filter(seeds);
 
-                for (uint64_t high = 0; high < 0x10000; ++high)
+                for (int k = 0; k < SEED_LANES; ++k)
                 {
-                    uint64_t seed = s48 | (high << 48);
-                    applySeed(&g, DIM_OVERWORLD, seed);
-
-                    int templeTypes[4];
-                    for (int j = 0; j < 4; ++j)
-                        templeTypes[j] = isViableTemplePos(&g, pos[j].x, pos[j].z);
+                    if (!(survivors & (1u << k)))
+                        continue;
 
-                    // Continue next cycle if not all 4 spawned
-                    if (!(templeTypes[0] &&
-                        templeTypes[1] &&
-                        templeTypes[2] &&
-                        templeTypes[3]))
+                    uint64_t seed = seeds[k];
                     {
-                        continue;
+                        ThreadMetrics::StageTimer timer(m, STAGE_APPLY_SEED);
+                        applySeed(&g, DIM_OVERWORLD, seed);
                     }
 
-                    int swampSpawnBlocksTotal = 0;
+                    // Remaining coarse stages and the 1:1 pass for all 4 temples. Continue next
+                    // cycle if not all 4 spawn or they cannot beat the best so far.
+                    pipeline.clear();
                     for (int j = 0; j < 4; ++j)
-                        swampSpawnBlocksTotal += countSwampSpawnBlocks(&g, pos[j].x, pos[j].z, templeTypes[j]);
-
-                    if (swampSpawnBlocksTotal <= 0)
+                        pipeline.add(tileX[j], tileZ[j]);
+                    const int minScore = results.threshold();
+                    if (pipeline.run(minScore, SEED_LANE_RESUME_STAGE) == 0)
                         continue;
 
-                    {
-                        std::lock_guard<std::mutex> lock(bestMutex);
-                        if (swampSpawnBlocksTotal >= bestArea)
-                        {
-                            bestArea = swampSpawnBlocksTotal;
-                            printf("[NEW BEST] seed=%" PRId64 ", swamp-spawn-blocks=%d\n", (int64_t)seed, swampSpawnBlocksTotal);
-                            for (int j = 0; j < 4; ++j)
-                            {
-                                const char *typeName = (templeTypes[j] == 1 ? "DesertPyramid" : templeTypes[j] == 2 ? "JungleTemple"
-                                                                                                                    : "WitchHut");
-                                printf("\t%s, %d: '/tp @p %d ~ %d'\n", typeName, countSwampSpawnBlocks(&g, pos[j].x, pos[j].z, templeTypes[j]), pos[j].x, pos[j].z);
-                            }
-
-                            if (log)
-                            {
-                                log << (int64_t)seed << ", " << swampSpawnBlocksTotal << "\n";
-                                for (int j = 0; j < 4; ++j)
-                                {
-                                    const char *typeName = (templeTypes[j] == 1 ? "DesertPyramid" : templeTypes[j] == 2 ? "JungleTemple"
-                                                                                                                        : "WitchHut");
-                                    log << "\t" << typeName << " - " << countSwampSpawnBlocks(&g, pos[j].x, pos[j].z, templeTypes[j]) << ": " << pos[j].x << ", " << pos[j].z << "\n";
-                                }
-                                log.flush();
-                            }
-                        }
-                    }
-                }
+                    const int swampSpawnBlocksTotal = pipeline.total(0);
+                    results.recordScore(tid, swampSpawnBlocksTotal);
+                    if (swampSpawnBlocksTotal < minScore)
+                        continue;
 
-                uint64_t done = processedBases.fetch_add(1, std::memory_order_relaxed) + 1;
-                if (done % printProgressEvery == 0)
-                {
-                    std::lock_guard<std::mutex> lock(bestMutex);
-                    printf("[PROGRESS] worker=%u processed-bases=%llu best-so-far swamp-spawn-blocks=%d\n",
-                        tid, (unsigned long long)done, bestArea);
-                    fflush(stdout);
+                    const TempleScore *temples = pipeline.templeScores(0);
+                    FoundResult found = {(int64_t)seed, swampSpawnBlocksTotal, 4, {}};
+                    for (int j = 0; j < 4; ++j)
+                        found.temples[j] = {temples[j].type, temples[j].swampSpawnBlocks, tileX[j], tileZ[j]};
+                    results.submit(tid, found);
                 }
-            } });
-    }
-
-    for (auto &th : workers)
-        th.join();
+            }
 
+            m->add(CTR_ITEMS);
+            uint64_t done = processedBases.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (done % printProgressEvery == 0)
+            {
+                FoundResult best;
+                results.bestResult(best);
+                printf("[PROGRESS] worker=%u processed-bases=%llu best-so-far swamp-spawn-blocks=%d\n",
+                    tid, (unsigned long long)done, best.score);
+                CascadeStats cascade = lanes.cascadeStats();
+                cascade += eval.cascadeStats();
+                printf("[CASCADE] worker=%u rejected: %s\n", tid, formatCascadeStats(cascade).c_str());
+                fflush(stdout);
+            }
+
+            checkpoint.maybeSave(engine, fillBest);
+        }
+    };
+
+    engine.run([&](unsigned int tid)
+               { withTempleTypes(opt.templeTypes, [&](auto templeTypes)
+                                 { worker(tid, templeTypes); }); });
+
+    checkpoint.maybeSave(engine, fillBest, true);
+    results.stop();
+    metrics.stop();
+    double secondsToBest;
+    uint64_t basesToBest;
+    metrics.timeToBest(secondsToBest, basesToBest);
+    if (secondsToBest >= 0)
+        printf("[ORDER] base-order=%s time-to-best=%.2fs bases-to-best=%" PRIu64 "/%" PRIu64 "\n", opt.rankedBases ? "ranked" : "index",
+               secondsToBest, basesToBest, processedBases.load());
     printf("Done.\n");
+    free(found);
+
+    FoundResult best;
+    if (summary)
+    {
+        summary->items = processedBases.load();
+        summary->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        summary->secondsToBest = secondsToBest;
+        summary->itemsToBest = basesToBest;
+    }
+    if (summary && results.bestResult(best))
+    {
+        summary->bestSeed = best.seed;
+        summary->bestScore = best.score;
+    }
     return 0;
 }
@@ -0,0 +1,610 @@
+#include <candidate_pipeline.hpp>
+#include <finder_utils.hpp>
+#include <layer_cache.hpp>
+#include <seedfinder.hpp>
+#include <task_engine.hpp>
+
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Query server: workers with set-up generators answer line requests on stdin
+// (answers on stdout) or on a Unix socket, one connection per client.
+//
+//   area <seed>[,<seed>...] <x0> <z0> <x1> <z1> [minScore]
+//       every temple with its origin in the block rectangle, per seed
+//   temple <seed>[,<seed>...] <x> <z>
+//       the temple of the region holding block (x, z), per seed, also when
+//       it cannot spawn (type none), e.g. to verify logged results
+//   ping, quit
+//
+// Request n (counted from 1 per connection) answers with lines
+// "temple <n> <seed> <type> <x> <z> <swamp_spawn_blocks>" and ends with
+// "end <n> <temples>", or with a single "pong <n>" or "error <n> <message>".
+// Answers come in request order; the requests in between run in parallel.
+
+// Regions per job, larger areas are split over the workers
+constexpr uint64_t SERVE_SLICE_REGIONS = 4096;
+
+// Largest area of one request and seed, in regions
+constexpr uint64_t MAX_SERVE_REGIONS = 1ULL << 24;
+
+// Coarse layer slabs per worker, as in the seed finder
+constexpr int SERVE_LAYER_CACHE_SLABS = 4096;
+
+namespace
+{
+
+struct Connection;
+
+// Part of one request for one seed, run by one worker
+struct ServeJob
+{
+    Connection *conn;
+    uint64_t requestId;
+    int64_t seed;
+    bool area;
+    int x0, z0, x1, z1; // block rectangle (area) or block (temple)
+    int minScore;
+    uint64_t first, last; // region indices of the rectangle, row by row
+
+    std::string output;
+    uint64_t temples = 0;
+    bool done = false; // under conn->mutex
+};
+
+struct ServeRequest
+{
+    uint64_t id;
+    std::vector<std::shared_ptr<ServeJob>> jobs;
+    std::string reply; // instead of jobs
+};
+
+struct Connection
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<ServeRequest> pending;
+    bool readerDone = false;
+};
+
+// Jobs of all connections, taken by the workers in order
+class JobQueue
+{
+public:
+    void push(std::shared_ptr<ServeJob> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        ready.notify_one();
+    }
+
+    // Null once stop() was called
+    std::shared_ptr<ServeJob> pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&]
+                   { return stopped || !jobs.empty(); });
+        if (stopped)
+            return nullptr;
+        std::shared_ptr<ServeJob> job = std::move(jobs.front());
+        jobs.pop_front();
+        return job;
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        ready.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::shared_ptr<ServeJob>> jobs;
+    bool stopped = false;
+};
+
+int floorDiv(int a, int b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// False once the other end is gone (EPIPE or ECONNRESET for a socket)
+bool writeAll(int fd, const std::string &s)
+{
+    size_t off = 0;
+    while (off < s.size())
+    {
+#if defined(_WIN32)
+        int n = _write(fd, s.data() + off, (unsigned int)(s.size() - off));
+#else
+        ssize_t n = write(fd, s.data() + off, s.size() - off);
+#endif
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        off += (size_t)n;
+    }
+    return true;
+}
+
+// Reads up to size bytes, 0 at the end of the input or on an interrupt
+long readSome(int fd, char *buf, size_t size)
+{
+    for (;;)
+    {
+        if (interruptRequested.load())
+            return 0;
+#if defined(_WIN32)
+        int n = _read(fd, buf, (unsigned int)size);
+#else
+        // Wake up now and then to notice Ctrl-C, read() itself restarts
+        pollfd p = {fd, POLLIN, 0};
+        int r = poll(&p, 1, 250);
+        if (r == 0 || (r < 0 && errno == EINTR))
+            continue;
+        ssize_t n = read(fd, buf, size);
+#endif
+        if (n < 0 && errno == EINTR)
+            continue;
+        return n < 0 ? 0 : (long)n;
+    }
+}
+
+class QueryServer
+{
+public:
+    QueryServer(const FinderOptions &opt)
+        : opt(opt)
+    {
+        getStructureConfig(Desert_Pyramid, MC_VERSION, &sconf);
+        regionBlocks = sconf.regionSize * CHUNK_SIZE;
+    }
+
+    // Starts the workers and returns once all of them have set up their generators
+    void start()
+    {
+        const unsigned int numThreads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+        std::atomic<unsigned int> ready{0};
+        for (unsigned int t = 0; t < numThreads; ++t)
+        {
+            workers.emplace_back([this, &ready]()
+                                 { withTempleTypes(opt.templeTypes, [&](auto templeTypes)
+                                                   { work(templeTypes, ready); }); });
+        }
+        while (ready.load() < numThreads)
+            std::this_thread::yield();
+    }
+
+    void stop()
+    {
+        queue.stop();
+        for (auto &th : workers)
+            th.join();
+        workers.clear();
+    }
+
+    // Answers the requests read from inFd on outFd until the input ends,
+    // quit or Ctrl-C
+    void serve(int inFd, int outFd)
+    {
+        Connection conn;
+        std::thread writer([&]()
+                           { writeAnswers(conn, outFd); });
+
+        std::string buffered;
+        char chunk[65536];
+        uint64_t nextId = 1;
+        bool quit = false;
+        while (!quit)
+        {
+            size_t eol;
+            while (!quit && (eol = buffered.find('\n')) != std::string::npos)
+            {
+                std::string line = buffered.substr(0, eol);
+                buffered.erase(0, eol + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (line.find_first_not_of(" \t") == std::string::npos)
+                    continue;
+                quit = handleLine(conn, nextId++, line);
+            }
+            if (quit)
+                break;
+            long n = readSome(inFd, chunk, sizeof(chunk));
+            if (n <= 0)
+                break;
+            buffered.append(chunk, (size_t)n);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            conn.readerDone = true;
+        }
+        conn.changed.notify_all();
+        writer.join();
+    }
+
+    unsigned int workerCount() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    uint64_t requestCount() const
+    {
+        return requests.load();
+    }
+
+    uint64_t templeCount() const
+    {
+        return temples.load();
+    }
+
+private:
+    // Parses one request into jobs, true for quit
+    bool handleLine(Connection &conn, uint64_t id, const std::string &line)
+    {
+        std::istringstream in(line);
+        std::string command, seedList;
+        in >> command;
+
+        ServeRequest request;
+        request.id = id;
+        auto fail = [&](const char *message)
+        {
+            request.jobs.clear();
+            request.reply = "error " + std::to_string(id) + " " + message + "\n";
+        };
+
+        if (command == "quit")
+        {
+            return true;
+        }
+        else if (command == "ping")
+        {
+            request.reply = "pong " + std::to_string(id) + "\n";
+        }
+        else if (command == "area" || command == "temple")
+        {
+            const bool area = command == "area";
+            ServeJob base = {};
+            base.conn = &conn;
+            base.requestId = id;
+            base.area = area;
+
+            bool ok = (bool)(in >> seedList >> base.x0 >> base.z0);
+            std::string token;
+            if (area)
+            {
+                ok = ok && (bool)(in >> base.x1 >> base.z1);
+
+                // Optional, but when given it must be a whole number
+                base.minScore = 0;
+                if (ok && in >> token)
+                {
+                    char *end = nullptr;
+                    errno = 0;
+                    long minScore = strtol(token.c_str(), &end, 10);
+                    ok = end != token.c_str() && *end == '\0' && errno == 0 && minScore >= INT_MIN && minScore <= INT_MAX;
+                    base.minScore = (int)minScore;
+                }
+            }
+            ok = ok && !(in >> token);
+
+            std::vector<int64_t> seeds;
+            for (size_t pos = 0; ok && pos <= seedList.size();)
+            {
+                size_t comma = std::min(seedList.find(',', pos), seedList.size());
+                std::string s = seedList.substr(pos, comma - pos);
+                char *end = nullptr;
+                errno = 0;
+                seeds.push_back((int64_t)strtoll(s.c_str(), &end, 10));
+                ok = !s.empty() && end && *end == '\0' && errno == 0;
+                pos = comma + 1;
+            }
+
+            if (!ok)
+            {
+                fail(area ? "usage: area <seed>[,<seed>...] <x0> <z0> <x1> <z1> [minScore]"
+                          : "usage: temple <seed>[,<seed>...] <x> <z>");
+            }
+            else
+            {
+                int rx0 = floorDiv(base.x0, regionBlocks), rz0 = floorDiv(base.z0, regionBlocks);
+                int rx1 = area ? floorDiv(base.x1, regionBlocks) : rx0, rz1 = area ? floorDiv(base.z1, regionBlocks) : rz0;
+                const uint64_t regions = (rx1 >= rx0 && rz1 >= rz0) ? (uint64_t)(rx1 - rx0 + 1) * (uint64_t)(rz1 - rz0 + 1) : 0;
+                if (area && (base.x1 < base.x0 || base.z1 < base.z0))
+                    fail("empty rectangle");
+                else if (regions > MAX_SERVE_REGIONS)
+                    fail("area too large");
+                else
+                {
+                    for (int64_t seed : seeds)
+                    {
+                        for (uint64_t first = 0; first < regions; first += SERVE_SLICE_REGIONS)
+                        {
+                            auto job = std::make_shared<ServeJob>(base);
+                            job->seed = seed;
+                            job->first = first;
+                            job->last = std::min(regions, first + SERVE_SLICE_REGIONS);
+                            request.jobs.push_back(job);
+                        }
+                    }
+                }
+            }
+        }
+        else
+        {
+            fail("unknown request, expected area, temple, ping or quit");
+        }
+
+        std::vector<std::shared_ptr<ServeJob>> jobs = request.jobs;
+        {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            conn.pending.push_back(std::move(request));
+        }
+        conn.changed.notify_all();
+        for (auto &job : jobs)
+            queue.push(job);
+        ++requests;
+        return false;
+    }
+
+    // Writes the answers in request order as their jobs complete
+    void writeAnswers(Connection &conn, int outFd)
+    {
+        std::unique_lock<std::mutex> lock(conn.mutex);
+        bool writable = true;
+        for (;;)
+        {
+            conn.changed.wait(lock, [&]
+                              { return (!conn.pending.empty() && std::all_of(conn.pending.front().jobs.begin(), conn.pending.front().jobs.end(),
+                                                                             [](const std::shared_ptr<ServeJob> &j)
+                                                                             { return j->done; })) ||
+                                       (conn.pending.empty() && conn.readerDone); });
+            if (conn.pending.empty())
+                return;
+
+            ServeRequest request = std::move(conn.pending.front());
+            conn.pending.pop_front();
+            lock.unlock();
+
+            std::string out = request.reply;
+            if (out.empty())
+            {
+                uint64_t count = 0;
+                for (const auto &job : request.jobs)
+                {
+                    out += job->output;
+                    count += job->temples;
+                }
+                out += "end " + std::to_string(request.id) + " " + std::to_string(count) + "\n";
+            }
+            // A client that went away still gets its jobs drained. Its reader
+            // is woken up by the shutdown and ends the connection.
+            if (writable && !writeAll(outFd, out))
+            {
+                writable = false;
+#if !defined(_WIN32)
+                shutdown(outFd, SHUT_RDWR);
+#endif
+            }
+
+            lock.lock();
+        }
+    }
+
+    template <typename TempleTypes>
+    void work(TempleTypes, std::atomic<unsigned int> &ready)
+    {
+        Generator g;
+        setupGenerator(&g, MC_VERSION, 0);
+        CoarseLayerCache layerCache(&g, SERVE_LAYER_CACHE_SLABS);
+        TempleEvaluatorFor<TempleTypes::value> eval(&g, opt.queryY);
+        CandidatePipeline<decltype(eval)> pipeline(eval, opt.batchSize ? (int)opt.batchSize : PIPELINE_BATCH);
+        std::vector<int> rowX, rowZ;
+        ++ready;
+
+        bool seeded = false;
+        while (std::shared_ptr<ServeJob> job = queue.pop())
+        {
+            if (!seeded || g.seed != (uint64_t)job->seed)
+            {
+                applySeed(&g, DIM_OVERWORLD, (uint64_t)job->seed);
+                seeded = true;
+            }
+
+            char line[160];
+            auto emit = [&](int type, int x, int z, int score)
+            {
+                snprintf(line, sizeof(line), "temple %llu %lld %s %d %d %d\n", (unsigned long long)job->requestId,
+                         (long long)job->seed, type ? templeTypeName(type) : "none", x, z, score);
+                job->output += line;
+                ++job->temples;
+            };
+
+            if (!job->area)
+            {
+                int x, z;
+                getFeaturePosBatch(sconf, (uint64_t)job->seed, floorDiv(job->x0, regionBlocks), floorDiv(job->z0, regionBlocks), 0, 0, 1, &x, &z);
+                TempleScore t = eval.evaluate(x, z);
+                emit(t.type, x, z, t.swampSpawnBlocks);
+            }
+            else
+            {
+                auto flush = [&]()
+                {
+                    const int kept = pipeline.run(job->minScore);
+                    for (int i = 0; i < kept; ++i)
+                        if (pipeline.templeScores(i)[0].swampSpawnBlocks >= job->minScore)
+                            emit(pipeline.templeScores(i)[0].type, pipeline.xs(i)[0], pipeline.zs(i)[0], pipeline.templeScores(i)[0].swampSpawnBlocks);
+                    pipeline.clear();
+                };
+
+                // Row segments of the slice, only temples inside the rectangle are scored
+                const int rx0 = floorDiv(job->x0, regionBlocks), rz0 = floorDiv(job->z0, regionBlocks);
+                const uint64_t width = (uint64_t)(floorDiv(job->x1, regionBlocks) - rx0 + 1);
+                for (uint64_t i = job->first; i < job->last;)
+                {
+                    const int count = (int)std::min(job->last - i, width - i % width);
+                    rowX.resize(count);
+                    rowZ.resize(count);
+                    getFeaturePosBatch(sconf, (uint64_t)job->seed, rx0 + (int)(i % width), rz0 + (int)(i / width), 1, 0, count, rowX.data(), rowZ.data());
+                    for (int k = 0; k < count; ++k)
+                    {
+                        if (rowX[k] < job->x0 || rowX[k] > job->x1 || rowZ[k] < job->z0 || rowZ[k] > job->z1)
+                            continue;
+                        pipeline.add(rowX[k], rowZ[k]);
+                        if (pipeline.space() == 0)
+                            flush();
+                    }
+                    i += count;
+                }
+                flush();
+            }
+
+            temples += job->temples;
+            Connection *conn = job->conn;
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                job->done = true;
+            }
+            conn->changed.notify_all();
+        }
+    }
+
+    const FinderOptions &opt;
+    StructureConfig sconf;
+    int regionBlocks;
+    JobQueue queue;
+    std::vector<std::thread> workers;
+    std::atomic<uint64_t> requests{0}, temples{0};
+};
+
+#if !defined(_WIN32)
+// Accepts clients on a Unix socket until Ctrl-C
+int serveSocket(QueryServer &server, const std::string &path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path '%s' is too long\n", path.c_str());
+        return 2;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket left over from a previous server is replaced, anything else is kept
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path.c_str());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0 || bind(listenFd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, 16) != 0)
+    {
+        fprintf(stderr, "Failed to listen on '%s': %s\n", path.c_str(), strerror(errno));
+        if (listenFd >= 0)
+            close(listenFd);
+        return 1;
+    }
+    fprintf(stderr, "[SERVE] listening on %s\n", path.c_str());
+
+    // Connection threads are detached so finished ones do not pile up, the
+    // count of live ones lets the shutdown wait for them
+    std::mutex clientsMutex;
+    std::condition_variable clientGone;
+    unsigned int clients = 0;
+    while (!interruptRequested.load())
+    {
+        pollfd p = {listenFd, POLLIN, 0};
+        if (poll(&p, 1, 250) <= 0)
+            continue;
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            ++clients;
+        }
+        std::thread([&server, &clientsMutex, &clientGone, &clients, fd]()
+                    {
+            server.serve(fd, fd);
+            close(fd);
+
+            // Notified under the lock, the waiter may return right after
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            --clients;
+            clientGone.notify_all(); })
+            .detach();
+    }
+
+    // The clients notice the interrupt within a poll interval
+    {
+        std::unique_lock<std::mutex> lock(clientsMutex);
+        clientGone.wait(lock, [&]
+                        { return clients == 0; });
+    }
+    close(listenFd);
+    unlink(path.c_str());
+    return 0;
+}
+#endif
+
+} // namespace
+
+int run_query_server(const FinderOptions &opt, int inFd, int outFd)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+#if !defined(_WIN32)
+    // Writing to a client that already closed its socket fails with EPIPE
+    // instead of killing the whole server
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    QueryServer server(opt);
+    server.start();
+    fprintf(stderr, "[SERVE] %u workers ready in %.1f ms\n", server.workerCount(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+
+    int rc = 0;
+    if (opt.socketPath.empty())
+    {
+        server.serve(inFd, outFd);
+    }
+    else
+    {
+#if defined(_WIN32)
+        fprintf(stderr, "Unix sockets are not supported on this platform, serve on stdin instead\n");
+        rc = 2;
+#else
+        rc = serveSocket(server, opt.socketPath);
+#endif
+    }
+
+    server.stop();
+    fprintf(stderr, "[SERVE] requests=%llu temples=%llu uptime=%.1fs\n", (unsigned long long)server.requestCount(),
+            (unsigned long long)server.templeCount(), std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    return rc;
+}
@@ -0,0 +1,208 @@
+#include <biome_render.hpp>
+#include <result_file.hpp>
+#include <seedfinder.hpp>
+#include <task_engine.hpp>
+
+#include <atomic>
+#include <cinttypes>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Images between progress lines
+constexpr uint64_t RENDER_PROGRESS_EVERY = 1000;
+
+static void print_render_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s render <file.bin>... [options]\n", prog);
+    fprintf(stderr, "Renders the 1:1 biomes around the results of binary result files (logs/*.bin): swamp in\n");
+    fprintf(stderr, "bright green, temple footprints white in swamp and red outside, the AFK sphere of groups\n");
+    fprintf(stderr, "in yellow. The swamp spawn blocks of every temple are checked against the image.\n");
+    fprintf(stderr, "  --top <k>                 only the k results with the best totals\n");
+    fprintf(stderr, "  --size <blocks>           side of each image, one pixel per block (default %d)\n", RENDER_SIZE);
+    fprintf(stderr, "  --format <png|ppm>        image format (default png)\n");
+    fprintf(stderr, "  --out <dir>               directory of the images (default renders)\n");
+    fprintf(stderr, "  --threads <n>             worker threads (default one per hardware thread)\n");
+}
+
+// Image being filled by the workers, one tile each. The worker finishing the
+// last tile colors and writes it.
+struct RenderCanvas
+{
+    std::vector<int> biomes;
+    std::atomic<int> tilesLeft{0};
+};
+
+int run_render_tool(const char *prog, const std::vector<std::string> &args)
+{
+    std::vector<std::string> paths;
+    ResultQuery query;
+    std::string outDir = "renders", format = "png";
+    size_t size = RENDER_SIZE, threads = 0;
+
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        const std::string &arg = args[i];
+        const char *value = i + 1 < args.size() ? args[i + 1].c_str() : nullptr;
+
+        if (arg == "--top" && value && parse_count(value, query.topK) && query.topK > 0)
+        {
+            ++i;
+        }
+        else if (arg == "--size" && value && parse_count(value, size) && size >= 16 && size <= 8192)
+        {
+            ++i;
+        }
+        else if (arg == "--format" && value && (std::string(value) == "png" || std::string(value) == "ppm"))
+        {
+            format = value;
+            ++i;
+        }
+        else if (arg == "--out" && value)
+        {
+            outDir = value;
+            ++i;
+        }
+        else if (arg == "--threads" && value && parse_count(value, threads) && threads <= 1024)
+        {
+            ++i;
+        }
+        else if (arg.rfind("--", 0) != 0)
+        {
+            paths.push_back(arg);
+        }
+        else
+        {
+            fprintf(stderr, "Invalid option: %s\n", arg.c_str());
+            print_render_usage(prog);
+            return 2;
+        }
+    }
+    if (paths.empty())
+    {
+        print_render_usage(prog);
+        return 2;
+    }
+
+    std::vector<MappedResultFile> files(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (!files[i].open(paths[i]))
+            return 1;
+        if (files[i].header().mcVersion != MC_VERSION)
+        {
+            fprintf(stderr, "'%s' is from mc version %d, this build renders %d\n", paths[i].c_str(), files[i].header().mcVersion, MC_VERSION);
+            return 1;
+        }
+    }
+
+    // Results from their records, the temples of a result are consecutive
+    std::vector<FoundResult> hits;
+    std::vector<uint8_t> finders;
+    for (const ResultRecord *r : selectResults(files, query))
+    {
+        if (r->index == 0)
+        {
+            hits.push_back({r->seed, r->total, 0, {}});
+            finders.push_back(r->finder);
+        }
+        if (!hits.empty() && hits.back().count < 4)
+            hits.back().temples[hits.back().count++] = {r->type, r->score, r->x, r->z};
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(outDir, ec);
+    if (ec)
+    {
+        fprintf(stderr, "Failed to create '%s': %s\n", outDir.c_str(), ec.message().c_str());
+        return 1;
+    }
+
+    // One ticket per tile of every image. Workers run their tickets in order,
+    // so only the images at the front of each worker are held at once.
+    const int imageSize = (int)size;
+    const int tiles = RenderArea{0, 0, imageSize}.tiles();
+    const unsigned int numThreads = threads ? (unsigned int)threads : std::max(1u, std::thread::hardware_concurrency());
+    printf("[RENDER] images=%zu size=%dx%d tiles=%d threads=%u -> %s\n", hits.size(), imageSize, imageSize, tiles, numThreads, outDir.c_str());
+
+    installInterruptHandler();
+    const auto startTime = std::chrono::steady_clock::now();
+    TaskEngine engine(numThreads, 0, hits.size() * (uint64_t)tiles);
+
+    std::mutex canvasMutex; // protects the fields below
+    std::map<uint64_t, std::unique_ptr<RenderCanvas>> canvases;
+    size_t peakCanvases = 0;
+    std::atomic<uint64_t> written{0}, mismatched{0}, failed{0};
+
+    engine.run([&](unsigned int tid)
+               {
+        Generator g;
+        setupGenerator(&g, MC_VERSION, 0);
+        std::vector<int> cache(getMinCacheSize(&g, 1, RENDER_TILE, 1, RENDER_TILE));
+        std::vector<unsigned char> rgb;
+        bool seeded = false;
+
+        uint64_t ticket;
+        while (engine.next(tid, ticket))
+        {
+            const uint64_t hit = ticket / tiles;
+            const FoundResult &r = hits[hit];
+            const RenderArea area = renderArea(r, imageSize);
+
+            RenderCanvas *canvas;
+            {
+                std::lock_guard<std::mutex> lk(canvasMutex);
+                std::unique_ptr<RenderCanvas> &c = canvases[hit];
+                if (!c)
+                {
+                    c = std::make_unique<RenderCanvas>();
+                    c->biomes.resize((size_t)imageSize * imageSize);
+                    c->tilesLeft.store(tiles);
+                }
+                canvas = c.get();
+                peakCanvases = std::max(peakCanvases, canvases.size());
+            }
+
+            if (!seeded || (int64_t)g.seed != r.seed)
+            {
+                applySeed(&g, DIM_OVERWORLD, (uint64_t)r.seed);
+                seeded = true;
+            }
+            if (renderTile(&g, cache.data(), area, (int)(ticket % tiles), QUERY_Y, canvas->biomes.data()) != 0)
+                failed.fetch_add(1);
+            if (canvas->tilesLeft.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                continue;
+
+            rgb.resize((size_t)3 * imageSize * imageSize);
+            const int bad = renderImage(canvas->biomes.data(), area, r, rgb.data());
+            char name[128];
+            snprintf(name, sizeof(name), "/%s_%" PRId64 "_%d_%d.%s", resultFinderName(finders[hit]), r.seed,
+                     r.temples[0].x, r.temples[0].z, format.c_str());
+            const std::string path = outDir + name;
+            if (!(format == "png" ? writePng : writePpm)(path, rgb.data(), imageSize, imageSize))
+            {
+                fprintf(stderr, "Failed to write '%s'\n", path.c_str());
+                failed.fetch_add(1);
+            }
+            if (bad)
+            {
+                printf("[RENDER] mismatch: %d of %d temples differ from the image in %s\n", bad, r.count, path.c_str());
+                mismatched.fetch_add(1);
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(canvasMutex);
+                canvases.erase(hit);
+            }
+            const uint64_t n = written.fetch_add(1) + 1;
+            if (n % RENDER_PROGRESS_EVERY == 0)
+                printf("[RENDER] images=%llu/%zu\n", (unsigned long long)n, hits.size());
+        } });
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    printf("[RENDER] written=%llu mismatched=%llu failed=%llu unfinished=%zu peak-images-in-memory=%zu seconds=%.1f\n",
+           (unsigned long long)written.load(), (unsigned long long)mismatched.load(), (unsigned long long)failed.load(),
+           canvases.size(), peakCanvases, seconds);
+    return failed.load() || mismatched.load() ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+#include <finder_utils.hpp>
+#include <result_file.hpp>
+#include <seedfinder.hpp>
+
+#include <cinttypes>
+
+static void print_results_usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s results <file.bin>... [options]\n", prog);
+    fprintf(stderr, "Merges binary result files of the finders (logs/*.bin).\n");
+    fprintf(stderr, "  --sort <score|seed>       best total first (default) or ascending seed\n");
+    fprintf(stderr, "  --top <k>                 keep the k results with the best totals\n");
+    fprintf(stderr, "  --keep-duplicates         do not drop identical records (e.g. from overlapping shards)\n");
+    fprintf(stderr, "  --csv <file>              export CSV to <file>, '-' for stdout (default when --out is not given)\n");
+    fprintf(stderr, "  --out <file>              write the selection as a new binary result file\n");
+}
+
+int run_results_tool(const char *prog, const std::vector<std::string> &args)
+{
+    std::vector<std::string> paths;
+    ResultQuery query;
+    std::string csvPath, outPath;
+
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        const std::string &arg = args[i];
+        const char *value = i + 1 < args.size() ? args[i + 1].c_str() : nullptr;
+
+        if (arg == "--sort" && value && (std::string(value) == "score" || std::string(value) == "seed"))
+        {
+            query.order = std::string(value) == "seed" ? RO_SEED : RO_SCORE;
+            ++i;
+        }
+        else if (arg == "--top" && value && parse_count(value, query.topK) && query.topK > 0)
+        {
+            ++i;
+        }
+        else if (arg == "--keep-duplicates")
+        {
+            query.dedup = false;
+        }
+        else if (arg == "--csv" && value)
+        {
+            csvPath = value;
+            ++i;
+        }
+        else if (arg == "--out" && value)
+        {
+            outPath = value;
+            ++i;
+        }
+        else if (arg.rfind("--", 0) != 0)
+        {
+            paths.push_back(arg);
+        }
+        else
+        {
+            fprintf(stderr, "Invalid option: %s\n", arg.c_str());
+            print_results_usage(prog);
+            return 2;
+        }
+    }
+    if (paths.empty())
+    {
+        print_results_usage(prog);
+        return 2;
+    }
+    if (csvPath.empty() && outPath.empty())
+        csvPath = "-";
+
+    std::vector<MappedResultFile> files(paths.size());
+    size_t records = 0;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (!files[i].open(paths[i]))
+            return 1;
+        const ResultFileHeader &h = files[i].header();
+        fprintf(stderr, "[RESULTS] %s finder=%s mc=%d start=%" PRIu64 " shard=%u/%u records=%zu\n", paths[i].c_str(),
+                resultFinderName(h.finder), h.mcVersion, h.startSeed, h.shardIndex, h.shardCount, files[i].size());
+        records += files[i].size();
+    }
+
+    std::vector<const ResultRecord *> selected = selectResults(files, query);
+    fprintf(stderr, "[RESULTS] records=%zu selected=%zu\n", records, selected.size());
+
+    if (!csvPath.empty())
+    {
+        FILE *fp = csvPath == "-" ? stdout : fopen(csvPath.c_str(), "w");
+        if (!fp)
+        {
+            fprintf(stderr, "Failed to open '%s'\n", csvPath.c_str());
+            return 1;
+        }
+        fprintf(fp, "finder,seed,total,temple,structure_type,world_x,world_z,swamp_spawn_blocks\n");
+        for (const ResultRecord *r : selected)
+            fprintf(fp, "%s,%" PRId64 ",%d,%d/%d,%s,%d,%d,%d\n", resultFinderName(r->finder), r->seed, r->total,
+                    r->index + 1, r->count, templeTypeName(r->type), r->x, r->z, r->score);
+        if (fp != stdout && fclose(fp) != 0)
+        {
+            fprintf(stderr, "Failed to write '%s'\n", csvPath.c_str());
+            return 1;
+        }
+    }
+
+    if (!outPath.empty())
+    {
+        // Run parameters of the first file, the records may come from several runs
+        ResultFileHeader header = files[0].header();
+        ResultFileWriter out;
+        if (!out.open(outPath, header, true))
+            return 1;
+        for (const ResultRecord *r : selected)
+            out.append(*r);
+        if (!out.flush())
+            return 1;
+        out.close();
+        fprintf(stderr, "[RESULTS] wrote %zu records to %s\n", selected.size(), outPath.c_str());
+    }
+    return 0;
+}
@@ -1,119 +1,218 @@
+#include <candidate_pipeline.hpp>
+#include <checkpoint.hpp>
 #include <finder_utils.hpp>
+#include <layer_cache.hpp>
+#include <metrics.hpp>
+#include <result_collector.hpp>
+#include <seedfinder.hpp>
+#include <structure_batch.hpp>
 
-// Extra config
+// Defaults of --radius and --progress-every
 constexpr int AREA_RADIUS_BLOCKS = 65536;
-constexpr int AREA_RADIUS_REGIONS = AREA_RADIUS_BLOCKS / (CHUNK_SIZE * 32);
 constexpr unsigned int PRINT_PROGRESS_EVERY_SEEDS = 128;
 
-int run_seed_finder(uint64_t startSeed = 0)
-{
-    // Main thread spawns workers and then joins (but workers run forever).
-    const unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency());
-
-    std::ofstream log("logs/seed_finder.log", std::ios::app);
-    if (!log)
-        fprintf(stderr, "Failed to open log file 'logs/seed_finder.log'\n");
-    else
-        log << "\n\nseed,\tstructure_type,\tworld_x,\tworld_z,\tswamp_spawn_blocks\n";
-
-    // Shared best result: protected by mutex
-    int64_t bestSeed = 0;
-    int bestWorldX = 0, bestWorldZ = 0, mostSwampSpawnBlocks = -1;
-    int bestType = 0; // 1 desert, 2 jungle, 3 witch
+// Coarse layer slabs kept per worker, 1 KiB each. A 4 MiB cache holds the
+// slabs a region column still needs from the previous ones.
+constexpr int LAYER_CACHE_SLABS = 4096;
 
-    // Atomic seed provider and counters
-    std::atomic<uint64_t> nextSeed(startSeed);
-    std::atomic<uint64_t> processedSeeds(0);
-
-    std::mutex bestMutex;
+int run_seed_finder(const FinderOptions &opt, FinderSummary *summary)
+{
+    // Main thread spawns workers and then joins (workers run until the last seed or opt.maxItems).
+    const unsigned int numThreads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    const auto startTime = std::chrono::steady_clock::now();
+    const int areaRadiusRegions = (int)(opt.areaRadiusBlocks ? opt.areaRadiusBlocks : AREA_RADIUS_BLOCKS) / (CHUNK_SIZE * 32);
+    const uint64_t printProgressEvery = opt.progressEvery ? opt.progressEvery : PRINT_PROGRESS_EVERY_SEEDS;
+
+    // Items are seeds, or with --siblings their position in sibling order
+    FinderOptions items = opt;
+    if (opt.siblingOrder)
+        items.startSeed = siblingOrderItem(opt.startSeed);
+
+    Checkpoint cp;
+    if (!resumeCheckpoint(items, opt.siblingOrder ? "seed-siblings" : "seed", 0, cp))
+        return 2;
+
+    // Items of this shard are handed out as tickets, see shardItem()
+    uint64_t ticketCount = shardTicketCount(items, UINT64_MAX);
+    if (opt.maxItems)
+        ticketCount = std::min(ticketCount, cp.frontier + opt.maxItems);
+    TaskEngine engine(numThreads, cp.frontier, ticketCount, opt.pinThreads);
+    PeriodicCheckpoint checkpoint(items, cp);
+    std::atomic<uint64_t> processedSeeds(0), structureSeeds(0);
+    FinderMetrics metrics(opt, "seed", numThreads, opt.maxItems ? ticketCount - std::min(ticketCount, cp.frontier) : 0);
+
+    // Results go through per-worker rings to the collector, which also gives the score to prune with
+    ResultCollector results(opt, RF_SEED, "logs/seed_finder.log", "\n\nseed,\tstructure_type,\tworld_x,\tworld_z,\tswamp_spawn_blocks\n",
+                            "logs/seed_finder.bin", "logs/seed_finder_histogram.csv", numThreads, &metrics);
+    if (cp.bestScore >= 0)
+        results.restore({cp.bestSeed, cp.bestScore, 1, {{cp.bestType, cp.bestScore, cp.bestX, cp.bestZ}}});
+
+    auto fillBest = [&](Checkpoint &c)
+    {
+        // Results of the seeds below the frontier must be in the checkpoint
+        results.sync();
+        FoundResult best;
+        if (!results.bestResult(best))
+            return;
+        c.bestSeed = best.seed;
+        c.bestScore = best.score;
+        c.bestX = best.temples[0].x;
+        c.bestZ = best.temples[0].z;
+        c.bestType = best.temples[0].type;
+    };
 
-    // Worker lambda
-    auto worker = [&](unsigned int workerId)
+    // Worker lambda, instantiated for the temple types of the search
+    auto worker = [&](unsigned int workerId, auto templeTypes)
     {
         Generator g;
         setupGenerator(&g, MC_VERSION, 0);
+        ThreadMetrics *m = metrics.worker(workerId);
+
+        // Neighbouring temples of a seed share their coarse layer cells, the
+        // cache answers them through the layer stack of g. That beats the
+        // uncached compile-time chain of FixedTempleEvaluator by far here.
+        CoarseLayerCache layerCache(&g, LAYER_CACHE_SLABS);
+        CoarseLayerCache::Stats reported;
+        TempleEvaluatorFor<decltype(templeTypes)::value> eval(&g, opt.queryY);
+        eval.setMetrics(m);
 
         int styp = Desert_Pyramid;
-        int templeType = 0, swampSpawnBlocks = 0;
-        Pos pos;
+        StructureConfig sconf;
+        getStructureConfig(styp, MC_VERSION, &sconf);
+
+        // Temple positions of consecutive regionX columns go through the
+        // pipeline a batch at a time
+        const int rowLength = 2 * areaRadiusRegions + 1;
+        CandidatePipeline<decltype(eval)> pipeline(eval, opt.batchSize ? (int)opt.batchSize : PIPELINE_BATCH);
+        pipeline.setMetrics(m);
+        uint64_t seed = 0;
+
+        // Sibling order: the temple positions of the area depend on the lower
+        // 48 bits only, so they are placed once per structure seed and fed to
+        // the pipeline again for each of its siblings
+        std::vector<int> areaX, areaZ;
+        uint64_t areaStructureSeed = UINT64_MAX;
+
+        auto flush = [&]()
+        {
+            const int minScore = results.threshold();
+            const int kept = pipeline.run(minScore);
+            for (int i = 0; i < kept; ++i)
+            {
+                const TempleScore temple = pipeline.templeScores(i)[0];
+                results.recordScore(workerId, temple.swampSpawnBlocks);
+                if (temple.swampSpawnBlocks < results.threshold(temple.type))
+                    continue;
+
+                results.submit(workerId, {(int64_t)seed, temple.swampSpawnBlocks, 1, {{temple.type, temple.swampSpawnBlocks, pipeline.xs(i)[0], pipeline.zs(i)[0]}}});
+            }
+            pipeline.clear();
+        };
 
         while (true)
         {
-            uint64_t seed = nextSeed.fetch_add(1, std::memory_order_relaxed);
-
-            if (seed == UINT64_MAX)
+            uint64_t ticket;
+            if (!engine.next(workerId, ticket))
             {
-                printf("Worker %u done. Reached max seed.\n", workerId);
+                printf(engine.interrupted() ? "Worker %u stopped.\n" : "Worker %u done. Reached last seed.\n", workerId);
                 break;
             }
 
-            applySeed(&g, DIM_OVERWORLD, (int64_t)seed);
+            const uint64_t item = shardItem(items, ticket);
+            seed = opt.siblingOrder ? siblingOrderSeed(item) : item;
 
-            for (int regionX = -AREA_RADIUS_REGIONS; regionX <= AREA_RADIUS_REGIONS; ++regionX)
             {
-                for (int regionZ = -AREA_RADIUS_REGIONS; regionZ <= AREA_RADIUS_REGIONS; ++regionZ)
-                {
-                    getStructurePos(styp, MC_VERSION, seed, regionX, regionZ, &pos);
-
-                    templeType = isViableTemplePos(&g, pos.x, pos.z);
-
-                    if (templeType == 0)
-                        continue;
-
-                    swampSpawnBlocks = countSwampSpawnBlocks(&g, pos.x, pos.z, templeType);
+                ThreadMetrics::StageTimer timer(m, STAGE_APPLY_SEED);
+                applySeed(&g, DIM_OVERWORLD, (int64_t)seed);
+            }
 
-                    if (swampSpawnBlocks <= 0)
-                        continue;
+            if (opt.siblingOrder)
+            {
+                if ((seed & MASK48) != areaStructureSeed)
+                {
+                    ThreadMetrics::StageTimer timer(m, STAGE_PLACEMENT);
+                    areaStructureSeed = seed & MASK48;
+                    areaX.resize((size_t)rowLength * rowLength);
+                    areaZ.resize((size_t)rowLength * rowLength);
+                    for (int column = 0; column < rowLength; ++column)
+                        getFeaturePosBatch(sconf, areaStructureSeed, column - areaRadiusRegions, -areaRadiusRegions, 0, 1, rowLength,
+                                           &areaX[(size_t)column * rowLength], &areaZ[(size_t)column * rowLength]);
+                    structureSeeds.fetch_add(1, std::memory_order_relaxed);
+                }
 
+                // Same candidates in the same order as placing them per seed
+                for (size_t added = 0; added < areaX.size();)
+                {
+                    added += pipeline.add(areaX.data() + added, areaZ.data() + added,
+                                          (int)std::min<size_t>(areaX.size() - added, (size_t)pipeline.space()));
+                    if (pipeline.space() == 0)
+                        flush();
+                }
+            }
+            else
+            {
+                for (int regionX = -areaRadiusRegions; regionX <= areaRadiusRegions; ++regionX)
+                {
+                    for (int placed = 0; placed < rowLength;)
                     {
-                        std::lock_guard<std::mutex> lock(bestMutex);
-
-                        if (swampSpawnBlocks >= mostSwampSpawnBlocks)
-                        {
-                            mostSwampSpawnBlocks = swampSpawnBlocks;
-                            bestSeed = seed;
-                            bestWorldX = pos.x;
-                            bestWorldZ = pos.z;
-                            bestType = templeType;
-
-                            const char *templeTypeName = (templeType == 1 ? "DesertPyramid" : templeType == 2 ? "JungleTemple"
-                                                                                                              : "WitchHut");
-                            printf("[NEW BEST] seed=%llu type=%s swamp-spawn-blocks=%d -> /tp @p %d ~ %d\n", (int64_t)bestSeed, templeTypeName, mostSwampSpawnBlocks, pos.x, pos.z);
-                            fflush(stdout);
-
-                            if (log)
-                            {
-                                log << bestSeed << ",\t" << templeTypeName << ",\t" << pos.x << ",\t" << pos.z << ",\t" << mostSwampSpawnBlocks << "\n";
-                                log.flush();
-                            }
-                        }
+                        placed += pipeline.place(sconf, seed, regionX, -areaRadiusRegions + placed, 0, 1, rowLength - placed);
+                        if (pipeline.space() == 0)
+                            flush();
                     }
                 }
             }
+            flush();
+
+            const CoarseLayerCache::Stats &cacheStats = layerCache.statistics();
+            m->add(CTR_LAYER_CACHE_HITS, cacheStats.hits - reported.hits);
+            m->add(CTR_LAYER_CACHE_MISSES, cacheStats.misses - reported.misses);
+            reported = cacheStats;
 
+            m->add(CTR_ITEMS);
             uint64_t done = processedSeeds.fetch_add(1, std::memory_order_relaxed) + 1;
-            if (done % PRINT_PROGRESS_EVERY_SEEDS == 0)
+            if (done % printProgressEvery == 0)
             {
-                std::lock_guard<std::mutex> lock(bestMutex);
-                printf("[PROGRESS] worker=%u processed-seeds=%llu best-so-far: seed=%llu swamp-spawn-blocks=%d at (%d,%d)\n",
-                       workerId, (uint64_t)done,
-                       (int64_t)bestSeed, mostSwampSpawnBlocks, bestWorldX, bestWorldZ);
+                FoundResult best;
+                results.bestResult(best);
+                printf("[PROGRESS] worker=%u processed-seeds=%" PRIu64 " best-so-far: seed=%" PRId64 " swamp-spawn-blocks=%d at (%d,%d)\n",
+                       workerId, done,
+                       best.seed, best.score, best.temples[0].x, best.temples[0].z);
+                printf("[CASCADE] worker=%u rejected: %s\n", workerId, formatCascadeStats(eval.cascadeStats()).c_str());
+                printf("[LAYER CACHE] worker=%u hit-rate=%.1f%% slabs=%d/%d evictions=%llu memory=%.1fMiB\n",
+                       workerId, 100.0 * cacheStats.hitRate(), layerCache.slabsUsed(), LAYER_CACHE_SLABS,
+                       (unsigned long long)cacheStats.evictions, layerCache.memoryBytes() / 1048576.0);
                 fflush(stdout);
             }
+
+            checkpoint.maybeSave(engine, fillBest);
         }
     };
 
-    // Spawn workers
-    std::vector<std::thread> threads;
-    threads.reserve(numThreads);
-    for (unsigned int t = 0; t < numThreads; ++t)
-    {
-        threads.emplace_back(worker, t);
-    }
-
-    for (auto &th : threads)
-        th.join();
+    engine.run([&](unsigned int t)
+               { withTempleTypes(opt.templeTypes, [&](auto templeTypes)
+                                 { worker(t, templeTypes); }); });
 
+    checkpoint.maybeSave(engine, fillBest, true);
+    results.stop();
+    metrics.stop();
+    if (opt.siblingOrder)
+        printf("[SIBLINGS] seeds=%llu structure-seeds-placed=%llu\n", (unsigned long long)processedSeeds.load(),
+               (unsigned long long)structureSeeds.load());
     printf("Done.\n");
+
+    FoundResult best;
+    if (summary)
+    {
+        summary->items = processedSeeds.load();
+        summary->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    if (summary && results.bestResult(best))
+    {
+        summary->bestSeed = best.seed;
+        summary->bestScore = best.score;
+        summary->bestX = best.temples[0].x;
+        summary->bestZ = best.temples[0].z;
+        summary->bestType = best.temples[0].type;
+    }
     return 0;
 }